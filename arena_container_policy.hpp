@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+#include "container_policy.hpp"
+
+// Allocation counters of an arena. Byte counts are the sizes requested by
+// the caller; `bytes_reserved` is what the arena obtained from upstream.
+struct arena_statistics {
+    std::size_t bytes_in_use = 0;
+    std::size_t high_water_mark = 0;
+    std::size_t bytes_reserved = 0;
+    std::size_t allocations = 0;
+};
+
+namespace detail {
+
+inline void record_allocation(arena_statistics& s, std::size_t const bytes) noexcept {
+    s.bytes_in_use += bytes;
+    s.high_water_mark = std::max(s.high_water_mark, s.bytes_in_use);
+    ++s.allocations;
+}
+
+inline void record_deallocation(arena_statistics& s, std::size_t const bytes) noexcept {
+    s.bytes_in_use -= bytes;
+}
+
+inline std::pmr::memory_resource*& thread_arena() noexcept {
+    thread_local std::pmr::memory_resource* arena = nullptr;
+    return arena;
+}
+
+// The arena_scopes open on this thread, innermost first.
+struct arena_scope_link {
+    std::pmr::memory_resource* arena = nullptr;
+    arena_scope_link const* outer = nullptr;
+};
+
+inline arena_scope_link const*& innermost_arena_scope() noexcept {
+    thread_local arena_scope_link const* scope = nullptr;
+    return scope;
+}
+
+} // namespace detail
+
+// A bump allocator over a chain of geometrically growing blocks. Individual
+// deallocations are free and only release() hands memory back; the most
+// recent (largest) block is kept so a reused arena stops touching upstream
+// once it has grown to its working-set size. Not thread-safe.
+class monotonic_arena final : public std::pmr::memory_resource {
+public:
+    explicit monotonic_arena(std::size_t const initial_block_bytes = std::size_t(64) << 10,
+                             std::pmr::memory_resource* const upstream = std::pmr::new_delete_resource()) noexcept
+        : upstream_(upstream), next_block_bytes_(std::max(initial_block_bytes, sizeof(block)))
+    {}
+
+    monotonic_arena(monotonic_arena const&) = delete;
+    monotonic_arena& operator=(monotonic_arena const&) = delete;
+
+    ~monotonic_arena() override {
+        free_blocks(nullptr);
+    }
+
+    // Frees everything allocated from the arena. No mdarray allocated from
+    // it may be alive.
+    void release() noexcept {
+        free_blocks(blocks_);
+        if (blocks_ != nullptr) {
+            blocks_->next = nullptr;
+            cursor_ = reinterpret_cast<char*>(blocks_ + 1);
+            stats_.bytes_reserved = blocks_->size;
+        }
+        stats_.bytes_in_use = 0;
+    }
+
+    arena_statistics statistics() const noexcept { return stats_; }
+    void reset_high_water_mark() noexcept { stats_.high_water_mark = stats_.bytes_in_use; }
+    std::pmr::memory_resource* upstream() const noexcept { return upstream_; }
+
+private:
+    struct alignas(std::max_align_t) block {
+        block* next;
+        std::size_t size;
+    };
+
+    void* do_allocate(std::size_t const bytes, std::size_t const alignment) override {
+        void* p = align_cursor(bytes, alignment);
+        if (p == nullptr) {
+            std::size_t const needed = sizeof(block) + bytes + alignment;
+            std::size_t const size = std::max(next_block_bytes_, needed);
+            auto* const b = static_cast<block*>(upstream_->allocate(size, alignof(block)));
+            b->next = blocks_;
+            b->size = size;
+            blocks_ = b;
+            cursor_ = reinterpret_cast<char*>(b + 1);
+            stats_.bytes_reserved += size;
+            next_block_bytes_ = size * 2;
+            p = align_cursor(bytes, alignment);
+        }
+        detail::record_allocation(stats_, bytes);
+        return p;
+    }
+
+    void do_deallocate(void*, std::size_t const bytes, std::size_t) override {
+        detail::record_deallocation(stats_, bytes);
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+    void* align_cursor(std::size_t const bytes, std::size_t const alignment) noexcept {
+        if (blocks_ == nullptr)
+            return nullptr;
+        void* p = cursor_;
+        std::size_t space = static_cast<std::size_t>(reinterpret_cast<char*>(blocks_) + blocks_->size - cursor_);
+        if (std::align(alignment, bytes, p, space) == nullptr)
+            return nullptr;
+        cursor_ = static_cast<char*>(p) + bytes;
+        return p;
+    }
+
+    // Returns every block after `keep` (all of them if null) to upstream.
+    void free_blocks(block* const keep) noexcept {
+        block* b = keep != nullptr ? keep->next : blocks_;
+        while (b != nullptr) {
+            block* const next = b->next;
+            upstream_->deallocate(b, b->size, alignof(block));
+            b = next;
+        }
+        if (keep == nullptr)
+            blocks_ = nullptr;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::size_t next_block_bytes_;
+    block* blocks_ = nullptr;
+    char* cursor_ = nullptr;
+    arena_statistics stats_;
+};
+
+// Recycles freed allocations through power-of-two size classes, carved from
+// an internal monotonic_arena. Requests larger than `largest_pooled_bytes`
+// go straight to upstream. Not thread-safe.
+class pool_arena final : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t smallest_class_bytes = 64;
+    static constexpr std::size_t max_class_alignment = 4096;
+
+    explicit pool_arena(std::size_t const largest_pooled_bytes = std::size_t(4) << 20,
+                        std::pmr::memory_resource* const upstream = std::pmr::new_delete_resource()) noexcept
+        : largest_pooled_bytes_(std::min(largest_pooled_bytes, class_bytes(class_count - 1))), chunks_(std::size_t(256) << 10, upstream)
+    {}
+
+    pool_arena(pool_arena const&) = delete;
+    pool_arena& operator=(pool_arena const&) = delete;
+
+    // Frees all pooled memory. No mdarray allocated from the arena may be
+    // alive, so oversized requests have already gone back upstream.
+    void release() noexcept {
+        free_lists_.fill(nullptr);
+        chunks_.release();
+        stats_.bytes_in_use = 0;
+    }
+
+    arena_statistics statistics() const noexcept {
+        arena_statistics s = stats_;
+        s.bytes_reserved += chunks_.statistics().bytes_reserved;
+        return s;
+    }
+    void reset_high_water_mark() noexcept { stats_.high_water_mark = stats_.bytes_in_use; }
+    std::pmr::memory_resource* upstream() const noexcept { return chunks_.upstream(); }
+
+private:
+    static constexpr std::size_t class_count = 32;
+
+    struct free_node {
+        free_node* next;
+    };
+
+    static constexpr std::size_t class_bytes(std::size_t const c) noexcept { return smallest_class_bytes << c; }
+
+    static std::size_t class_of(std::size_t const bytes) noexcept {
+        std::size_t c = 0;
+        while (class_bytes(c) < bytes)
+            ++c;
+        return c;
+    }
+
+    bool is_pooled(std::size_t const bytes, std::size_t const alignment) const noexcept {
+        return bytes <= largest_pooled_bytes_ && alignment <= max_class_alignment;
+    }
+
+    void* do_allocate(std::size_t const bytes, std::size_t const alignment) override {
+        void* p;
+        if (is_pooled(bytes, alignment)) {
+            // A class is at least as large as the alignment and every chunk
+            // in it is carved with the same alignment, so recycled chunks
+            // satisfy the request as well.
+            std::size_t const c = class_of(std::max(bytes, alignment));
+            if (free_node* const node = free_lists_[c]) {
+                free_lists_[c] = node->next;
+                p = node;
+            }
+            else
+                p = chunks_.allocate(class_bytes(c), std::min(class_bytes(c), max_class_alignment));
+        }
+        else {
+            p = chunks_.upstream()->allocate(bytes, alignment);
+            stats_.bytes_reserved += bytes;
+        }
+        detail::record_allocation(stats_, bytes);
+        return p;
+    }
+
+    void do_deallocate(void* const p, std::size_t const bytes, std::size_t const alignment) override {
+        if (is_pooled(bytes, alignment)) {
+            std::size_t const c = class_of(std::max(bytes, alignment));
+            free_lists_[c] = ::new (p) free_node{free_lists_[c]};
+        }
+        else {
+            chunks_.upstream()->deallocate(p, bytes, alignment);
+            stats_.bytes_reserved -= bytes;
+        }
+        detail::record_deallocation(stats_, bytes);
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+    std::size_t largest_pooled_bytes_;
+    monotonic_arena chunks_;
+    std::array<free_node*, class_count> free_lists_{};
+    arena_statistics stats_;
+};
+
+// Makes `arena` the calling thread's current arena, which default-constructed
+// arena_container_policy objects allocate from, and releases it at the end of
+// the scope. Each thread installing its own arena is the lock-free fast path;
+// scopes nest. A scope nested in another scope of the same arena on this
+// thread does not release it, so the outer scope's arrays stay valid; the
+// arena is released when the outermost of them exits.
+template<class Arena>
+class arena_scope {
+public:
+    explicit arena_scope(Arena& arena) noexcept
+        : arena_(arena)
+        , previous_(std::exchange(detail::thread_arena(), &arena))
+        , link_{&arena, detail::innermost_arena_scope()}
+    {
+        detail::innermost_arena_scope() = &link_;
+    }
+
+    arena_scope(arena_scope const&) = delete;
+    arena_scope& operator=(arena_scope const&) = delete;
+
+    ~arena_scope() {
+        detail::thread_arena() = previous_;
+        detail::innermost_arena_scope() = link_.outer;
+        for (detail::arena_scope_link const* outer = link_.outer; outer != nullptr; outer = outer->outer) {
+            if (outer->arena == link_.arena)
+                return;
+        }
+        arena_.release();
+    }
+
+private:
+    Arena& arena_;
+    std::pmr::memory_resource* previous_;
+    detail::arena_scope_link link_;
+};
+
+// The arena that default-constructed arena_container_policy objects on this
+// thread allocate from: the innermost arena_scope, or the global allocator.
+inline std::pmr::memory_resource* current_arena() noexcept {
+    std::pmr::memory_resource* const arena = detail::thread_arena();
+    return arena != nullptr ? arena : std::pmr::new_delete_resource();
+}
+
+namespace detail {
+
+template<class T>
+struct arena_deleter {
+    std::pmr::memory_resource* resource = nullptr;
+    std::size_t size = 0;
+    std::size_t alignment = alignof(T);
+
+    void operator()(T* const p) const noexcept {
+        std::destroy_n(p, size);
+        resource->deallocate(p, size * sizeof(T), alignment);
+    }
+};
+
+} // namespace detail
+
+// Allocates from a memory resource, typically a monotonic_arena or
+// pool_arena, instead of the global allocator. A default-constructed policy
+// binds to current_arena() at construction; pass one explicitly through
+// basic_mdarray(mapping_type const&, container_policy_type const&) to use a
+// specific arena. Elements are value-initialized. The arena must outlive
+// every mdarray allocated from it.
+template<class T, std::size_t Alignment = alignof(T)>
+class arena_container_policy {
+    static_assert((Alignment & (Alignment - 1)) == 0, "alignment must be a power of two");
+public:
+    using element_type = T;
+    using container_type = std::unique_ptr<T[], detail::arena_deleter<T>>;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using reference = T&;
+    using const_reference = T const&;
+    using offset_policy = default_container_policy<T>;
+
+    static constexpr std::size_t alignment = Alignment < alignof(T) ? alignof(T) : Alignment;
+
+    arena_container_policy() noexcept : resource_(current_arena()) {}
+    explicit arena_container_policy(std::pmr::memory_resource& resource) noexcept : resource_(&resource) {}
+
+    container_type create(std::size_t const n) const {
+        T* const p = static_cast<T*>(resource_->allocate(n * sizeof(T), alignment));
+        try {
+            std::uninitialized_value_construct_n(p, n);
+        }
+        catch (...) {
+            resource_->deallocate(p, n * sizeof(T), alignment);
+            throw;
+        }
+        return container_type(p, detail::arena_deleter<T>{resource_, n, alignment});
+    }
+
+    reference access(container_type const& p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(container_type const& p, std::ptrdiff_t const i) const { return p[i]; }
+    reference access(pointer const p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return p[i]; }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
+
+    element_type* decay(pointer const p) { return p; }
+    element_type const* decay(pointer const p) const { return p; }
+
+    pointer data(container_type& c) { return c.get(); }
+    const_pointer data(container_type const& c) const { return c.get(); }
+
+    std::pmr::memory_resource* resource() const noexcept { return resource_; }
+
+private:
+    std::pmr::memory_resource* resource_;
+};
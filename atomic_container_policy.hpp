@@ -0,0 +1,292 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+
+#include "container_policy.hpp"
+
+// Concurrent scatter updates. With atomic_container_policy, mutable element
+// access returns an atomic_reference, so `h(i, j, k) += w` from many threads
+// is a lock-free atomic read-modify-write. Const access is a relaxed atomic
+// load. data() still yields the raw elements; algorithms that use it (the
+// parallel algorithms, reductions, copies) must not run concurrently with
+// atomic updates.
+//
+// privatized_accumulator buffers the updates of one thread in a small table
+// of bins and applies them with one atomic update per bin when a bin is
+// evicted or the accumulator is flushed, so heavily contended bins cost
+// almost no atomic traffic.
+//
+// The atomics are built on the GCC/Clang __atomic builtins, which are what
+// std::atomic_ref uses in C++20.
+
+#if !defined(__GNUC__)
+#error "atomic_container_policy.hpp requires the GCC/Clang __atomic builtins"
+#endif
+
+namespace detail {
+
+constexpr int builtin_memory_order(std::memory_order const order) noexcept {
+    switch (order) {
+    case std::memory_order_relaxed: return __ATOMIC_RELAXED;
+    case std::memory_order_consume: return __ATOMIC_CONSUME;
+    case std::memory_order_acquire: return __ATOMIC_ACQUIRE;
+    case std::memory_order_release: return __ATOMIC_RELEASE;
+    case std::memory_order_acq_rel: return __ATOMIC_ACQ_REL;
+    default: return __ATOMIC_SEQ_CST;
+    }
+}
+
+// The strongest order a failed compare-exchange may use for a given success
+// order.
+constexpr std::memory_order failure_memory_order(std::memory_order const order) noexcept {
+    switch (order) {
+    case std::memory_order_release: return std::memory_order_relaxed;
+    case std::memory_order_acq_rel: return std::memory_order_acquire;
+    default: return order;
+    }
+}
+
+template<class T>
+T atomic_load(T const* const p, std::memory_order const order) noexcept {
+    std::remove_cv_t<T> r;
+    __atomic_load(p, &r, builtin_memory_order(order));
+    return r;
+}
+
+} // namespace detail
+
+// An atomic view of an object that is not itself std::atomic, like C++20's
+// std::atomic_ref. The object must be aligned to required_alignment, and
+// while any atomic_reference to it exists it must only be accessed through
+// one. Floating-point arithmetic, fetch_min and fetch_max are
+// compare-exchange loops; the latter two do not write if the value already
+// compares no greater (no less).
+template<class T>
+class atomic_reference {
+    static_assert(std::is_trivially_copyable_v<T>, "atomic_reference requires a trivially copyable type");
+public:
+    using value_type = T;
+
+    static constexpr std::size_t required_alignment = sizeof(T) > alignof(T) ? sizeof(T) : alignof(T);
+    static constexpr bool is_always_lock_free = __atomic_always_lock_free(sizeof(T), 0);
+
+    explicit atomic_reference(T& object) noexcept : p_(std::addressof(object)) {}
+    atomic_reference(atomic_reference const&) noexcept = default;
+
+    T operator=(T const value) const noexcept {
+        store(value);
+        return value;
+    }
+
+    // Assigns the value referenced by `other`, so that elements of atomic
+    // mdarrays can be copied with `a(i) = b(i)`.
+    T operator=(atomic_reference const& other) const noexcept { return *this = other.load(); }
+
+    operator T() const noexcept { return load(); }
+
+    T load(std::memory_order const order = std::memory_order_seq_cst) const noexcept { return detail::atomic_load(p_, order); }
+
+    void store(T value, std::memory_order const order = std::memory_order_seq_cst) const noexcept {
+        __atomic_store(p_, &value, detail::builtin_memory_order(order));
+    }
+
+    T exchange(T value, std::memory_order const order = std::memory_order_seq_cst) const noexcept {
+        T r;
+        __atomic_exchange(p_, &value, &r, detail::builtin_memory_order(order));
+        return r;
+    }
+
+    bool compare_exchange_weak(T& expected, T desired, std::memory_order const success, std::memory_order const failure) const noexcept {
+        return __atomic_compare_exchange(p_, &expected, &desired, true, detail::builtin_memory_order(success), detail::builtin_memory_order(failure));
+    }
+
+    bool compare_exchange_weak(T& expected, T const desired, std::memory_order const order = std::memory_order_seq_cst) const noexcept {
+        return compare_exchange_weak(expected, desired, order, detail::failure_memory_order(order));
+    }
+
+    bool compare_exchange_strong(T& expected, T desired, std::memory_order const success, std::memory_order const failure) const noexcept {
+        return __atomic_compare_exchange(p_, &expected, &desired, false, detail::builtin_memory_order(success), detail::builtin_memory_order(failure));
+    }
+
+    bool compare_exchange_strong(T& expected, T const desired, std::memory_order const order = std::memory_order_seq_cst) const noexcept {
+        return compare_exchange_strong(expected, desired, order, detail::failure_memory_order(order));
+    }
+
+    // The arithmetic operations return the previous value; the operators
+    // return the new one.
+    T fetch_add(T const value, std::memory_order const order = std::memory_order_seq_cst) const noexcept {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "");
+        if constexpr (std::is_integral_v<T>)
+            return __atomic_fetch_add(p_, value, detail::builtin_memory_order(order));
+        else {
+            T old = load(std::memory_order_relaxed);
+            while (!compare_exchange_weak(old, old + value, order, std::memory_order_relaxed)) {}
+            return old;
+        }
+    }
+
+    T fetch_sub(T const value, std::memory_order const order = std::memory_order_seq_cst) const noexcept {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "");
+        if constexpr (std::is_integral_v<T>)
+            return __atomic_fetch_sub(p_, value, detail::builtin_memory_order(order));
+        else {
+            T old = load(std::memory_order_relaxed);
+            while (!compare_exchange_weak(old, old - value, order, std::memory_order_relaxed)) {}
+            return old;
+        }
+    }
+
+    T fetch_min(T const value, std::memory_order const order = std::memory_order_seq_cst) const noexcept {
+        static_assert(std::is_arithmetic_v<T>, "");
+        T old = load(std::memory_order_relaxed);
+        while (value < old && !compare_exchange_weak(old, value, order, std::memory_order_relaxed)) {}
+        return old;
+    }
+
+    T fetch_max(T const value, std::memory_order const order = std::memory_order_seq_cst) const noexcept {
+        static_assert(std::is_arithmetic_v<T>, "");
+        T old = load(std::memory_order_relaxed);
+        while (old < value && !compare_exchange_weak(old, value, order, std::memory_order_relaxed)) {}
+        return old;
+    }
+
+    T operator+=(T const value) const noexcept { return fetch_add(value) + value; }
+    T operator-=(T const value) const noexcept { return fetch_sub(value) - value; }
+    T operator++() const noexcept { return fetch_add(1) + 1; }
+    T operator--() const noexcept { return fetch_sub(1) - 1; }
+    T operator++(int) const noexcept { return fetch_add(1); }
+    T operator--(int) const noexcept { return fetch_sub(1); }
+
+    T* address() const noexcept { return p_; }
+
+private:
+    T* p_;
+};
+
+template<class T>
+struct atomic_container_policy {
+    static_assert(atomic_reference<T>::is_always_lock_free, "elements must support lock-free atomics");
+
+    using element_type = T;
+    using container_type = detail::aligned_array<T>;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using reference = atomic_reference<T>;
+    using const_reference = T;
+    using offset_policy = atomic_container_policy<T>;
+
+    static constexpr std::size_t alignment = atomic_reference<T>::required_alignment < 64 ? 64 : atomic_reference<T>::required_alignment;
+
+    container_type create(std::size_t const n) const { return detail::allocate_aligned_array<T, true>(n, alignment); }
+
+    reference access(container_type const& p, std::ptrdiff_t const i) { return reference(p[i]); }
+    const_reference access(container_type const& p, std::ptrdiff_t const i) const { return detail::atomic_load(&p[i], std::memory_order_relaxed); }
+    reference access(pointer const p, std::ptrdiff_t const i) { return reference(p[i]); }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return detail::atomic_load(p + i, std::memory_order_relaxed); }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
+
+    element_type* decay(pointer const p) { return p; }
+    element_type const* decay(pointer const p) const { return p; }
+
+    pointer data(container_type& c) { return c.get(); }
+    const_pointer data(container_type const& c) const { return c.get(); }
+};
+
+// Accumulates `+=` updates to the elements of `md` (an mdarray or view with
+// raw, atomically updatable storage, usually atomic_container_policy) on one
+// thread. Bins are cached in a direct-mapped table of Slots entries; a bin is
+// applied to `md` with one relaxed atomic add when another bin evicts it,
+// and all cached bins are applied by flush() and the destructor. Use one
+// accumulator per thread or task; results in `md` are complete once every
+// accumulator has been flushed.
+template<class MD, std::size_t Slots = 256>
+class privatized_accumulator {
+    static_assert(Slots > 0 && (Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+public:
+    using value_type = typename MD::value_type;
+    using mapping_type = typename MD::mapping_type;
+
+private:
+    static_assert(std::is_arithmetic_v<value_type> && !std::is_same_v<value_type, bool>, "");
+    static_assert(std::is_pointer_v<decltype(std::declval<MD&>().data())>, "privatized_accumulator requires raw element storage");
+    static_assert(detail::policy_alignment_v<typename MD::container_policy_type> >= atomic_reference<value_type>::required_alignment ||
+                      alignof(value_type) >= atomic_reference<value_type>::required_alignment,
+                  "elements must be aligned for atomic access");
+
+    static constexpr std::size_t slot_bits_ = [] {
+        std::size_t bits = 0;
+        while ((std::size_t(1) << bits) < Slots)
+            ++bits;
+        return bits;
+    }();
+
+    struct slot {
+        std::ptrdiff_t offset = -1;
+        value_type value{};
+    };
+
+    // Fibonacci hashing, so that bins a power-of-two stride apart do not
+    // share a slot.
+    static std::size_t slot_index(std::ptrdiff_t const offset) noexcept {
+        if constexpr (slot_bits_ == 0)
+            return 0;
+        else
+            return static_cast<std::size_t>((static_cast<std::uint64_t>(offset) * 0x9e3779b97f4a7c15ull) >> (64 - slot_bits_));
+    }
+
+    void apply(slot const& s) const noexcept {
+        atomic_reference<value_type>(data_[s.offset]).fetch_add(s.value, std::memory_order_relaxed);
+    }
+
+public:
+    explicit privatized_accumulator(MD& md) : data_(md.data()), mapping_(md.mapping()) {}
+    ~privatized_accumulator() { flush(); }
+
+    privatized_accumulator(privatized_accumulator const&) = delete;
+    privatized_accumulator& operator=(privatized_accumulator const&) = delete;
+
+    template<class... Indices>
+    void add(value_type const value, Indices const... is) noexcept {
+        add_at_offset(static_cast<std::ptrdiff_t>(mapping_(is...)), value);
+    }
+
+    template<class IndexType, std::size_t N>
+    void add(value_type const value, std::array<IndexType, N> const& indices) noexcept {
+        std::apply([&](auto const... is) { add(value, is...); }, indices);
+    }
+
+    // Applies every cached bin to the mdarray.
+    void flush() noexcept {
+        for (slot& s : slots_) {
+            if (s.offset >= 0)
+                apply(s);
+            s = slot{};
+        }
+    }
+
+private:
+    void add_at_offset(std::ptrdiff_t const offset, value_type const value) noexcept {
+        slot& s = slots_[slot_index(offset)];
+        if (s.offset != offset) {
+            if (s.offset >= 0)
+                apply(s);
+            s.offset = offset;
+            s.value = value;
+        }
+        else
+            s.value += value;
+    }
+
+    value_type* data_;
+    mapping_type mapping_;
+    std::array<slot, Slots> slots_{};
+};
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "container_policy.hpp"
+#include "mdarray.hpp"
+#include "parallel.hpp"
+
+// Many arrays of one shape ("members") in a single allocation, addressed as
+// a(b, i, j, ...) for member b. With batch_order::outer each member is
+// contiguous and starts on a cache line, so member views are ordinary arrays
+// of the member layout. With batch_order::interleaved the batch index is
+// innermost: element (i, j, ...) of all members is contiguous, padded to a
+// whole number of cache lines, and kernels vectorize across members, which
+// suits batches of small arrays whose own extents are too short for SIMD.
+//
+// batch_transform and batch_matmul apply one operation to every member,
+// split across a thread_pool.
+
+enum class batch_order {
+    outer,      // member-major: the batch index is outermost
+    interleaved // the batch index is innermost
+};
+
+namespace detail {
+
+template<class T>
+inline constexpr std::ptrdiff_t batch_line_elements = sizeof(T) >= 64 ? 1 : static_cast<std::ptrdiff_t>(64 / sizeof(T));
+
+constexpr std::ptrdiff_t round_up_to(std::ptrdiff_t const n, std::ptrdiff_t const m) noexcept { return (n + m - 1) / m * m; }
+
+} // namespace detail
+
+template<class T, class Extents, batch_order Order = batch_order::outer, class LayoutPolicy = layout_right>
+class batched_mdarray {
+public:
+    using extents_type = Extents;
+    using layout_type = LayoutPolicy;
+    using mapping_type = typename layout_type::template mapping<extents_type>;
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using index_type = typename extents_type::index_type;
+    using difference_type = std::ptrdiff_t;
+    using member_layout_type = std::conditional_t<Order == batch_order::outer, layout_type, layout_stride>;
+    using member_view_type = basic_mdarray_view<T, extents_type, member_layout_type>;
+    using const_member_view_type = basic_mdarray_view<T const, extents_type, member_layout_type, default_container_policy<T const>>;
+
+    static_assert(Order == batch_order::outer || mapping_type::is_always_strided(), "interleaved batches require a strided member layout");
+
+    static constexpr batch_order order = Order;
+    static constexpr std::size_t alignment = 64;
+
+private:
+    static constexpr std::ptrdiff_t line_ = detail::batch_line_elements<T>;
+
+    constexpr std::ptrdiff_t offset(std::ptrdiff_t const b, std::ptrdiff_t const member_offset) const noexcept {
+        if constexpr (Order == batch_order::outer)
+            return b * stride_ + member_offset;
+        else
+            return member_offset * stride_ + b;
+    }
+
+public:
+    batched_mdarray() = default;
+
+    batched_mdarray(std::ptrdiff_t const batch, mapping_type const& m) : mapping_(m), batch_(batch) {
+        std::ptrdiff_t const span = static_cast<std::ptrdiff_t>(mapping_.required_span_size());
+        stride_ = Order == batch_order::outer ? detail::round_up_to(span, line_) : detail::round_up_to(batch, line_);
+        size_ = Order == batch_order::outer ? batch * stride_ : span * stride_;
+        data_ = detail::allocate_aligned_array<T, true>(static_cast<std::size_t>(size_), alignment);
+    }
+
+    template<class... IndexTypes>
+    explicit batched_mdarray(std::ptrdiff_t const batch, IndexTypes... dynamic_extents) : batched_mdarray(batch, mapping_type(extents_type(dynamic_extents...))) {
+        static_assert(sizeof...(IndexTypes) == extents_type::rank_dynamic(), "");
+    }
+
+    static constexpr std::size_t rank() noexcept { return extents_type::rank(); }
+    constexpr std::ptrdiff_t batch_size() const noexcept { return batch_; }
+    constexpr extents_type extents() const noexcept { return mapping_.extents(); }
+    constexpr index_type extent(std::size_t const r) const noexcept { return mapping_.extent(r); }
+    constexpr mapping_type mapping() const noexcept { return mapping_; }
+
+    // Distance in elements between the same element of consecutive members,
+    // and between consecutive storage offsets of one member.
+    constexpr std::ptrdiff_t batch_stride() const noexcept { return Order == batch_order::outer ? stride_ : 1; }
+    constexpr std::ptrdiff_t element_stride() const noexcept { return Order == batch_order::outer ? 1 : stride_; }
+
+    // Elements allocated, padding included.
+    constexpr std::ptrdiff_t storage_size() const noexcept { return size_; }
+
+    T* data() noexcept { return data_.get(); }
+    T const* data() const noexcept { return data_.get(); }
+
+    template<class... Indices>
+    T& operator()(std::ptrdiff_t const b, Indices const... is) noexcept {
+        return data_[offset(b, static_cast<std::ptrdiff_t>(mapping_(is...)))];
+    }
+
+    template<class... Indices>
+    T const& operator()(std::ptrdiff_t const b, Indices const... is) const noexcept {
+        return data_[offset(b, static_cast<std::ptrdiff_t>(mapping_(is...)))];
+    }
+
+    member_view_type operator[](std::ptrdiff_t const b) noexcept { return member(b); }
+    const_member_view_type operator[](std::ptrdiff_t const b) const noexcept { return member(b); }
+
+    member_view_type member(std::ptrdiff_t const b) noexcept { return member_view<member_view_type>(data(), b); }
+    const_member_view_type member(std::ptrdiff_t const b) const noexcept { return member_view<const_member_view_type>(data(), b); }
+
+private:
+    template<class View, class P>
+    View member_view(P const p, std::ptrdiff_t const b) const noexcept {
+        if constexpr (Order == batch_order::outer)
+            return View(p + offset(b, 0), mapping_);
+        else {
+            std::array<std::ptrdiff_t, rank()> strides{};
+            for (std::size_t r = 0; r < rank(); ++r)
+                strides[r] = static_cast<std::ptrdiff_t>(mapping_.stride(r)) * stride_;
+            return View(p + offset(b, 0), layout_stride::mapping<extents_type>(extents(), strides));
+        }
+    }
+
+    mapping_type mapping_{};
+    std::ptrdiff_t batch_ = 0;
+    std::ptrdiff_t stride_ = 0;
+    std::ptrdiff_t size_ = 0;
+    detail::aligned_array<T> data_{};
+};
+
+namespace detail {
+
+// Calls f(first, last) for consecutive subranges of [0, n) on the pool.
+template<class F>
+void parallel_ranges(thread_pool& pool, std::ptrdiff_t const n, F const& f) {
+    std::size_t const count = static_cast<std::size_t>(n);
+    std::size_t const chunks = std::min(count, pool.size() * tiles_per_thread);
+    pool.parallel_for(chunks, [&](std::size_t const c) {
+        f(static_cast<std::ptrdiff_t>(c * count / chunks), static_cast<std::ptrdiff_t>((c + 1) * count / chunks));
+    });
+}
+
+// Applies out = f(ins...) elementwise. Each member (outer) or each storage
+// offset of a member (interleaved) is one contiguous run, so the inner loop
+// is unit-stride in every operand.
+template<class Out, class F, class... Ins>
+void batch_apply(thread_pool& pool, Out& out, F const& f, Ins const&... ins) {
+    assert(((ins.batch_size() == out.batch_size() && ins.extents() == out.extents()) && ...));
+    std::ptrdiff_t const batch = out.batch_size();
+    std::ptrdiff_t const span = static_cast<std::ptrdiff_t>(out.mapping().required_span_size());
+    if constexpr (Out::order == batch_order::outer) {
+        parallel_ranges(pool, batch, [&](std::ptrdiff_t const first, std::ptrdiff_t const last) {
+            for (std::ptrdiff_t b = first; b < last; ++b) {
+                auto* const dst = out.data() + b * out.batch_stride();
+                std::tuple const srcs{(ins.data() + b * ins.batch_stride())...};
+                for (std::ptrdiff_t o = 0; o < span; ++o)
+                    dst[o] = std::apply([&](auto const*... s) { return f(s[o]...); }, srcs);
+            }
+        });
+    }
+    else {
+        parallel_ranges(pool, span, [&](std::ptrdiff_t const first, std::ptrdiff_t const last) {
+            for (std::ptrdiff_t o = first; o < last; ++o) {
+                auto* const dst = out.data() + o * out.element_stride();
+                std::tuple const srcs{(ins.data() + o * ins.element_stride())...};
+                for (std::ptrdiff_t b = 0; b < batch; ++b)
+                    dst[b] = std::apply([&](auto const*... s) { return f(s[b]...); }, srcs);
+            }
+        });
+    }
+}
+
+// Members processed together by the interleaved matmul; the accumulators of
+// one output element stay in vector registers.
+template<class T>
+inline constexpr std::ptrdiff_t batch_matmul_block = 4 * batch_line_elements<T>;
+
+} // namespace detail
+
+// out(b, idx) = f(in(b, idx)) for every member b and index idx. The batches
+// must have equal sizes and extents; their order and member layout are part
+// of the type.
+template<class T, class U, class E, batch_order O, class LP, class F>
+void batch_transform(thread_pool& pool, batched_mdarray<T, E, O, LP> const& in, batched_mdarray<U, E, O, LP>& out, F f) {
+    detail::batch_apply(pool, out, f, in);
+}
+
+template<class T, class U, class E, batch_order O, class LP, class F>
+void batch_transform(batched_mdarray<T, E, O, LP> const& in, batched_mdarray<U, E, O, LP>& out, F f) {
+    batch_transform(thread_pool::global(), in, out, std::move(f));
+}
+
+// out(b, idx) = f(lhs(b, idx), rhs(b, idx)).
+template<class L, class R, class U, class E, batch_order O, class LP, class F>
+void batch_transform(thread_pool& pool, batched_mdarray<L, E, O, LP> const& lhs, batched_mdarray<R, E, O, LP> const& rhs,
+                     batched_mdarray<U, E, O, LP>& out, F f) {
+    detail::batch_apply(pool, out, f, lhs, rhs);
+}
+
+template<class L, class R, class U, class E, batch_order O, class LP, class F>
+void batch_transform(batched_mdarray<L, E, O, LP> const& lhs, batched_mdarray<R, E, O, LP> const& rhs, batched_mdarray<U, E, O, LP>& out, F f) {
+    batch_transform(thread_pool::global(), lhs, rhs, out, std::move(f));
+}
+
+// c[b] = a[b] * b[b] for every member b, with M x K, K x N and M x N member
+// matrices. Interleaved batches vectorize across members; outer batches
+// vectorize along the rows of each member.
+template<class T, class EA, class EB, class EC, batch_order O, class LA, class LB, class LC>
+void batch_matmul(thread_pool& pool, batched_mdarray<T, EA, O, LA> const& a, batched_mdarray<T, EB, O, LB> const& b, batched_mdarray<T, EC, O, LC>& c) {
+    static_assert(EA::rank() == 2 && EB::rank() == 2 && EC::rank() == 2, "batch_matmul takes batches of matrices");
+    assert(a.batch_size() == b.batch_size() && a.batch_size() == c.batch_size());
+    assert(a.extent(1) == b.extent(0) && c.extent(0) == a.extent(0) && c.extent(1) == b.extent(1));
+
+    std::ptrdiff_t const m = c.extent(0);
+    std::ptrdiff_t const n = c.extent(1);
+    std::ptrdiff_t const k = a.extent(1);
+    auto const ma = a.mapping();
+    auto const mb = b.mapping();
+    auto const mc = c.mapping();
+
+    if constexpr (O == batch_order::outer) {
+        detail::parallel_ranges(pool, c.batch_size(), [&](std::ptrdiff_t const first, std::ptrdiff_t const last) {
+            for (std::ptrdiff_t bi = first; bi < last; ++bi) {
+                T const* const pa = a.data() + bi * a.batch_stride();
+                T const* const pb = b.data() + bi * b.batch_stride();
+                T* const pc = c.data() + bi * c.batch_stride();
+                for (std::ptrdiff_t i = 0; i < m; ++i) {
+                    for (std::ptrdiff_t j = 0; j < n; ++j)
+                        pc[mc(i, j)] = T{};
+                    for (std::ptrdiff_t p = 0; p < k; ++p) {
+                        T const aip = pa[ma(i, p)];
+                        for (std::ptrdiff_t j = 0; j < n; ++j)
+                            pc[mc(i, j)] += aip * pb[mb(p, j)];
+                    }
+                }
+            }
+        });
+    }
+    else {
+        constexpr std::ptrdiff_t block = detail::batch_matmul_block<T>;
+        std::ptrdiff_t const blocks = (c.batch_size() + block - 1) / block;
+        // Count is a compile-time constant for full blocks, so the
+        // accumulator loop has a fixed trip count.
+        auto const kernel = [&](std::ptrdiff_t const b0, auto const count) {
+            for (std::ptrdiff_t i = 0; i < m; ++i) {
+                for (std::ptrdiff_t j = 0; j < n; ++j) {
+                    T acc[block] = {};
+                    for (std::ptrdiff_t p = 0; p < k; ++p) {
+                        T const* const pa = a.data() + static_cast<std::ptrdiff_t>(ma(i, p)) * a.element_stride() + b0;
+                        T const* const pb = b.data() + static_cast<std::ptrdiff_t>(mb(p, j)) * b.element_stride() + b0;
+                        for (std::ptrdiff_t l = 0; l < count; ++l)
+                            acc[l] += pa[l] * pb[l];
+                    }
+                    T* const pc = c.data() + static_cast<std::ptrdiff_t>(mc(i, j)) * c.element_stride() + b0;
+                    for (std::ptrdiff_t l = 0; l < count; ++l)
+                        pc[l] = acc[l];
+                }
+            }
+        };
+        detail::parallel_ranges(pool, blocks, [&](std::ptrdiff_t const first, std::ptrdiff_t const last) {
+            for (std::ptrdiff_t bl = first; bl < last; ++bl) {
+                std::ptrdiff_t const b0 = bl * block;
+                if (c.batch_size() - b0 >= block)
+                    kernel(b0, std::integral_constant<std::ptrdiff_t, block>{});
+                else
+                    kernel(b0, c.batch_size() - b0);
+            }
+        });
+    }
+}
+
+template<class T, class EA, class EB, class EC, batch_order O, class LA, class LB, class LC>
+void batch_matmul(batched_mdarray<T, EA, O, LA> const& a, batched_mdarray<T, EB, O, LB> const& b, batched_mdarray<T, EC, O, LC>& c) {
+    batch_matmul(thread_pool::global(), a, b, c);
+}
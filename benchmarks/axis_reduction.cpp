@@ -0,0 +1,146 @@
+// Per-row and per-column reductions of a 4096x4096 float matrix in
+// layout_right. Rows are contiguous; columns are reduced across rows.
+// "hand_written" is the obvious loop nest over the reduced index with
+// operator(), which walks columns one element per row. Items are input
+// elements. Also prints the relative error of each summation mode on one
+// long line. Every result is checked against a double-precision reference
+// before it is timed: sums and running sums within a relative tolerance,
+// maxima and their indices exactly. Exits with status 1 on a mismatch.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "../reduction.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using matrix_extents = extents<dynamic_extent, dynamic_extent>;
+using matrix = basic_mdarray<float, matrix_extents, layout_right>;
+using vector = basic_mdarray<float, extents<dynamic_extent>, layout_right>;
+
+constexpr std::ptrdiff_t n = 4096;
+
+// Sums along Axis with the reduced index innermost.
+template<std::size_t Axis>
+void hand_written_sum(matrix const& a, vector& out) {
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        float s = 0;
+        for (std::ptrdiff_t k = 0; k < n; ++k)
+            s += Axis == 1 ? a(i, k) : a(k, i);
+        out(i) = s;
+    }
+}
+
+// Element k of line i along Axis: row i for Axis 1, column i for Axis 0.
+template<std::size_t Axis, class MD>
+auto at(MD const& md, std::ptrdiff_t const i, std::ptrdiff_t const k) {
+    return Axis == 1 ? md(i, k) : md(k, i);
+}
+
+// A naive float sum of n terms of one sign is within n * epsilon of the
+// exact sum; pairwise and compensated sums are much closer.
+constexpr double naive_tolerance = 1e-3;
+constexpr double tolerance = 1e-5;
+
+bool near(double const x, double const expected, double const relative) {
+    return std::abs(x - expected) <= relative * std::abs(expected);
+}
+
+bool check(bool const ok, std::string const& what) {
+    if (!ok)
+        std::printf("    %s: result differs from the reference\n", what.c_str());
+    return ok;
+}
+
+template<std::size_t Axis, class Sums>
+bool check_sums(matrix const& a, Sums const& sums, double const relative) {
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        double expected = 0;
+        for (std::ptrdiff_t k = 0; k < n; ++k)
+            expected += at<Axis>(a, i, k);
+        if (!near(sums(i), expected, relative))
+            return false;
+    }
+    return true;
+}
+
+template<std::size_t Axis, class Maxima, class Indices>
+bool check_maxima(matrix const& a, Maxima const& maxima, Indices const& indices) {
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        std::ptrdiff_t first = 0;
+        for (std::ptrdiff_t k = 1; k < n; ++k)
+            if (at<Axis>(a, i, k) > at<Axis>(a, i, first))
+                first = k;
+        if (maxima(i) != at<Axis>(a, i, first) || indices(i) != first)
+            return false;
+    }
+    return true;
+}
+
+template<std::size_t Axis, class Scan>
+bool check_running_sums(matrix const& a, Scan const& scan, double const relative) {
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        double expected = 0;
+        for (std::ptrdiff_t k = 0; k < n; ++k) {
+            expected += at<Axis>(a, i, k);
+            if (!near(at<Axis>(scan, i, k), expected, relative))
+                return false;
+        }
+    }
+    return true;
+}
+
+template<std::size_t Axis>
+bool axis_benchmarks(bench::runner& runner, matrix const& a) {
+    std::string const prefix = Axis == 1 ? "rows/" : "columns/";
+    double const items = static_cast<double>(a.size());
+    vector out(n);
+
+    hand_written_sum<Axis>(a, out);
+    bool ok = check(check_sums<Axis>(a, out, naive_tolerance), prefix + "sum_hand_written");
+    for (auto const& [mode, name] : {std::pair{summation::naive, "naive"}, {summation::pairwise, "pairwise"}, {summation::kahan, "kahan"}})
+        ok = check(check_sums<Axis>(a, sum_axis<Axis>(a, mode), mode == summation::naive ? naive_tolerance : tolerance),
+                   prefix + "sum_axis_" + name) && ok;
+    ok = check(check_maxima<Axis>(a, max_axis<Axis>(a), argmax_axis<Axis>(a)), prefix + "max_axis, argmax_axis") && ok;
+    ok = check(check_running_sums<Axis>(a, cumsum_axis<Axis>(a, summation::naive), naive_tolerance), prefix + "cumsum_axis_naive") && ok;
+    ok = check(check_running_sums<Axis>(a, cumsum_axis<Axis>(a), tolerance), prefix + "cumsum_axis_kahan") && ok;
+    if (!ok)
+        return false;
+
+    runner.run(prefix + "sum_hand_written", items, [&] { hand_written_sum<Axis>(a, out); bench::do_not_optimize(out.data()); });
+    for (auto const& [mode, name] : {std::pair{summation::naive, "naive"}, {summation::pairwise, "pairwise"}, {summation::kahan, "kahan"}})
+        runner.run(prefix + "sum_axis_" + name, items, [&] { bench::do_not_optimize(sum_axis<Axis>(a, mode).data()); });
+    runner.run(prefix + "max_axis", items, [&] { bench::do_not_optimize(max_axis<Axis>(a).data()); });
+    runner.run(prefix + "argmax_axis", items, [&] { bench::do_not_optimize(argmax_axis<Axis>(a).data()); });
+    runner.run(prefix + "cumsum_axis_naive", items, [&] { bench::do_not_optimize(cumsum_axis<Axis>(a, summation::naive).data()); });
+    runner.run(prefix + "cumsum_axis_kahan", items, [&] { bench::do_not_optimize(cumsum_axis<Axis>(a).data()); });
+    return true;
+}
+
+void summation_error() {
+    vector line(std::ptrdiff_t(1) << 24);
+    for (std::ptrdiff_t i = 0; i < line.size(); ++i)
+        line(i) = 0.1f;
+    double const exact = static_cast<double>(0.1f) * static_cast<double>(line.size());
+    for (auto const& [mode, name] : {std::pair{summation::naive, "naive"}, {summation::pairwise, "pairwise"}, {summation::kahan, "kahan"}}) {
+        double const sum = sum_axis<0>(line, mode)();
+        std::printf("relative error of %s sum over 2^24 elements: %.3g\n", name, (sum - exact) / exact);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    matrix a(n, n);
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            a(i, j) = static_cast<float>((i * 31 + j * 17) % 101) * 0.01f;
+    bool ok = axis_benchmarks<1>(runner, a);
+    ok = axis_benchmarks<0>(runner, a) && ok;
+    summation_error();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// 4096 products and elementwise updates of 8x8 float matrices, held as a
+// std::vector of mdarrays (one allocation and one call per matrix) and as a
+// batched_mdarray in member-major (outer) and interleaved order. Member
+// extents are dynamic in every case. "naive" is a triple loop per matrix;
+// "linalg_matmul" calls matmul once per matrix; "expression" assigns
+// a * b + 1 per matrix. Items are matrices. The batched results are checked
+// against the per-matrix loop before they are timed; exits with status 1 on
+// a mismatch.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../batched_mdarray.hpp"
+#include "../expression.hpp"
+#include "../linalg.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using matrix_extents = extents<dynamic_extent, dynamic_extent>;
+using matrix = basic_mdarray<float, matrix_extents, layout_right>;
+
+template<batch_order Order>
+using batch = batched_mdarray<float, matrix_extents, Order>;
+
+constexpr std::ptrdiff_t batch_size = 4096;
+constexpr std::ptrdiff_t n = 8;
+
+float value(std::ptrdiff_t const m, std::ptrdiff_t const i, std::ptrdiff_t const j, std::ptrdiff_t const salt) {
+    return static_cast<float>((m * salt + i * 3 + j * 5) % 7) * 0.25f;
+}
+
+void naive_matmul(matrix const& a, matrix const& b, matrix& c) {
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            c(i, j) = 0;
+        for (std::ptrdiff_t p = 0; p < n; ++p) {
+            float const aip = a(i, p);
+            for (std::ptrdiff_t j = 0; j < n; ++j)
+                c(i, j) += aip * b(p, j);
+        }
+    }
+}
+
+std::vector<matrix> make_matrices(std::ptrdiff_t const salt) {
+    std::vector<matrix> v;
+    v.reserve(batch_size);
+    for (std::ptrdiff_t m = 0; m < batch_size; ++m) {
+        v.emplace_back(n, n);
+        for (std::ptrdiff_t i = 0; i < n; ++i)
+            for (std::ptrdiff_t j = 0; j < n; ++j)
+                v.back()(i, j) = value(m, i, j, salt);
+    }
+    return v;
+}
+
+template<batch_order Order>
+batch<Order> make_batch(std::ptrdiff_t const salt) {
+    batch<Order> b(batch_size, n, n);
+    for (std::ptrdiff_t m = 0; m < batch_size; ++m)
+        for (std::ptrdiff_t i = 0; i < n; ++i)
+            for (std::ptrdiff_t j = 0; j < n; ++j)
+                b(m, i, j) = value(m, i, j, salt);
+    return b;
+}
+
+template<class Batch>
+bool same(std::vector<matrix> const& expected, Batch const& b) {
+    for (std::ptrdiff_t m = 0; m < batch_size; ++m)
+        for (std::ptrdiff_t i = 0; i < n; ++i)
+            for (std::ptrdiff_t j = 0; j < n; ++j)
+                if (expected[static_cast<std::size_t>(m)](i, j) != b(m, i, j))
+                    return false;
+    return true;
+}
+
+template<batch_order Order>
+bool batched_benchmarks(bench::runner& runner, std::string const& name, std::vector<matrix> const& product,
+                        std::vector<matrix> const& updated) {
+    batch<Order> const a = make_batch<Order>(1);
+    batch<Order> const b = make_batch<Order>(2);
+    batch<Order> c(batch_size, n, n);
+    double const items = static_cast<double>(batch_size);
+
+    batch_matmul(a, b, c);
+    bool ok = same(product, c);
+    batch_transform(a, b, c, [](float const x, float const y) { return x * y + 1.0f; });
+    ok = same(updated, c) && ok;
+    if (!ok)
+        return false;
+
+    runner.run("matmul/" + name + "/batch_matmul", items, [&] {
+        batch_matmul(a, b, c);
+        bench::do_not_optimize(c.data());
+    });
+    runner.run("elementwise/" + name + "/batch_transform", items, [&] {
+        batch_transform(a, b, c, [](float const x, float const y) { return x * y + 1.0f; });
+        bench::do_not_optimize(c.data());
+    });
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::vector<matrix> const a = make_matrices(1);
+    std::vector<matrix> const b = make_matrices(2);
+    std::vector<matrix> product = make_matrices(0);
+    std::vector<matrix> updated = make_matrices(0);
+    double const items = static_cast<double>(batch_size);
+
+    // References for the batched kernels, computed whether or not the
+    // per-matrix loops below are selected by --filter.
+    for (std::size_t m = 0; m < a.size(); ++m) {
+        naive_matmul(a[m], b[m], product[m]);
+        updated[m] = a[m] * b[m] + 1.0f;
+    }
+
+    runner.run("matmul/vector_of_mdarray/naive", items, [&] {
+        for (std::size_t m = 0; m < a.size(); ++m)
+            naive_matmul(a[m], b[m], product[m]);
+        bench::do_not_optimize(product.data());
+    });
+    runner.run("matmul/vector_of_mdarray/linalg_matmul", items, [&] {
+        for (std::size_t m = 0; m < a.size(); ++m)
+            matmul(a[m], b[m], product[m]);
+        bench::do_not_optimize(product.data());
+    });
+    runner.run("elementwise/vector_of_mdarray/expression", items, [&] {
+        for (std::size_t m = 0; m < a.size(); ++m)
+            updated[m] = a[m] * b[m] + 1.0f;
+        bench::do_not_optimize(updated.data());
+    });
+
+    bool ok = batched_benchmarks<batch_order::outer>(runner, "batched_outer", product, updated);
+    ok = batched_benchmarks<batch_order::interleaved>(runner, "batched_interleaved", product, updated) && ok;
+    return ok ? 0 : 1;
+}
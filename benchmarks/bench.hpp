@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A self-contained benchmark harness. Every benchmark executable accepts
+//
+//   --filter=<substring>   run only benchmarks whose name contains it
+//   --min-time=<seconds>   minimum measuring time per benchmark (default 0.2)
+//   --json=<path>          also write the results as JSON to <path>
+//
+// and prints a table of nanoseconds per item to stdout.
+
+namespace bench {
+
+template<class T>
+inline void do_not_optimize(T const& value) noexcept {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobber_memory() noexcept {
+    asm volatile("" : : : "memory");
+}
+
+// Runs `f` until at least `min_seconds` have elapsed and returns the average
+// time per call in nanoseconds and the number of calls measured.
+template<class F>
+std::pair<double, std::size_t> measure(F&& f, double const min_seconds) {
+    using clock = std::chrono::steady_clock;
+    f(); // warm-up
+    std::size_t iterations = 1;
+    for (;;) {
+        auto const start = clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            f();
+        std::chrono::duration<double> const elapsed = clock::now() - start;
+        if (elapsed.count() >= min_seconds)
+            return {elapsed.count() * 1e9 / static_cast<double>(iterations), iterations};
+        iterations *= 2;
+    }
+}
+
+struct result {
+    std::string name;
+    double ns_per_item = 0;
+    double items_per_call = 0;
+    std::size_t iterations = 0;
+};
+
+class runner {
+public:
+    runner(int const argc, char** const argv) {
+        for (int i = 1; i < argc; ++i) {
+            std::string const arg = argv[i];
+            if (arg.rfind("--filter=", 0) == 0)
+                filter_ = arg.substr(9);
+            else if (arg.rfind("--min-time=", 0) == 0)
+                min_seconds_ = std::atof(arg.c_str() + 11);
+            else if (arg.rfind("--json=", 0) == 0)
+                json_path_ = arg.substr(7);
+            else {
+                std::fprintf(stderr, "usage: %s [--filter=<substring>] [--min-time=<seconds>] [--json=<path>]\n", argv[0]);
+                std::exit(2);
+            }
+        }
+    }
+
+    runner(runner const&) = delete;
+    runner& operator=(runner const&) = delete;
+
+    ~runner() { write_json(); }
+
+    // Times `f`, which processes `items_per_call` items per call, and
+    // reports the cost per item.
+    template<class F>
+    void run(std::string const& name, double const items_per_call, F&& f) {
+        if (!filter_.empty() && name.find(filter_) == std::string::npos)
+            return;
+        auto const [ns, iterations] = measure(f, min_seconds_);
+        result r{name, ns / items_per_call, items_per_call, iterations};
+        std::printf("%-56s %12.3f ns/item\n", r.name.c_str(), r.ns_per_item);
+        std::fflush(stdout);
+        results_.push_back(std::move(r));
+    }
+
+private:
+    void write_json() const {
+        if (json_path_.empty())
+            return;
+        std::ofstream out(json_path_);
+        out << "{\n  \"context\": {\"compiler\": \"" << escape(compiler()) << "\", \"min_time_s\": " << min_seconds_ << "},\n";
+        out << "  \"benchmarks\": [\n";
+        for (std::size_t i = 0; i < results_.size(); ++i) {
+            auto const& r = results_[i];
+            out << "    {\"name\": \"" << escape(r.name) << "\", \"ns_per_item\": " << r.ns_per_item
+                << ", \"items_per_call\": " << r.items_per_call << ", \"iterations\": " << r.iterations << "}"
+                << (i + 1 < results_.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+    }
+
+    static std::string compiler() {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#else
+        return "unknown";
+#endif
+    }
+
+    static std::string escape(std::string const& s) {
+        std::string out;
+        for (char const c : s) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    std::string filter_;
+    std::string json_path_;
+    double min_seconds_ = 0.2;
+    std::vector<result> results_;
+};
+
+} // namespace bench
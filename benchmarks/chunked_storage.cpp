@@ -0,0 +1,99 @@
+// Sparse volumes: a 256^3 grid of which a few 32^3 blocks are written, dense
+// against chunked_container_policy over layout_tiled<16,16,16>, so that every
+// 4096-element chunk is one 16^3 tile. Covers creating and filling the volume,
+// re-reading the touched blocks and summing the whole volume.
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "../chunked_container_policy.hpp"
+#include "../mdarray.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using volume_extents = extents<dynamic_extent, dynamic_extent, dynamic_extent>;
+using volume_layout = layout_tiled<16, 16, 16>;
+
+constexpr std::ptrdiff_t volume_n = 256;
+constexpr std::ptrdiff_t block_n = 32;
+
+// Corners of the written blocks.
+constexpr std::array<std::array<std::ptrdiff_t, 3>, 6> block_origins = {{
+    {0, 0, 0}, {64, 32, 96}, {128, 128, 128}, {32, 192, 64}, {224, 224, 224}, {160, 64, 0},
+}};
+
+template<class F>
+void for_each_block_index(F&& f) {
+    for (auto const& o : block_origins)
+        for (std::ptrdiff_t i = o[0]; i < o[0] + block_n; ++i)
+            for (std::ptrdiff_t j = o[1]; j < o[1] + block_n; ++j)
+                for (std::ptrdiff_t k = o[2]; k < o[2] + block_n; ++k)
+                    f(i, j, k);
+}
+
+template<class MD>
+void write_blocks(MD& a) {
+    for_each_block_index([&](auto const i, auto const j, auto const k) { a(i, j, k) = static_cast<float>((i + j + k) % 5 + 1); });
+}
+
+template<class MD>
+double read_blocks(MD const& a) {
+    double s = 0;
+    for_each_block_index([&](auto const i, auto const j, auto const k) { s += a(i, j, k); });
+    return s;
+}
+
+template<class MD>
+double sum_volume(MD const& a) {
+    double s = 0;
+    for (std::ptrdiff_t i = 0; i < a.extent(0); ++i)
+        for (std::ptrdiff_t j = 0; j < a.extent(1); ++j)
+            for (std::ptrdiff_t k = 0; k < a.extent(2); ++k)
+                s += a(i, j, k);
+    return s;
+}
+
+template<class CP>
+void volume_benchmarks(bench::runner& runner, std::string const& name) {
+    using mdarray_type = basic_mdarray<float, volume_extents, volume_layout, CP>;
+    double const block_items = static_cast<double>(block_origins.size() * block_n * block_n * block_n);
+
+    runner.run(name + "/create_and_write_blocks", block_items, [&] {
+        mdarray_type a(volume_n, volume_n, volume_n);
+        write_blocks(a);
+        bench::do_not_optimize(a);
+    });
+
+    mdarray_type a(volume_n, volume_n, volume_n);
+    write_blocks(a);
+    runner.run(name + "/read_blocks", block_items, [&] { bench::do_not_optimize(read_blocks(a)); });
+    runner.run(name + "/sum_volume", static_cast<double>(a.size()), [&] { bench::do_not_optimize(sum_volume(a)); });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    volume_benchmarks<default_container_policy<float>>(runner, "sparse_256^3/dense");
+    volume_benchmarks<chunked_container_policy<float>>(runner, "sparse_256^3/chunked");
+
+    // Resident memory of the chunked volume, and the chunk-wise sum that
+    // skips untouched regions.
+    basic_mdarray<float, volume_extents, volume_layout, chunked_container_policy<float>> a(volume_n, volume_n, volume_n);
+    write_blocks(a);
+    runner.run("sparse_256^3/chunked/sum_resident_chunks", static_cast<double>(a.size()), [&] {
+        double s = 0;
+        a.container().for_each_resident_chunk([&](std::ptrdiff_t, float const* const p, std::size_t const n) {
+            for (std::size_t i = 0; i < n; ++i)
+                s += p[i];
+        });
+        bench::do_not_optimize(s);
+    });
+
+    chunked_statistics const stats = a.container().statistics();
+    std::printf("chunked resident: %zu of %zu chunks, %zu of %zu bytes\n", stats.resident_chunks, stats.total_chunks, stats.resident_bytes,
+                static_cast<std::size_t>(a.size()) * sizeof(float));
+}
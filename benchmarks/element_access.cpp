@@ -0,0 +1,66 @@
+// Per-element access cost of basic_mdarray::operator() against a raw pointer
+// walk over the same memory.
+
+#include <cstddef>
+
+#include "../mdarray.hpp"
+#include "bench.hpp"
+
+namespace {
+
+constexpr std::ptrdiff_t N = 12;
+
+template<class MDArray>
+double sum_rank4(MDArray const& a) {
+    double s = 0;
+    for (std::ptrdiff_t i = 0; i < a.extent(0); ++i)
+        for (std::ptrdiff_t j = 0; j < a.extent(1); ++j)
+            for (std::ptrdiff_t k = 0; k < a.extent(2); ++k)
+                for (std::ptrdiff_t l = 0; l < a.extent(3); ++l)
+                    s += a(i, j, k, l);
+    return s;
+}
+
+template<class MDArray>
+double sum_rank5(MDArray const& a) {
+    double s = 0;
+    for (std::ptrdiff_t i = 0; i < a.extent(0); ++i)
+        for (std::ptrdiff_t j = 0; j < a.extent(1); ++j)
+            for (std::ptrdiff_t k = 0; k < a.extent(2); ++k)
+                for (std::ptrdiff_t l = 0; l < a.extent(3); ++l)
+                    for (std::ptrdiff_t m = 0; m < a.extent(4); ++m)
+                        s += a(i, j, k, l, m);
+    return s;
+}
+
+double sum_raw(float const* p, std::ptrdiff_t const n) {
+    double s = 0;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        s += p[i];
+    return s;
+}
+
+template<class MDArray, class Sum>
+void run(bench::runner& runner, char const* name, MDArray const& a, Sum sum) {
+    runner.run(name, static_cast<double>(a.size()), [&] { bench::do_not_optimize(sum(a)); });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    using dyn4 = extents<dynamic_extent, dynamic_extent, dynamic_extent, dynamic_extent>;
+    using dyn5 = extents<dynamic_extent, dynamic_extent, dynamic_extent, dynamic_extent, dynamic_extent>;
+
+    basic_mdarray<float, extents<N, N, N, N>, layout_right> static4;
+    basic_mdarray<float, dyn4, layout_right> dynamic4(N, N, N, N);
+    basic_mdarray<float, extents<N, N, N, N, N>, layout_right> static5;
+    basic_mdarray<float, dyn5, layout_right> dynamic5(N, N, N, N, N);
+
+    bench::runner runner(argc, argv);
+    run(runner, "raw pointer rank-4", static4, [](auto const& a) { return sum_raw(a.data(), a.size()); });
+    run(runner, "mdarray rank-4 static extents", static4, [](auto const& a) { return sum_rank4(a); });
+    run(runner, "mdarray rank-4 dynamic extents", dynamic4, [](auto const& a) { return sum_rank4(a); });
+    run(runner, "raw pointer rank-5", static5, [](auto const& a) { return sum_raw(a.data(), a.size()); });
+    run(runner, "mdarray rank-5 static extents", static5, [](auto const& a) { return sum_rank5(a); });
+    run(runner, "mdarray rank-5 dynamic extents", dynamic5, [](auto const& a) { return sum_rank5(a); });
+}
@@ -0,0 +1,128 @@
+// Evaluation of c = x * y + z * 2 over 2048x2048 floats in layout_right for
+// three kinds of operands: contiguous arrays (the flat path), views that take
+// every other column of a wider array (the strided path), and a 1xN row and
+// an Nx1 column broadcast against a full array. "hand_written" is one loop
+// nest over operator(); "temporaries" materializes a new array for every
+// operator, as an eager library would; "fused" assigns the lazy expression.
+// Every result is checked against the hand-written loop before anything is
+// timed; exits with status 1 on a mismatch. Items are elements of c.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "../expression.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using matrix_extents = extents<dynamic_extent, dynamic_extent>;
+using matrix = basic_mdarray<float, matrix_extents, layout_right>;
+
+constexpr std::ptrdiff_t n = 2048;
+
+// Element (i, j) of `md`, reading index 0 of dimensions whose static extent
+// is 1, as the expression does.
+template<class MD>
+float element(MD const& md, std::ptrdiff_t const i, std::ptrdiff_t const j) {
+    return md(MD::static_extent(0) == 1 ? 0 : i, MD::static_extent(1) == 1 ? 0 : j);
+}
+
+template<class MD>
+void fill(MD& md, std::ptrdiff_t const salt) {
+    for (std::ptrdiff_t i = 0; i < md.extent(0); ++i)
+        for (std::ptrdiff_t j = 0; j < md.extent(1); ++j)
+            md(i, j) = static_cast<float>((i * 7 + j * salt) % 13);
+}
+
+template<class F>
+matrix materialize(F const& f) {
+    matrix t(n, n);
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            t(i, j) = f(i, j);
+    return t;
+}
+
+bool same(matrix const& a, matrix const& b) {
+    return std::equal(a.data(), a.data() + a.size(), b.data());
+}
+
+bool check(bool const ok, std::string const& what) {
+    if (!ok)
+        std::printf("    %s: result differs from the hand-written loop\n", what.c_str());
+    return ok;
+}
+
+template<class X, class Y, class Z>
+bool expression_benchmarks(bench::runner& runner, std::string const& name, X const& x, Y const& y, Z const& z) {
+    matrix c(n, n);
+    matrix expected(n, n);
+    double const items = static_cast<double>(c.size());
+
+    auto const hand_written = [&](matrix& out) {
+        for (std::ptrdiff_t i = 0; i < n; ++i)
+            for (std::ptrdiff_t j = 0; j < n; ++j)
+                out(i, j) = element(x, i, j) * element(y, i, j) + element(z, i, j) * 2.0f;
+    };
+    auto const temporaries = [&] {
+        matrix const xy = materialize([&](std::ptrdiff_t i, std::ptrdiff_t j) { return element(x, i, j) * element(y, i, j); });
+        matrix const z2 = materialize([&](std::ptrdiff_t i, std::ptrdiff_t j) { return element(z, i, j) * 2.0f; });
+        c = materialize([&](std::ptrdiff_t i, std::ptrdiff_t j) { return xy(i, j) + z2(i, j); });
+    };
+    auto const fused = [&] { c = x * y + z * 2.0f; };
+
+    hand_written(expected);
+    std::fill_n(c.data(), c.size(), -1.0f);
+    temporaries();
+    bool ok = check(same(expected, c), name + "/temporaries");
+    std::fill_n(c.data(), c.size(), -1.0f);
+    fused();
+    ok = check(same(expected, c), name + "/fused") && ok;
+    if (!ok)
+        return false;
+
+    runner.run(name + "/hand_written", items, [&] {
+        hand_written(c);
+        bench::do_not_optimize(c.data());
+    });
+    runner.run(name + "/temporaries", items, [&] {
+        temporaries();
+        bench::do_not_optimize(c.data());
+    });
+    runner.run(name + "/fused", items, [&] {
+        fused();
+        bench::do_not_optimize(c.data());
+    });
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+
+    matrix a(n, n);
+    matrix b(n, n);
+    matrix d(n, n);
+    fill(a, 3);
+    fill(b, 5);
+    fill(d, 11);
+    bool ok = expression_benchmarks(runner, "contiguous", a, b, d);
+
+    matrix wide_a(n, 2 * n);
+    matrix wide_b(n, 2 * n);
+    fill(wide_a, 3);
+    fill(wide_b, 5);
+    auto const sa = submdarray(wide_a, full_extent, strided_slice{0, 2 * n, 2});
+    auto const sb = submdarray(wide_b, full_extent, strided_slice{1, 2 * n - 1, 2});
+    ok = expression_benchmarks(runner, "strided_view", sa, sb, d) && ok;
+
+    basic_mdarray<float, extents<1, dynamic_extent>, layout_right> row(n);
+    basic_mdarray<float, extents<dynamic_extent, 1>, layout_right> column(n);
+    fill(row, 5);
+    fill(column, 11);
+    ok = expression_benchmarks(runner, "broadcast", a, row, column) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+// Element access through 32-bit and 64-bit index types on a 256^3 float
+// array in layout_right. The loops use the array's index_type, so with
+// int32_t the offsets are computed in 32-bit registers. "gather" sums the
+// elements named by a shuffled table of index triples, which is half the
+// size with int32_t. Items are elements. Also prints the size of the
+// extents, mappings, views and index triples of both index types.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../mdarray.hpp"
+#include "bench.hpp"
+
+namespace {
+
+template<class I>
+using volume_extents = basic_extents<I, dynamic_extent, dynamic_extent, dynamic_extent>;
+
+template<class I>
+using volume = basic_mdarray<float, volume_extents<I>, layout_right>;
+
+constexpr std::ptrdiff_t n = 256;
+
+template<class MD>
+double sum_rows(MD const& a) {
+    using index_type = typename MD::index_type;
+    double s = 0;
+    for (index_type i = 0; i < a.extent(0); ++i)
+        for (index_type j = 0; j < a.extent(1); ++j)
+            for (index_type k = 0; k < a.extent(2); ++k)
+                s += a(i, j, k);
+    return s;
+}
+
+template<class MD>
+double sum_columns(MD const& a) {
+    using index_type = typename MD::index_type;
+    double s = 0;
+    for (index_type k = 0; k < a.extent(2); ++k)
+        for (index_type j = 0; j < a.extent(1); ++j)
+            for (index_type i = 0; i < a.extent(0); ++i)
+                s += a(i, j, k);
+    return s;
+}
+
+template<class MD>
+double gather(MD const& a, std::vector<std::array<typename MD::index_type, 3>> const& indices) {
+    double s = 0;
+    for (auto const& idx : indices)
+        s += a(idx);
+    return s;
+}
+
+template<class I>
+void index_type_benchmarks(bench::runner& runner, std::string const& name) {
+    volume<I> a(n, n, n);
+    for (std::ptrdiff_t i = 0; i < a.size(); ++i)
+        a.data()[i] = static_cast<float>(i % 7);
+
+    std::vector<std::array<I, 3>> indices;
+    indices.reserve(static_cast<std::size_t>(a.size()));
+    for (I i = 0; i < n; ++i)
+        for (I j = 0; j < n; ++j)
+            for (I k = 0; k < n; ++k)
+                indices.push_back({i, j, k});
+    std::shuffle(indices.begin(), indices.end(), std::mt19937_64(42));
+
+    double const items = static_cast<double>(a.size());
+    runner.run("rows/" + name, items, [&] { bench::do_not_optimize(sum_rows(a)); });
+    runner.run("columns/" + name, items, [&] { bench::do_not_optimize(sum_columns(a)); });
+    runner.run("gather/" + name, items, [&] { bench::do_not_optimize(gather(a, indices)); });
+}
+
+template<class I>
+void print_sizes(char const* name) {
+    using mapping = layout_right::mapping<volume_extents<I>>;
+    using view = basic_mdarray_view<float, volume_extents<I>, layout_right>;
+    std::printf("%-9s extents %2zu B, layout_right mapping %2zu B, layout_stride mapping %2zu B, view %2zu B, index triple %2zu B\n", name,
+                sizeof(volume_extents<I>), sizeof(mapping), sizeof(layout_stride::mapping<volume_extents<I>>), sizeof(view),
+                sizeof(std::array<I, 3>));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    print_sizes<std::int32_t>("int32_t");
+    print_sizes<std::ptrdiff_t>("ptrdiff_t");
+    index_type_benchmarks<std::int32_t>(runner, "int32_t");
+    index_type_benchmarks<std::ptrdiff_t>(runner, "ptrdiff_t");
+}
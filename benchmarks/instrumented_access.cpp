@@ -0,0 +1,91 @@
+// Row-order, column-order and gathered traversal of a 1024x1024 float array
+// in layout_right and in layout_instrumented<layout_right>. Built twice:
+// instrumented_access without MDARRAY_INSTRUMENT, where both layouts are the
+// same type and the timings must match, and instrumented_access_checked with
+// it, which measures the cost of the bounds checks and access counting and
+// prints the access report (rows sequential, columns strided, gather
+// random). Items are elements.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../instrumented_layout.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using grid_extents = extents<dynamic_extent, dynamic_extent>;
+
+template<class Layout>
+using grid = basic_mdarray<float, grid_extents, Layout>;
+
+#if !defined(MDARRAY_INSTRUMENT)
+static_assert(std::is_same_v<grid<layout_instrumented<layout_right>>, grid<layout_right>>, "");
+#endif
+
+constexpr std::ptrdiff_t n = 1024;
+
+template<class MD>
+float sum_rows(MD const& a) {
+    float s = 0;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            s += a(i, j);
+    return s;
+}
+
+template<class MD>
+float sum_columns(MD const& a) {
+    float s = 0;
+    for (std::ptrdiff_t j = 0; j < n; ++j)
+        for (std::ptrdiff_t i = 0; i < n; ++i)
+            s += a(i, j);
+    return s;
+}
+
+template<class MD>
+float gather(MD const& a, std::vector<std::array<std::ptrdiff_t, 2>> const& idx) {
+    float s = 0;
+    for (auto const& ij : idx)
+        s += a(ij);
+    return s;
+}
+
+template<class Layout>
+void access_benchmarks(bench::runner& runner, std::string const& name, std::vector<std::array<std::ptrdiff_t, 2>> const& idx) {
+    grid<Layout> a(n, n);
+    std::iota(a.data(), a.data() + a.size(), 0.0f);
+    set_access_label(a, name.c_str());
+    double const items = static_cast<double>(n * n);
+
+    runner.run("rows/" + name, items, [&] { bench::do_not_optimize(sum_rows(a)); });
+    runner.run("columns/" + name, items, [&] { bench::do_not_optimize(sum_columns(a)); });
+    runner.run("gather/" + name, items, [&] { bench::do_not_optimize(gather(a, idx)); });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+#if defined(MDARRAY_INSTRUMENT)
+    std::printf("instrumentation: on\n");
+#else
+    std::printf("instrumentation: off\n");
+#endif
+
+    std::vector<std::array<std::ptrdiff_t, 2>> idx(static_cast<std::size_t>(n * n));
+    for (std::size_t k = 0; k < idx.size(); ++k)
+        idx[k] = {static_cast<std::ptrdiff_t>(k) / n, static_cast<std::ptrdiff_t>(k) % n};
+    std::shuffle(idx.begin(), idx.end(), std::mt19937_64(7));
+
+    access_benchmarks<layout_right>(runner, "layout_right", idx);
+    access_benchmarks<layout_instrumented<layout_right>>(runner, "instrumented", idx);
+    write_access_report(stdout);
+}
@@ -0,0 +1,134 @@
+// Conversion of layout_left arrays to layout_right for float and double
+// (4x4 and 2x2 SSE tile transposes) and int16_t (scalar tiles). Extents are
+// odd and not multiples of any tile size. "naive" copies element by element
+// in the destination's order; "layout_convert" uses the cache-oblivious
+// transpose. "transpose_in_place" transposes a square matrix. Every result,
+// and the conversion of a square rvalue that reuses its storage, is checked
+// against the source before anything is timed; exits with status 1 on a
+// mismatch. Items are elements.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include "../layout_convert.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using matrix_extents = extents<dynamic_extent, dynamic_extent>;
+using volume_extents = extents<dynamic_extent, dynamic_extent, dynamic_extent>;
+
+template<class T, class E, class Layout>
+using array = basic_mdarray<T, E, Layout>;
+
+constexpr std::ptrdiff_t rows = 1021;
+constexpr std::ptrdiff_t cols = 1533;
+constexpr std::ptrdiff_t square = 1021;
+
+// Calls f(i0, ..., iN) for every index of `md`, last index fastest.
+template<class MD, class F>
+void for_all(MD const& md, F&& f) {
+    tile_region<MD::rank()> all;
+    for (std::size_t r = 0; r < MD::rank(); ++r)
+        all.extents[r] = md.extent(r);
+    for_each_index_in(all, std::forward<F>(f));
+}
+
+template<class T, class MD>
+void fill(MD& a) {
+    for_all(a, [&](auto... is) {
+        std::ptrdiff_t v = 0;
+        ((v = v * 7919 + is), ...);
+        a(is...) = static_cast<T>(v % 32749);
+    });
+}
+
+template<class A, class B>
+bool same(A const& a, B const& b) {
+    bool ok = a.extents() == b.extents();
+    if (ok)
+        for_all(a, [&](auto... is) { ok = ok && a(is...) == b(is...); });
+    return ok;
+}
+
+template<class A, class B>
+bool transposed(A const& a, B const& b) {
+    for (std::ptrdiff_t i = 0; i < a.extent(0); ++i)
+        for (std::ptrdiff_t j = 0; j < a.extent(1); ++j)
+            if (a(i, j) != b(j, i))
+                return false;
+    return true;
+}
+
+bool check(bool const ok, std::string const& what) {
+    if (!ok)
+        std::printf("    %s: result differs from the source\n", what.c_str());
+    return ok;
+}
+
+template<class T, class E>
+bool convert_benchmarks(bench::runner& runner, std::string const& name, E const& e) {
+    array<T, E, layout_left> a{layout_left::mapping<E>(e)};
+    fill<T>(a);
+    array<T, E, layout_right> b{layout_right::mapping<E>(e)};
+    double const items = static_cast<double>(a.size());
+
+    bool ok = check(same(a, layout_convert<layout_right>(a)), name + "/layout_convert");
+    copy(a, b);
+    ok = check(same(a, b), name + "/copy") && ok;
+    if (!ok)
+        return false;
+
+    runner.run(name + "/naive", items, [&] {
+        for_all(b, [&](auto... is) { b(is...) = a(is...); });
+        bench::do_not_optimize(b.data());
+    });
+    runner.run(name + "/layout_convert", items, [&] {
+        copy(a, b);
+        bench::do_not_optimize(b.data());
+    });
+    return true;
+}
+
+template<class T>
+bool square_benchmarks(bench::runner& runner, std::string const& name) {
+    array<T, matrix_extents, layout_left> original(square, square);
+    fill<T>(original);
+    array<T, matrix_extents, layout_left> a = layout_convert<layout_left>(original);
+    double const items = static_cast<double>(a.size());
+
+    transpose_in_place(a);
+    bool ok = check(transposed(original, a), name + "/transpose_in_place");
+    transpose_in_place(a);
+    ok = check(same(original, a), name + "/transpose_in_place twice") && ok;
+    auto const converted = layout_convert<layout_right>(std::move(a));
+    ok = check(same(original, converted), name + "/layout_convert_rvalue") && ok;
+    if (!ok)
+        return false;
+
+    array<T, matrix_extents, layout_left> c = layout_convert<layout_left>(original);
+    runner.run(name + "/transpose_in_place", items, [&] {
+        transpose_in_place(c);
+        bench::do_not_optimize(c.data());
+    });
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    matrix_extents const matrix(rows, cols);
+    volume_extents const volume(37, 61, 53);
+
+    bool ok = convert_benchmarks<float>(runner, "matrix/float", matrix);
+    ok = convert_benchmarks<double>(runner, "matrix/double", matrix) && ok;
+    ok = convert_benchmarks<std::int16_t>(runner, "matrix/int16", matrix) && ok;
+    ok = convert_benchmarks<float>(runner, "volume/float", volume) && ok;
+    ok = square_benchmarks<float>(runner, "square/float") && ok;
+    ok = square_benchmarks<double>(runner, "square/double") && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+// Neighbor stencils (2D 5-point, 3D 7-point) over layout_right,
+// layout_tiled and layout_morton, walked in row-major order, in column-major
+// order (first index fastest) and tile by tile.
+//
+// A row-major walk is the best case for layout_right: the three planes of
+// the 256^3 grid a stencil touches (768 KiB) stay in L2, so its neighbors
+// already hit the cache, and the tiled layouts only add index arithmetic
+// (a shift, a mask and two multiplies per dimension and access). Their
+// locality pays off when the walk does not follow the rows: column by
+// column, layout_right moves 16 KiB, and to a new page, per step of the
+// 4096x4096 grid, while layout_tiled and layout_morton stay inside a block
+// for most steps. Every walk is checked against the row-major walk over
+// layout_right before it is timed; exits with status 1 on a mismatch.
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "../mdarray.hpp"
+#include "bench.hpp"
+
+namespace {
+
+template<class MD>
+double stencil_at(MD const& a, std::ptrdiff_t const i, std::ptrdiff_t const j) {
+    return a(i - 1, j) + a(i + 1, j) + a(i, j - 1) + a(i, j + 1) - 4 * a(i, j);
+}
+
+template<class MD>
+double stencil_at(MD const& a, std::ptrdiff_t const i, std::ptrdiff_t const j, std::ptrdiff_t const k) {
+    return a(i - 1, j, k) + a(i + 1, j, k) + a(i, j - 1, k) + a(i, j + 1, k) + a(i, j, k - 1) + a(i, j, k + 1) - 6 * a(i, j, k);
+}
+
+template<class MD>
+bool is_interior(MD const& a, std::ptrdiff_t const i, std::ptrdiff_t const j) {
+    return i > 0 && j > 0 && i + 1 < a.extent(0) && j + 1 < a.extent(1);
+}
+
+template<class MD>
+bool is_interior(MD const& a, std::ptrdiff_t const i, std::ptrdiff_t const j, std::ptrdiff_t const k) {
+    return i > 0 && j > 0 && k > 0 && i + 1 < a.extent(0) && j + 1 < a.extent(1) && k + 1 < a.extent(2);
+}
+
+template<class MD>
+double row_major_walk(MD const& a) {
+    tile_region<MD::rank()> all;
+    for (std::size_t r = 0; r < MD::rank(); ++r)
+        all.extents[r] = a.extent(r);
+    double s = 0;
+    for_each_index_in(all, [&](auto... i) {
+        if (is_interior(a, i...))
+            s += stencil_at(a, i...);
+    });
+    return s;
+}
+
+template<class MD>
+double column_major_walk(MD const& a) {
+    double s = 0;
+    if constexpr (MD::rank() == 2) {
+        for (std::ptrdiff_t j = 1; j + 1 < a.extent(1); ++j)
+            for (std::ptrdiff_t i = 1; i + 1 < a.extent(0); ++i)
+                s += stencil_at(a, i, j);
+    }
+    else {
+        for (std::ptrdiff_t k = 1; k + 1 < a.extent(2); ++k)
+            for (std::ptrdiff_t j = 1; j + 1 < a.extent(1); ++j)
+                for (std::ptrdiff_t i = 1; i + 1 < a.extent(0); ++i)
+                    s += stencil_at(a, i, j, k);
+    }
+    return s;
+}
+
+template<class MD>
+double tile_walk(MD const& a, std::array<std::ptrdiff_t, MD::rank()> const& tile_extents) {
+    double s = 0;
+    for_each_tile(a, tile_extents, [&](auto const& tile) {
+        for_each_index_in(tile, [&](auto... i) {
+            if (is_interior(a, i...))
+                s += stencil_at(a, i...);
+        });
+    });
+    return s;
+}
+
+template<class Layout, class Extents>
+basic_mdarray<float, Extents, Layout> make_grid(Extents const& e) {
+    basic_mdarray<float, Extents, Layout> a{typename Layout::template mapping<Extents>(e)};
+    tile_region<Extents::rank()> all;
+    for (std::size_t r = 0; r < Extents::rank(); ++r)
+        all.extents[r] = a.extent(r);
+    std::ptrdiff_t n = 0;
+    for_each_index_in(all, [&](auto... i) { a(i...) = static_cast<float>(n++ % 11); });
+    return a;
+}
+
+bool check(double const sum, double const expected, std::string const& what) {
+    // The elements are small integers, so every walk sums exactly.
+    if (sum != expected)
+        std::printf("    %s: stencil sum %g differs from %g\n", what.c_str(), sum, expected);
+    return sum == expected;
+}
+
+template<class Layout, class Extents>
+bool stencil_benchmarks(bench::runner& runner, std::string const& name, std::array<std::ptrdiff_t, Extents::rank()> const& tile, Extents const& e) {
+    auto const a = make_grid<Layout>(e);
+    double const expected = row_major_walk(make_grid<layout_right>(e));
+    bool ok = check(row_major_walk(a), expected, name + "/row_major_walk");
+    ok = check(column_major_walk(a), expected, name + "/column_major_walk") && ok;
+    ok = check(tile_walk(a, tile), expected, name + "/tile_walk") && ok;
+    if (!ok)
+        return false;
+
+    double const items = static_cast<double>(a.size());
+    runner.run(name + "/row_major_walk", items, [&] { bench::do_not_optimize(row_major_walk(a)); });
+    runner.run(name + "/column_major_walk", items, [&] { bench::do_not_optimize(column_major_walk(a)); });
+    runner.run(name + "/tile_walk", items, [&] { bench::do_not_optimize(tile_walk(a, tile)); });
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+
+    using E2 = extents<dynamic_extent, dynamic_extent>;
+    E2 const grid2(4096, 4096);
+    std::array<std::ptrdiff_t, 2> const tile2 = {16, 16};
+    bool ok = stencil_benchmarks<layout_right>(runner, "2d_4096x4096/layout_right", tile2, grid2);
+    ok = stencil_benchmarks<layout_tiled<16, 16>>(runner, "2d_4096x4096/layout_tiled<16,16>", tile2, grid2) && ok;
+    ok = stencil_benchmarks<layout_morton>(runner, "2d_4096x4096/layout_morton", tile2, grid2) && ok;
+
+    using E3 = extents<dynamic_extent, dynamic_extent, dynamic_extent>;
+    E3 const grid3(256, 256, 256);
+    std::array<std::ptrdiff_t, 3> const tile3 = {8, 8, 8};
+    ok = stencil_benchmarks<layout_right>(runner, "3d_256^3/layout_right", tile3, grid3) && ok;
+    ok = stencil_benchmarks<layout_tiled<8, 8, 8>>(runner, "3d_256^3/layout_tiled<8,8,8>", tile3, grid3) && ok;
+    ok = stencil_benchmarks<layout_morton>(runner, "3d_256^3/layout_morton", tile3, grid3) && ok;
+    return ok ? 0 : 1;
+}
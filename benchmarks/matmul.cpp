@@ -0,0 +1,133 @@
+// matmul on square and skinny shapes for float, double and int, against a
+// naive triple loop and, when the build found a CBLAS, the system BLAS.
+// Items are multiply-adds, so ns/item is the inverse of GMAC/s. The inputs
+// are small integers, so every product is exact; each method's result is
+// compared with the naive product before it is timed, and the benchmark
+// exits with status 1 on a mismatch.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+
+#include "../linalg.hpp"
+#include "bench.hpp"
+
+#if defined(MDARRAY_BENCH_CBLAS)
+#include <cblas.h>
+#endif
+
+namespace {
+
+using matrix_extents = extents<dynamic_extent, dynamic_extent>;
+
+template<class T>
+using matrix = basic_mdarray<T, matrix_extents, layout_right>;
+
+template<class T>
+void naive_matmul(matrix<T> const& a, matrix<T> const& b, matrix<T>& c) {
+    for (std::ptrdiff_t i = 0; i < c.extent(0); ++i) {
+        for (std::ptrdiff_t j = 0; j < c.extent(1); ++j)
+            c(i, j) = T{};
+        for (std::ptrdiff_t p = 0; p < a.extent(1); ++p) {
+            T const aip = a(i, p);
+            for (std::ptrdiff_t j = 0; j < c.extent(1); ++j)
+                c(i, j) += aip * b(p, j);
+        }
+    }
+}
+
+template<class T>
+void fill(matrix<T>& a) {
+    for (std::ptrdiff_t i = 0; i < a.extent(0); ++i)
+        for (std::ptrdiff_t j = 0; j < a.extent(1); ++j)
+            a(i, j) = static_cast<T>((i * 7 + j * 3) % 5);
+}
+
+template<class T>
+bool check(matrix<T> const& expected, matrix<T> const& c, std::string const& what) {
+    for (std::ptrdiff_t i = 0; i < c.extent(0); ++i)
+        for (std::ptrdiff_t j = 0; j < c.extent(1); ++j)
+            if (c(i, j) != expected(i, j)) {
+                std::printf("    %s: result differs from the naive product at (%td, %td)\n", what.c_str(), i, j);
+                return false;
+            }
+    return true;
+}
+
+template<class T>
+bool matmul_benchmarks(bench::runner& runner, std::string const& type, std::ptrdiff_t const m, std::ptrdiff_t const n, std::ptrdiff_t const k) {
+    matrix<T> a(m, k);
+    matrix<T> b(k, n);
+    matrix<T> c(m, n);
+    matrix<T> expected(m, n);
+    fill(a);
+    fill(b);
+    naive_matmul(a, b, expected);
+
+    std::string const prefix = "matmul/" + type + "/" + std::to_string(m) + "x" + std::to_string(n) + "x" + std::to_string(k) + "/";
+    double const items = static_cast<double>(m) * static_cast<double>(n) * static_cast<double>(k);
+
+    if (items <= 1 << 27)
+        runner.run(prefix + "naive", items, [&] { naive_matmul(a, b, c); bench::do_not_optimize(c.data()); });
+    // Poisons c before every checked call, so a stale result cannot pass.
+    auto const poison = [&] { std::fill_n(c.data(), c.size(), T{-1}); };
+
+    poison();
+    matmul(a, b, c);
+    bool ok = check(expected, c, prefix + "matmul");
+    runner.run(prefix + "matmul", items, [&] { matmul(a, b, c); bench::do_not_optimize(c.data()); });
+
+    // Same product with A stored column-major: read through its strides.
+    basic_mdarray<T, matrix_extents, layout_left> a_left(m, k);
+    for (std::ptrdiff_t i = 0; i < m; ++i)
+        for (std::ptrdiff_t p = 0; p < k; ++p)
+            a_left(i, p) = a(i, p);
+    poison();
+    matmul(a_left, b, c);
+    ok = check(expected, c, prefix + "matmul_a_layout_left") && ok;
+    runner.run(prefix + "matmul_a_layout_left", items, [&] { matmul(a_left, b, c); bench::do_not_optimize(c.data()); });
+
+#if defined(MDARRAY_BENCH_CBLAS)
+    auto const mi = static_cast<int>(m);
+    auto const ni = static_cast<int>(n);
+    auto const ki = static_cast<int>(k);
+    if constexpr (std::is_same_v<T, float>) {
+        auto const sgemm = [&] { cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, mi, ni, ki, 1.0f, a.data(), ki, b.data(), ni, 0.0f, c.data(), ni); };
+        poison();
+        sgemm();
+        ok = check(expected, c, prefix + "cblas") && ok;
+        runner.run(prefix + "cblas", items, sgemm);
+    }
+    else if constexpr (std::is_same_v<T, double>) {
+        auto const dgemm = [&] { cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, mi, ni, ki, 1.0, a.data(), ki, b.data(), ni, 0.0, c.data(), ni); };
+        poison();
+        dgemm();
+        ok = check(expected, c, prefix + "cblas") && ok;
+        runner.run(prefix + "cblas", items, dgemm);
+    }
+#endif
+    return ok;
+}
+
+template<class T>
+bool shape_benchmarks(bench::runner& runner, std::string const& type) {
+    bool ok = matmul_benchmarks<T>(runner, type, 256, 256, 256);
+    ok = matmul_benchmarks<T>(runner, type, 1024, 1024, 1024) && ok;
+    ok = matmul_benchmarks<T>(runner, type, 4096, 32, 1024) && ok; // tall-skinny
+    ok = matmul_benchmarks<T>(runner, type, 32, 4096, 1024) && ok; // short-wide
+    ok = matmul_benchmarks<T>(runner, type, 1024, 1024, 16) && ok; // low inner dimension
+    ok = matmul_benchmarks<T>(runner, type, 257, 131, 67) && ok;   // no dimension a multiple of a block
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    bool ok = shape_benchmarks<float>(runner, "float");
+    ok = shape_benchmarks<double>(runner, "double") && ok;
+    ok = shape_benchmarks<int>(runner, "int") && ok;
+    return ok ? 0 : 1;
+}
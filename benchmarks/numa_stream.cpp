@@ -0,0 +1,82 @@
+// STREAM-style bandwidth (copy, scale, add, triad) over 64 MiB arrays of
+// doubles, allocated with the default policy (value-initialized on the
+// calling thread) and with numa_container_policy (initialized by the pool,
+// first-touch or interleaved). The kernels run on the global pool with the
+// chunking of the parallel algorithms. On a single-node machine all
+// placements should perform alike. Items are elements; "construct" also
+// times the allocation and initialization of one array. Exits with status 1
+// if a kernel produces a wrong result.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "../numa_container_policy.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using vector_extents = extents<dynamic_extent>;
+constexpr std::ptrdiff_t n = std::ptrdiff_t(8) << 20;
+
+template<class F>
+void parallel_chunks(F&& f) {
+    thread_pool& pool = thread_pool::global();
+    std::size_t const chunks = std::min<std::size_t>(n, pool.size() * detail::tiles_per_thread);
+    pool.parallel_for(chunks, [&](std::size_t const c) {
+        f(static_cast<std::ptrdiff_t>(c * n / chunks), static_cast<std::ptrdiff_t>((c + 1) * n / chunks));
+    });
+}
+
+template<class Policy>
+bool stream_benchmarks(bench::runner& runner, std::string const& name, Policy const& policy) {
+    using array = basic_mdarray<double, vector_extents, layout_right, Policy>;
+    auto const make = [&] { return array(layout_right::mapping<vector_extents>(vector_extents(n)), policy); };
+    double const items = static_cast<double>(n);
+
+    runner.run("construct/" + name, items, [&] { bench::do_not_optimize(make().data()); });
+
+    array a = make();
+    array b = make();
+    array c = make();
+    double* const pa = a.data();
+    double* const pb = b.data();
+    double* const pc = c.data();
+    std::fill(pa, pa + n, 1.0);
+    std::fill(pb, pb + n, 2.0);
+
+    double const s = 3.0;
+    auto const copy = [&] { parallel_chunks([&](std::ptrdiff_t const f, std::ptrdiff_t const l) { for (std::ptrdiff_t i = f; i < l; ++i) pc[i] = pa[i]; }); };
+    auto const scale = [&] { parallel_chunks([&](std::ptrdiff_t const f, std::ptrdiff_t const l) { for (std::ptrdiff_t i = f; i < l; ++i) pb[i] = s * pc[i]; }); };
+    auto const add = [&] { parallel_chunks([&](std::ptrdiff_t const f, std::ptrdiff_t const l) { for (std::ptrdiff_t i = f; i < l; ++i) pc[i] = pa[i] + pb[i]; }); };
+    auto const triad = [&] { parallel_chunks([&](std::ptrdiff_t const f, std::ptrdiff_t const l) { for (std::ptrdiff_t i = f; i < l; ++i) pa[i] = pb[i] + s * pc[i]; }); };
+    runner.run("copy/" + name, items, copy);
+    runner.run("scale/" + name, items, scale);
+    runner.run("add/" + name, items, add);
+    runner.run("triad/" + name, items, triad);
+
+    // One more pass from a = 1: c = 1, b = 3, c = 4, a = 15.
+    parallel_chunks([&](std::ptrdiff_t const f, std::ptrdiff_t const l) { std::fill(pa + f, pa + l, 1.0); });
+    copy();
+    scale();
+    add();
+    triad();
+    bool ok = true;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        ok = ok && pa[i] == 15.0 && pb[i] == 3.0 && pc[i] == 4.0;
+    if (!ok)
+        std::printf("    %s: wrong result\n", name.c_str());
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::printf("NUMA nodes: %zu, threads: %zu\n", numa_node_count(), thread_pool::global().size());
+    bool ok = stream_benchmarks(runner, "default", default_container_policy<double>{});
+    ok = stream_benchmarks(runner, "numa_first_touch", numa_container_policy<double>{}) && ok;
+    ok = stream_benchmarks(runner, "numa_interleave", numa_container_policy<double>(numa_placement::interleave)) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Streams a 256 MiB file-backed array through a compute kernel, slab by slab,
+// starting from a cold page cache each time. "load_process_store" faults
+// each slab in as the kernel touches it, so the disk and the CPU take turns;
+// "prefetch" overlaps reading the next slab and writing back the previous
+// one with the kernel. The scratch file is created in the working directory.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../mmap_container_policy.hpp"
+#include "../streaming.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using volume_extents = extents<dynamic_extent, dynamic_extent, dynamic_extent>;
+using file_array = basic_mdarray<float, volume_extents, layout_right, mmap_container_policy<float>>;
+
+constexpr char const* scratch_path = "out_of_core_streaming.tmp";
+constexpr std::ptrdiff_t planes = 256;
+constexpr std::ptrdiff_t plane_n = 512;
+
+file_array open_scratch() {
+    return file_array(layout_right::mapping<volume_extents>(volume_extents(planes, plane_n, plane_n)),
+                      mmap_container_policy<float>(scratch_path, mmap_mode::read_write));
+}
+
+// Drops the file's clean pages from the page cache so the next pass reads
+// from disk.
+void evict_page_cache() {
+    int const fd = ::open(scratch_path, O_RDONLY);
+    if (fd >= 0) {
+        ::fdatasync(fd);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+}
+
+// A handful of flops per element, about the cost of a small stencil.
+template<class View>
+void kernel(View& slab) {
+    for (std::ptrdiff_t i = 0; i < slab.extent(0); ++i)
+        for (std::ptrdiff_t j = 0; j < slab.extent(1); ++j)
+            for (std::ptrdiff_t k = 0; k < slab.extent(2); ++k) {
+                float x = slab(i, j, k);
+                for (int r = 0; r < 2; ++r)
+                    x = std::sqrt(x * x + 1.0f) * 0.5f;
+                slab(i, j, k) = x;
+            }
+}
+
+void streaming_benchmarks(bench::runner& runner, std::size_t const slab_bytes) {
+    double const items = static_cast<double>(planes * plane_n * plane_n);
+    std::string const suffix = "/slab_" + std::to_string(slab_bytes >> 20) + "MiB";
+
+    for (bool const prefetch : {false, true}) {
+        stream_options options;
+        options.slab_bytes = slab_bytes;
+        options.prefetch = prefetch;
+        stream_statistics last;
+        runner.run(std::string("stream_256MiB/") + (prefetch ? "prefetch" : "load_process_store") + suffix, items, [&] {
+            evict_page_cache();
+            file_array a = open_scratch();
+            last = for_each_slab(a, [](auto& slab) { kernel(slab); }, options);
+        });
+        std::printf("    last pass: %zu slabs, %.3f s compute, %.3f s waiting for I/O\n", last.slabs, last.compute_seconds, last.io_wait_seconds);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    {
+        file_array a = open_scratch();
+        for_each_slab(a, [](auto& slab) {
+            float* const p = slab.data();
+            for (std::ptrdiff_t i = 0; i < slab.size(); ++i)
+                p[i] = static_cast<float>(i % 7);
+        });
+    }
+    streaming_benchmarks(runner, std::size_t(4) << 20);
+    streaming_benchmarks(runner, std::size_t(32) << 20);
+    ::unlink(scratch_path);
+}
@@ -0,0 +1,56 @@
+// Column traversal of layout_right grids with power-of-two row lengths,
+// unpadded against layout_right_padded. Without padding every element of a
+// column falls into the same few cache sets.
+
+#include <cstddef>
+#include <string>
+
+#include "../mdarray.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using grid_extents = extents<dynamic_extent, dynamic_extent>;
+
+// Walks the grid column by column; each cache line fetched for a column is
+// reused by the following columns only if the whole column stays cached.
+template<class MD>
+double sum_columns(MD const& a) {
+    double s = 0;
+    for (std::ptrdiff_t j = 0; j < a.extent(1); ++j)
+        for (std::ptrdiff_t i = 0; i < a.extent(0); ++i)
+            s += a(i, j);
+    return s;
+}
+
+template<class MD>
+double sum_rows(MD const& a) {
+    double s = 0;
+    for (std::ptrdiff_t i = 0; i < a.extent(0); ++i)
+        for (std::ptrdiff_t j = 0; j < a.extent(1); ++j)
+            s += a(i, j);
+    return s;
+}
+
+template<class Layout>
+void traversal_benchmarks(bench::runner& runner, std::string const& layout, std::ptrdiff_t const rows, std::ptrdiff_t const cols) {
+    basic_mdarray<float, grid_extents, Layout> a(rows, cols);
+    for (std::ptrdiff_t i = 0; i < rows; ++i)
+        for (std::ptrdiff_t j = 0; j < cols; ++j)
+            a(i, j) = static_cast<float>((i + j) % 7);
+
+    std::string const suffix = "/" + std::to_string(rows) + "x" + std::to_string(cols) + "/" + layout;
+    double const items = static_cast<double>(a.size());
+    runner.run("rows" + suffix, items, [&] { bench::do_not_optimize(sum_rows(a)); });
+    runner.run("columns" + suffix, items, [&] { bench::do_not_optimize(sum_columns(a)); });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    for (auto const& [rows, cols] : {std::pair<std::ptrdiff_t, std::ptrdiff_t>{1024, 1024}, {4096, 512}, {512, 4096}}) {
+        traversal_benchmarks<layout_right>(runner, "layout_right", rows, cols);
+        traversal_benchmarks<layout_right_padded<16>>(runner, "layout_right_padded<16>", rows, cols);
+    }
+}
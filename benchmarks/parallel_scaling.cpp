@@ -0,0 +1,37 @@
+// Scaling of the parallel algorithms from 1 to N threads, for a contiguous
+// (flat) operand and a strided sub-view (tiled traversal).
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "../mdarray.hpp"
+#include "../parallel.hpp"
+#include "bench.hpp"
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+
+    using E = extents<dynamic_extent, dynamic_extent, dynamic_extent>;
+    basic_mdarray<float, E, layout_right> a(64, 512, 512);
+    basic_mdarray<float, E, layout_right> b(64, 512, 512);
+    auto const strided = submdarray(a, full_extent, strided_slice{0, 512, 2}, full_extent);
+
+    std::size_t const max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+        thread_pool pool(threads);
+        std::string const suffix = " threads=" + std::to_string(threads);
+
+        runner.run("for_each_index" + suffix, a.size(), [&] {
+            for_each_index(pool, a, [&](std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) { a(i, j, k) = float(i + j + k); });
+        });
+        runner.run("transform flat" + suffix, a.size(), [&] { transform(pool, a, b, [](float x) { return x * 2.0f + 1.0f; }); });
+        runner.run("reduce flat" + suffix, a.size(), [&] { bench::do_not_optimize(reduce(pool, a, 0.0, std::plus<>{})); });
+        runner.run("reduce strided view" + suffix, strided.size(), [&] { bench::do_not_optimize(reduce(pool, strided, 0.0, std::plus<>{})); });
+
+        if (threads < max_threads && threads * 2 > max_threads)
+            threads = max_threads / 2;
+    }
+}
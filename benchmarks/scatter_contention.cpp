@@ -0,0 +1,136 @@
+// Parallel histogramming of 4M samples into a 32x32x32 mdarray of bins on
+// the global pool. "locked" guards a plain mdarray with one mutex; "atomic"
+// updates atomic_container_policy bins with `+=`; "privatized" buffers bins
+// per task in a privatized_accumulator and flushes them at the end of the
+// task. "serial" is a plain single-threaded loop. Samples are either spread
+// uniformly over the bins or concentrated in a few hot bins. Counts are
+// uint32_t and weights are double (a compare-exchange loop when atomic).
+// Items are samples. Exits with status 1 if a strategy gives different bins.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../atomic_container_policy.hpp"
+#include "../parallel.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using bin_extents = extents<32, 32, 32>;
+using sample = std::array<std::int32_t, 3>;
+
+template<class T>
+using plain_bins = basic_mdarray<T, bin_extents, layout_right, default_container_policy<T>>;
+
+template<class T>
+using atomic_bins = basic_mdarray<T, bin_extents, layout_right, atomic_container_policy<T>>;
+
+constexpr std::size_t sample_count = std::size_t(4) << 20;
+
+std::vector<sample> make_samples(bool const hot) {
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<std::int32_t> uniform(0, 31);
+    std::normal_distribution<double> normal(16.0, 1.0);
+    auto const draw = [&] { return hot ? std::clamp(static_cast<std::int32_t>(normal(rng)), 0, 31) : uniform(rng); };
+    std::vector<sample> samples(sample_count);
+    for (auto& s : samples)
+        s = {draw(), draw(), draw()};
+    return samples;
+}
+
+template<class F>
+void parallel_chunks(std::size_t const n, F&& f) {
+    thread_pool& pool = thread_pool::global();
+    std::size_t const chunks = std::min(n, pool.size() * detail::tiles_per_thread);
+    pool.parallel_for(chunks, [&](std::size_t const c) { f(c * n / chunks, (c + 1) * n / chunks); });
+}
+
+template<class Bins>
+void clear(Bins& bins) {
+    std::fill(bins.data(), bins.data() + bins.size(), typename Bins::value_type{});
+}
+
+template<class A, class B>
+bool same_bins(A const& a, B const& b) {
+    return std::equal(a.data(), a.data() + a.size(), b.data());
+}
+
+// Weight of a sample; a multiple of 0.5 for doubles, so that every strategy
+// sums exactly.
+template<class T>
+T weight(sample const& s) {
+    if constexpr (std::is_integral_v<T>)
+        return 1;
+    else
+        return static_cast<T>(s[0] % 4) * T(0.5);
+}
+
+template<class T>
+bool contention_benchmarks(bench::runner& runner, std::string const& name, std::vector<sample> const& samples) {
+    double const items = static_cast<double>(samples.size());
+
+    plain_bins<T> serial;
+    runner.run(name + "/serial", items, [&] {
+        clear(serial);
+        for (auto const& s : samples)
+            serial(s) += weight<T>(s);
+    });
+
+    plain_bins<T> locked;
+    std::mutex m;
+    runner.run(name + "/locked", items, [&] {
+        clear(locked);
+        parallel_chunks(samples.size(), [&](std::size_t const first, std::size_t const last) {
+            for (std::size_t i = first; i < last; ++i) {
+                std::lock_guard<std::mutex> lock(m);
+                locked(samples[i]) += weight<T>(samples[i]);
+            }
+        });
+    });
+
+    atomic_bins<T> atomic;
+    runner.run(name + "/atomic", items, [&] {
+        clear(atomic);
+        parallel_chunks(samples.size(), [&](std::size_t const first, std::size_t const last) {
+            for (std::size_t i = first; i < last; ++i)
+                atomic(samples[i]) += weight<T>(samples[i]);
+        });
+    });
+
+    atomic_bins<T> privatized;
+    runner.run(name + "/privatized", items, [&] {
+        clear(privatized);
+        parallel_chunks(samples.size(), [&](std::size_t const first, std::size_t const last) {
+            privatized_accumulator<atomic_bins<T>> acc(privatized);
+            for (std::size_t i = first; i < last; ++i)
+                acc.add(weight<T>(samples[i]), samples[i]);
+        });
+    });
+
+    bool const ok = same_bins(serial, locked) && same_bins(serial, atomic) && same_bins(serial, privatized);
+    if (!ok)
+        std::printf("    %s: bins differ between strategies\n", name.c_str());
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::printf("threads: %zu\n", thread_pool::global().size());
+    bool ok = true;
+    for (bool const hot : {false, true}) {
+        std::vector<sample> const samples = make_samples(hot);
+        std::string const distribution = hot ? "hot" : "uniform";
+        ok = contention_benchmarks<std::uint32_t>(runner, "counts/" + distribution, samples) && ok;
+        ok = contention_benchmarks<double>(runner, "weights/" + distribution, samples) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// A 1024x1024 grid of particles with six float members, stored as an array
+// of structs (default policy) and as a structure of arrays
+// (soa_container_policy). "sum_x" reads one member, "advance_x" updates x
+// from vx, and "kinetic_energy" reads three members. SoA kernels run either
+// through the proxy returned by operator() or on field_view planes.
+// "gather" converts every SoA element back to a whole particle. Items are
+// particles.
+
+#include <cstddef>
+#include <tuple>
+
+#include "../soa_container_policy.hpp"
+#include "bench.hpp"
+
+namespace {
+
+struct particle {
+    float x, y, z;
+    float vx, vy, vz;
+};
+
+} // namespace
+
+template<>
+struct soa_traits<particle> {
+    static constexpr auto members = std::make_tuple(&particle::x, &particle::y, &particle::z, &particle::vx, &particle::vy, &particle::vz);
+};
+
+namespace {
+
+using grid_extents = extents<dynamic_extent, dynamic_extent>;
+using aos_grid = basic_mdarray<particle, grid_extents, layout_right>;
+using soa_grid = basic_mdarray<particle, grid_extents, layout_right, soa_container_policy<particle>>;
+
+constexpr std::ptrdiff_t n = 1024;
+constexpr float dt = 0.01f;
+
+template<class Grid>
+void fill(Grid& g) {
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            g(i, j) = particle{float(i), float(j), 0.5f, float(j % 7), float(i % 5), 1.0f};
+}
+
+float sum_x(aos_grid const& g) {
+    float s = 0;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            s += g(i, j).x;
+    return s;
+}
+
+float sum_x_proxy(soa_grid& g) {
+    float s = 0;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            s += g(i, j).get<&particle::x>();
+    return s;
+}
+
+template<class View>
+float sum_plane(View const& x) {
+    float s = 0;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            s += x(i, j);
+    return s;
+}
+
+void advance_x(aos_grid& g) {
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            g(i, j).x += dt * g(i, j).vx;
+}
+
+void advance_x_proxy(soa_grid& g) {
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            g(i, j).get<&particle::x>() += dt * g(i, j).get<&particle::vx>();
+}
+
+template<class X, class V>
+void advance_plane(X x, V const& vx) {
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            x(i, j) += dt * vx(i, j);
+}
+
+float kinetic_energy(aos_grid const& g) {
+    float e = 0;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j) {
+            particle const& p = g(i, j);
+            e += p.vx * p.vx + p.vy * p.vy + p.vz * p.vz;
+        }
+    return 0.5f * e;
+}
+
+template<class V>
+float kinetic_energy_planes(V const& vx, V const& vy, V const& vz) {
+    float e = 0;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j)
+            e += vx(i, j) * vx(i, j) + vy(i, j) * vy(i, j) + vz(i, j) * vz(i, j);
+    return 0.5f * e;
+}
+
+float gather_all(soa_grid const& g) {
+    float s = 0;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        for (std::ptrdiff_t j = 0; j < n; ++j) {
+            particle const p = g(i, j);
+            s += p.x + p.y + p.z + p.vx + p.vy + p.vz;
+        }
+    return s;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    aos_grid aos(n, n);
+    soa_grid soa(n, n);
+    fill(aos);
+    fill(soa);
+    soa_grid const& soa_const = soa;
+    double const items = static_cast<double>(n * n);
+
+    runner.run("sum_x/aos", items, [&] { bench::do_not_optimize(sum_x(aos)); });
+    runner.run("sum_x/soa_proxy", items, [&] { bench::do_not_optimize(sum_x_proxy(soa)); });
+    runner.run("sum_x/soa_field_view", items, [&] { bench::do_not_optimize(sum_plane(field_view<&particle::x>(soa_const))); });
+
+    runner.run("advance_x/aos", items, [&] { advance_x(aos); bench::do_not_optimize(aos.data()); });
+    runner.run("advance_x/soa_proxy", items, [&] { advance_x_proxy(soa); bench::do_not_optimize(soa.data()); });
+    runner.run("advance_x/soa_field_view", items, [&] {
+        advance_plane(field_view<&particle::x>(soa), field_view<&particle::vx>(soa_const));
+        bench::do_not_optimize(soa.data());
+    });
+
+    runner.run("kinetic_energy/aos", items, [&] { bench::do_not_optimize(kinetic_energy(aos)); });
+    runner.run("kinetic_energy/soa_field_view", items, [&] {
+        bench::do_not_optimize(kinetic_energy_planes(field_view<&particle::vx>(soa_const), field_view<&particle::vy>(soa_const),
+                                                     field_view<&particle::vz>(soa_const)));
+    });
+
+    runner.run("gather/soa_proxy", items, [&] { bench::do_not_optimize(gather_all(soa_const)); });
+}
@@ -0,0 +1,165 @@
+// 5-point (2D) and 7-point (3D) Jacobi smoothing with clamped boundaries.
+// "naive" checks every neighbor against the extents; apply_stencil splits
+// off the branch-free interior, given a lambda or a weighted stencil.
+// "iterate" runs 8 steps in place, with time_block 1 (one sweep over memory
+// per step) against 4 (tiles advanced 4 steps while cached). Items are
+// element updates.
+//
+// Before timing, iterate_stencil with time blocks 1, 4 and 8 is checked on
+// odd-sized grids against repeated naive_jacobi (clamp) and repeated
+// apply_stencil (wrap, mirror, constant); exits with status 1 on a mismatch.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include "../stencil.hpp"
+#include "bench.hpp"
+
+namespace {
+
+using grid_extents = extents<dynamic_extent, dynamic_extent>;
+using volume_extents = extents<dynamic_extent, dynamic_extent, dynamic_extent>;
+
+template<class E>
+using grid = basic_mdarray<float, E, layout_right>;
+
+constexpr std::size_t steps = 8;
+
+std::ptrdiff_t clamp_index(std::ptrdiff_t const i, std::ptrdiff_t const n) { return i < 0 ? 0 : i >= n ? n - 1 : i; }
+
+void naive_jacobi(grid<grid_extents> const& in, grid<grid_extents>& out) {
+    std::ptrdiff_t const ny = in.extent(0);
+    std::ptrdiff_t const nx = in.extent(1);
+    for (std::ptrdiff_t i = 0; i < ny; ++i)
+        for (std::ptrdiff_t j = 0; j < nx; ++j)
+            out(i, j) = 0.2f * (in(i, j) + in(clamp_index(i - 1, ny), j) + in(clamp_index(i + 1, ny), j) + in(i, clamp_index(j - 1, nx))
+                                + in(i, clamp_index(j + 1, nx)));
+}
+
+void naive_jacobi(grid<volume_extents> const& in, grid<volume_extents>& out) {
+    std::ptrdiff_t const nz = in.extent(0);
+    std::ptrdiff_t const ny = in.extent(1);
+    std::ptrdiff_t const nx = in.extent(2);
+    for (std::ptrdiff_t k = 0; k < nz; ++k)
+        for (std::ptrdiff_t i = 0; i < ny; ++i)
+            for (std::ptrdiff_t j = 0; j < nx; ++j)
+                out(k, i, j) = (1.0f / 7) * (in(k, i, j) + in(clamp_index(k - 1, nz), i, j) + in(clamp_index(k + 1, nz), i, j)
+                                             + in(k, clamp_index(i - 1, ny), j) + in(k, clamp_index(i + 1, ny), j)
+                                             + in(k, i, clamp_index(j - 1, nx)) + in(k, i, clamp_index(j + 1, nx)));
+}
+
+auto jacobi_lambda(grid_extents) {
+    return [](auto const& n) { return 0.2f * (n(0, 0) + n(-1, 0) + n(1, 0) + n(0, -1) + n(0, 1)); };
+}
+
+auto jacobi_lambda(volume_extents) {
+    return [](auto const& n) { return (1.0f / 7) * (n(0, 0, 0) + n(-1, 0, 0) + n(1, 0, 0) + n(0, -1, 0) + n(0, 1, 0) + n(0, 0, -1) + n(0, 0, 1)); };
+}
+
+template<std::size_t Rank>
+stencil<float, Rank> jacobi_stencil() {
+    stencil<float, Rank> s;
+    float const w = 1.0f / (2 * Rank + 1);
+    s.add({}, w);
+    for (std::size_t d = 0; d < Rank; ++d) {
+        for (std::ptrdiff_t const o : {-1, 1}) {
+            std::array<std::ptrdiff_t, Rank> offset{};
+            offset[d] = o;
+            s.add(offset, w);
+        }
+    }
+    return s;
+}
+
+template<class E>
+bool close_enough(grid<E> const& a, grid<E> const& b) {
+    for (std::ptrdiff_t i = 0; i < a.size(); ++i)
+        if (std::fabs(a.data()[i] - b.data()[i]) > 1e-4f)
+            return false;
+    return true;
+}
+
+char const* mode_name(boundary_mode const mode) {
+    switch (mode) {
+    case boundary_mode::clamp: return "clamp";
+    case boundary_mode::wrap: return "wrap";
+    case boundary_mode::constant: return "constant";
+    default: return "mirror";
+    }
+}
+
+template<class E, class... Extents>
+bool check_iterate(std::string const& name, Extents const... n) {
+    grid<E> initial(n...);
+    for (std::ptrdiff_t i = 0; i < initial.size(); ++i)
+        initial.data()[i] = static_cast<float>((i * 7) % 13);
+    auto const f = jacobi_lambda(E{n...});
+    auto const copy_of = [&](grid<E> const& g) {
+        grid<E> c(n...);
+        std::copy(g.data(), g.data() + g.size(), c.data());
+        return c;
+    };
+
+    bool ok = true;
+    for (boundary_mode const mode : {boundary_mode::clamp, boundary_mode::wrap, boundary_mode::mirror, boundary_mode::constant}) {
+        boundary_condition<float> const bc{mode, 3.0f};
+        grid<E> expected = copy_of(initial);
+        grid<E> scratch(n...);
+        for (std::size_t step = 0; step < steps; ++step) {
+            if (mode == boundary_mode::clamp)
+                naive_jacobi(expected, scratch);
+            else
+                apply_stencil(expected, scratch, 1, f, bc);
+            std::swap(expected, scratch);
+        }
+        for (std::size_t const time_block : {1, 4, 8}) {
+            grid<E> a = copy_of(initial);
+            iterate_stencil(a, steps, 1, f, bc, time_block);
+            if (!close_enough(expected, a)) {
+                std::printf("    %s/%s/time_block_%zu: iterate_stencil differs from step-by-step\n", name.c_str(), mode_name(mode), time_block);
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+template<class E, class... Extents>
+void stencil_benchmarks(bench::runner& runner, std::string const& name, Extents const... n) {
+    constexpr std::size_t rank = E::rank();
+    grid<E> a(n...);
+    grid<E> b(n...);
+    for (std::ptrdiff_t i = 0; i < a.size(); ++i)
+        a.data()[i] = static_cast<float>(i % 13);
+
+    auto const f = jacobi_lambda(E{n...});
+    auto const s = jacobi_stencil<rank>();
+    double const items = static_cast<double>(a.size());
+    std::string const prefix = "jacobi/" + name + "/";
+
+    runner.run(prefix + "naive", items, [&] { naive_jacobi(a, b); bench::do_not_optimize(b.data()); });
+    runner.run(prefix + "apply_stencil_lambda", items, [&] { apply_stencil(a, b, 1, f); bench::do_not_optimize(b.data()); });
+    runner.run(prefix + "apply_stencil_weighted", items, [&] { apply_stencil(a, b, s); bench::do_not_optimize(b.data()); });
+    for (std::size_t const time_block : {1, 4}) {
+        runner.run(prefix + "iterate_" + std::to_string(steps) + "_steps/time_block_" + std::to_string(time_block), items * steps, [&] {
+            iterate_stencil(a, steps, 1, f, {}, time_block);
+            bench::do_not_optimize(a.data());
+        });
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    bool ok = check_iterate<grid_extents>("203x157", 203, 157);
+    ok = check_iterate<volume_extents>("37x45x29", 37, 45, 29) && ok;
+    if (!ok)
+        return 1;
+    stencil_benchmarks<grid_extents>(runner, "2048x2048", 2048, 2048);
+    stencil_benchmarks<volume_extents>(runner, "192x192x192", 192, 192, 192);
+}
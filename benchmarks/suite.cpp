@@ -0,0 +1,210 @@
+// Core benchmark suite: element access through basic_mdarray::operator() and
+// basic_mdarray_view::operator[] for ranks 1-6, static vs. dynamic extents,
+// layout_left vs. layout_right traversal orders, and allocation cost, each
+// next to a raw-pointer baseline.
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "../arena_container_policy.hpp"
+#include "../cow_container_policy.hpp"
+#include "../mdarray.hpp"
+#include "bench.hpp"
+
+namespace {
+
+template<std::ptrdiff_t E, std::size_t... Is>
+extents<((void)Is, E)...> repeat_extents(std::index_sequence<Is...>);
+
+template<std::size_t Rank, std::ptrdiff_t E>
+using uniform_extents = decltype(repeat_extents<E>(std::make_index_sequence<Rank>{}));
+
+// Builds an mdarray whose dynamic extents are all `n`.
+template<class MD, std::size_t... Is>
+MD make_uniform(std::ptrdiff_t const n, std::index_sequence<Is...>) {
+    return MD(((void)Is, n)...);
+}
+
+// Extent per dimension so that every rank holds roughly 2^18 elements.
+constexpr std::ptrdiff_t extent_for_rank(std::size_t const rank) {
+    constexpr std::ptrdiff_t table[] = {1, 262144, 512, 64, 24, 12, 8};
+    return table[rank];
+}
+
+// Sums `a` with the last index innermost (layout_right order).
+template<std::size_t D, class MD, class... Is>
+double sum_right(MD const& a, Is... is) {
+    if constexpr (D == MD::rank())
+        return a(is...);
+    else {
+        double s = 0;
+        for (std::ptrdiff_t i = 0; i < a.extent(D); ++i)
+            s += sum_right<D + 1>(a, is..., i);
+        return s;
+    }
+}
+
+// Sums `a` with the first index innermost (layout_left order).
+template<std::size_t D, class MD, class... Is>
+double sum_left(MD const& a, Is... is) {
+    if constexpr (D == MD::rank())
+        return a(is...);
+    else {
+        constexpr std::size_t dim = MD::rank() - 1 - D;
+        double s = 0;
+        for (std::ptrdiff_t i = 0; i < a.extent(dim); ++i)
+            s += sum_left<D + 1>(a, i, is...);
+        return s;
+    }
+}
+
+// Sums a view through chained operator[], which fixes the trailing index.
+template<class View>
+double sum_subscript(View v) {
+    double s = 0;
+    std::ptrdiff_t const n = v.extent(View::rank() - 1);
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        if constexpr (View::rank() == 1)
+            s += v[i];
+        else
+            s += sum_subscript(v[i]);
+    }
+    return s;
+}
+
+double sum_raw(float const* const p, std::ptrdiff_t const n) {
+    double s = 0;
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+        s += p[i];
+    return s;
+}
+
+template<class MD>
+void fill(MD& a) {
+    float* const p = a.data();
+    for (std::ptrdiff_t i = 0; i < a.size(); ++i)
+        p[i] = static_cast<float>(i % 7);
+}
+
+template<std::size_t Rank, class Layout, bool Static>
+void access_benchmarks(bench::runner& runner) {
+    constexpr std::ptrdiff_t n = extent_for_rank(Rank);
+    using extents_type = std::conditional_t<Static, uniform_extents<Rank, n>, uniform_extents<Rank, dynamic_extent>>;
+    using mdarray_type = basic_mdarray<float, extents_type, Layout>;
+
+    auto a = make_uniform<mdarray_type>(n, std::make_index_sequence<Static ? 0 : Rank>{});
+    fill(a);
+
+    std::string const layout = std::is_same_v<Layout, layout_left> ? "layout_left" : "layout_right";
+    std::string const prefix = "rank" + std::to_string(Rank) + "/" + (Static ? "static/" : "dynamic/") + layout + "/";
+    double const items = static_cast<double>(a.size());
+
+    runner.run(prefix + "raw_pointer", items, [&] { bench::do_not_optimize(sum_raw(a.data(), a.size())); });
+    runner.run(prefix + "operator()/left_order", items, [&] { bench::do_not_optimize(sum_left<0>(a)); });
+    runner.run(prefix + "operator()/right_order", items, [&] { bench::do_not_optimize(sum_right<0>(a)); });
+    runner.run(prefix + "view_operator[]", items, [&] { bench::do_not_optimize(sum_subscript(a.view())); });
+}
+
+template<std::size_t Rank>
+void access_benchmarks_for_rank(bench::runner& runner) {
+    access_benchmarks<Rank, layout_left, true>(runner);
+    access_benchmarks<Rank, layout_left, false>(runner);
+    access_benchmarks<Rank, layout_right, true>(runner);
+    access_benchmarks<Rank, layout_right, false>(runner);
+}
+
+void allocation_benchmarks(bench::runner& runner) {
+    for (std::ptrdiff_t const n : {64, 1024}) {
+        std::string const suffix = "/" + std::to_string(n) + "x" + std::to_string(n);
+        double const items = static_cast<double>(n * n);
+
+        runner.run("allocate/raw_new" + suffix, items, [&] {
+            std::unique_ptr<float[]> p(new float[static_cast<std::size_t>(n * n)]);
+            bench::do_not_optimize(p.get());
+        });
+        runner.run("allocate/raw_make_unique" + suffix, items, [&] {
+            auto p = std::make_unique<float[]>(static_cast<std::size_t>(n * n));
+            bench::do_not_optimize(p.get());
+        });
+        runner.run("allocate/mdarray_default_policy" + suffix, items, [&] {
+            basic_mdarray<float, extents<dynamic_extent, dynamic_extent>> a(n, n);
+            bench::do_not_optimize(a.data());
+        });
+        runner.run("allocate/mdarray_uninitialized_policy" + suffix, items, [&] {
+            basic_mdarray<float, extents<dynamic_extent, dynamic_extent>, layout_left, uninitialized_container_policy<float>> a(n, n);
+            bench::do_not_optimize(a.data());
+        });
+        runner.run("allocate/mdarray_aligned_policy" + suffix, items, [&] {
+            basic_mdarray<float, extents<dynamic_extent, dynamic_extent>, layout_left, aligned_container_policy<float>> a(n, n);
+            bench::do_not_optimize(a.data());
+        });
+
+        monotonic_arena monotonic;
+        runner.run("allocate/mdarray_monotonic_arena" + suffix, items, [&] {
+            arena_scope scope(monotonic);
+            basic_mdarray<float, extents<dynamic_extent, dynamic_extent>, layout_left, arena_container_policy<float>> a(n, n);
+            bench::do_not_optimize(a.data());
+        });
+        pool_arena pool;
+        runner.run("allocate/mdarray_pool_arena" + suffix, items, [&] {
+            basic_mdarray<float, extents<dynamic_extent, dynamic_extent>, layout_left, arena_container_policy<float>> a(
+                layout_left::mapping<extents<dynamic_extent, dynamic_extent>>(extents<dynamic_extent, dynamic_extent>(n, n)), arena_container_policy<float>(pool));
+            bench::do_not_optimize(a.data());
+        });
+    }
+
+    // Small fixed-size matrices: inline storage against a heap allocation.
+    runner.run("allocate/mdarray_heap_policy/4x4", 16, [&] {
+        basic_mdarray<float, extents<4, 4>, layout_left, default_container_policy<float>> a;
+        bench::do_not_optimize(a.data());
+    });
+    runner.run("allocate/mdarray_inline_policy/4x4", 16, [&] {
+        basic_mdarray<float, extents<4, 4>> a;
+        bench::do_not_optimize(a.data());
+    });
+}
+
+// Snapshot cost of a 1024x1024 array: copy-on-write against a deep copy.
+void copy_benchmarks(bench::runner& runner) {
+    using E = extents<dynamic_extent, dynamic_extent>;
+    std::ptrdiff_t const n = 1024;
+    double const items = static_cast<double>(n * n);
+
+    basic_mdarray<float, E, layout_left, cow_container_policy<float>> cow(n, n);
+    basic_mdarray<float, E> dense(n, n);
+    fill(cow);
+    fill(dense);
+
+    runner.run("copy/raw_pointer_deep_copy", items, [&] {
+        std::unique_ptr<float[]> p(new float[static_cast<std::size_t>(n * n)]);
+        std::copy(dense.data(), dense.data() + dense.size(), p.get());
+        bench::do_not_optimize(p.get());
+    });
+    runner.run("copy/mdarray_cow_policy", items, [&] {
+        auto snapshot = cow;
+        bench::do_not_optimize(snapshot.container().data());
+    });
+    runner.run("copy/mdarray_cow_policy_then_write", items, [&] {
+        auto snapshot = cow;
+        snapshot(0, 0) = 1.0f;
+        bench::do_not_optimize(snapshot.container().data());
+    });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    access_benchmarks_for_rank<1>(runner);
+    access_benchmarks_for_rank<2>(runner);
+    access_benchmarks_for_rank<3>(runner);
+    access_benchmarks_for_rank<4>(runner);
+    access_benchmarks_for_rank<5>(runner);
+    access_benchmarks_for_rank<6>(runner);
+    allocation_benchmarks(runner);
+    copy_benchmarks(runner);
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Resident memory of a chunked_storage.
+struct chunked_statistics {
+    std::size_t chunk_elements = 0;
+    std::size_t total_chunks = 0;
+    std::size_t resident_chunks = 0;
+    std::size_t resident_bytes = 0;
+};
+
+namespace detail {
+
+// Storage offsets [0, size) split into chunks of ChunkElements elements.
+// A chunk is allocated on its first write; reads of an unallocated chunk see
+// a shared, value-initialized zero chunk. Chunks are published with a CAS,
+// so distinct elements may be written from several threads at once.
+template<class T, std::size_t ChunkElements>
+class chunk_table {
+public:
+    explicit chunk_table(std::size_t const size)
+        : size_(size)
+        , chunk_count_((size + ChunkElements - 1) / ChunkElements)
+        , chunks_(std::make_unique<std::atomic<T*>[]>(chunk_count_))
+    {
+        for (std::size_t c = 0; c < chunk_count_; ++c)
+            chunks_[c].store(nullptr, std::memory_order_relaxed);
+    }
+
+    chunk_table(chunk_table const&) = delete;
+    chunk_table& operator=(chunk_table const&) = delete;
+
+    ~chunk_table() {
+        for (std::size_t c = 0; c < chunk_count_; ++c)
+            delete[] chunks_[c].load(std::memory_order_relaxed);
+    }
+
+    T const& load(std::ptrdiff_t const i) const noexcept {
+        auto const u = static_cast<std::size_t>(i);
+        T const* const chunk = chunks_[u / ChunkElements].load(std::memory_order_acquire);
+        return (chunk != nullptr ? chunk : zero_chunk())[u % ChunkElements];
+    }
+
+    T& store(std::ptrdiff_t const i) {
+        auto const u = static_cast<std::size_t>(i);
+        return chunk(u / ChunkElements)[u % ChunkElements];
+    }
+
+    // True if element i has never been written and reads as T{}.
+    bool is_untouched(std::ptrdiff_t const i) const noexcept {
+        return chunks_[static_cast<std::size_t>(i) / ChunkElements].load(std::memory_order_acquire) == nullptr;
+    }
+
+    chunked_statistics statistics() const noexcept {
+        std::size_t const resident = resident_.load(std::memory_order_relaxed);
+        return {ChunkElements, chunk_count_, resident, resident * ChunkElements * sizeof(T)};
+    }
+
+    // Calls f(first_offset, data, count) for every allocated chunk, in
+    // storage order; elements [first_offset, first_offset + count) live at
+    // data[0, count).
+    template<class F>
+    void for_each_resident_chunk(F&& f) const {
+        for (std::size_t c = 0; c < chunk_count_; ++c) {
+            if (T* const chunk = chunks_[c].load(std::memory_order_acquire)) {
+                std::size_t const first = c * ChunkElements;
+                std::size_t const count = size_ - first < ChunkElements ? size_ - first : ChunkElements;
+                f(static_cast<std::ptrdiff_t>(first), chunk, count);
+            }
+        }
+    }
+
+private:
+    static T const* zero_chunk() {
+        static std::unique_ptr<T[]> const zero(new T[ChunkElements]());
+        return zero.get();
+    }
+
+    T* chunk(std::size_t const c) {
+        T* existing = chunks_[c].load(std::memory_order_acquire);
+        if (existing != nullptr)
+            return existing;
+
+        T* const fresh = new T[ChunkElements]();
+        if (chunks_[c].compare_exchange_strong(existing, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            resident_.fetch_add(1, std::memory_order_relaxed);
+            return fresh;
+        }
+        delete[] fresh;
+        return existing;
+    }
+
+    std::size_t size_;
+    std::size_t chunk_count_;
+    std::unique_ptr<std::atomic<T*>[]> chunks_;
+    std::atomic<std::size_t> resident_{0};
+};
+
+} // namespace detail
+
+// Position in a chunked_storage. Views and slices of a chunked mdarray hold
+// one of these instead of a raw pointer; it stays valid when the mdarray is
+// moved.
+template<class Table>
+struct chunked_pointer {
+    constexpr chunked_pointer() noexcept = default;
+    constexpr chunked_pointer(Table* const t, std::ptrdiff_t const o) noexcept : table(t), offset(o) {}
+    template<class U, std::enable_if_t<std::is_convertible_v<U*, Table*>, int> = 0>
+    constexpr chunked_pointer(chunked_pointer<U> const& other) noexcept : table(other.table), offset(other.offset) {}
+
+    Table* table = nullptr;
+    std::ptrdiff_t offset = 0;
+};
+
+// Proxy returned by mutable element access. Reading never allocates;
+// writing allocates the chunk on first use. Assigning T{} to an element of
+// an unallocated chunk of arithmetic type is a no-op, so clearing an
+// untouched region stays free.
+template<class T, std::size_t ChunkElements>
+class chunked_reference {
+    using table_type = detail::chunk_table<T, ChunkElements>;
+public:
+    chunked_reference(table_type* const table, std::ptrdiff_t const i) noexcept : table_(table), i_(i) {}
+    chunked_reference(chunked_reference const&) = default;
+
+    operator T const&() const noexcept { return table_->load(i_); }
+    T const& get() const noexcept { return table_->load(i_); }
+
+    chunked_reference& operator=(T const& value) {
+        if constexpr (std::is_arithmetic_v<T>) {
+            if (value == T{} && table_->is_untouched(i_))
+                return *this;
+        }
+        table_->store(i_) = value;
+        return *this;
+    }
+
+    chunked_reference& operator=(chunked_reference const& other) { return *this = other.get(); }
+
+    chunked_reference& operator+=(T const& value) { table_->store(i_) += value; return *this; }
+    chunked_reference& operator-=(T const& value) { table_->store(i_) -= value; return *this; }
+    chunked_reference& operator*=(T const& value) { table_->store(i_) *= value; return *this; }
+    chunked_reference& operator/=(T const& value) { table_->store(i_) /= value; return *this; }
+
+private:
+    table_type* table_;
+    std::ptrdiff_t i_;
+};
+
+// Owns a chunk_table. The table lives on the heap so that pointers into it
+// survive moves of the owning mdarray.
+template<class T, std::size_t ChunkElements>
+class chunked_storage {
+    using table_type = detail::chunk_table<T, ChunkElements>;
+public:
+    chunked_storage() noexcept = default;
+    explicit chunked_storage(std::size_t const n) : table_(std::make_unique<table_type>(n)) {}
+
+    table_type* table() const noexcept { return table_.get(); }
+
+    chunked_statistics statistics() const noexcept { return table_ ? table_->statistics() : chunked_statistics{ChunkElements, 0, 0, 0}; }
+
+    template<class F>
+    void for_each_resident_chunk(F&& f) const {
+        if (table_)
+            table_->for_each_resident_chunk(std::forward<F>(f));
+    }
+
+private:
+    std::unique_ptr<table_type> table_;
+};
+
+// Splits the storage offsets of an mdarray into chunks of ChunkElements
+// elements that are allocated on first write, so memory is proportional to
+// the touched volume rather than to extents().size(). Untouched elements read
+// as T{}.
+//
+// Chunks are ranges of storage offsets, so pair this with
+// layout_tiled<...> whose tile holds ChunkElements elements to make every
+// chunk a spatial block. Statistics and resident-chunk iteration are on
+// container(). There is no raw data pointer; algorithms take their generic
+// per-element paths.
+template<class T, std::size_t ChunkElements = 4096>
+struct chunked_container_policy {
+    static_assert(ChunkElements > 0, "");
+
+    using element_type = T;
+    using container_type = chunked_storage<T, ChunkElements>;
+    using pointer = chunked_pointer<detail::chunk_table<T, ChunkElements>>;
+    using const_pointer = chunked_pointer<detail::chunk_table<T, ChunkElements> const>;
+    using reference = chunked_reference<T, ChunkElements>;
+    using const_reference = T const&;
+    using offset_policy = chunked_container_policy<T, ChunkElements>;
+
+    static constexpr std::size_t alignment = alignof(T);
+
+    container_type create(std::size_t const n) const { return container_type(n); }
+
+    reference access(container_type const& c, std::ptrdiff_t const i) { return reference(c.table(), i); }
+    const_reference access(container_type const& c, std::ptrdiff_t const i) const { return c.table()->load(i); }
+    reference access(pointer const p, std::ptrdiff_t const i) { return reference(p.table, p.offset + i); }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return p.table->load(p.offset + i); }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return {p.table, p.offset + i}; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return {p.table, p.offset + i}; }
+
+    pointer data(container_type& c) { return {c.table(), 0}; }
+    const_pointer data(container_type const& c) const { return {c.table(), 0}; }
+};
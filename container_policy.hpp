@@ -1,6 +1,16 @@
 #pragma once
 
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 template<class T>
 struct default_container_policy {
@@ -12,10 +22,105 @@ struct default_container_policy {
     using const_reference = T const&;
     using offset_policy = default_container_policy<T>;
 
+    static constexpr std::size_t alignment = alignof(T);
+
     container_type create(std::size_t const n) const { return std::make_unique<T[]>(n); }
 
     reference access(container_type const& p, std::ptrdiff_t const i) { return p[i]; }
     const_reference access(container_type const& p, std::ptrdiff_t const i) const { return p[i]; }
+    reference access(pointer const p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return p[i]; }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
+
+    element_type* decay(pointer const p) { return p; }
+    element_type const* decay(pointer const p) const { return p; }
+
+    pointer data(container_type& c) { return c.get(); }
+    const_pointer data(container_type const& c) const { return c.get(); }
+};
+
+// Tells the optimizer that `p` is aligned to `Alignment` bytes, e.g.
+// assume_aligned<decltype(a)::alignment()>(a.data()).
+template<std::size_t Alignment, class T>
+constexpr T* assume_aligned(T* const p) noexcept {
+#if defined(__GNUC__)
+    return static_cast<T*>(__builtin_assume_aligned(p, Alignment));
+#else
+    return p;
+#endif
+}
+
+namespace detail {
+
+template<class T>
+struct aligned_array_deleter {
+    std::size_t size = 0;
+    std::size_t alignment = alignof(T);
+
+    void operator()(T* const p) const noexcept {
+        std::destroy_n(p, size);
+        ::operator delete(static_cast<void*>(p), std::align_val_t{alignment});
+    }
+};
+
+template<class T>
+using aligned_array = std::unique_ptr<T[], aligned_array_deleter<T>>;
+
+// Allocates `n` elements aligned to `alignment` bytes. Elements are
+// value-initialized if `ValueInitialize`, otherwise default-initialized, which
+// leaves trivially constructible types untouched.
+template<class T, bool ValueInitialize>
+aligned_array<T> allocate_aligned_array(std::size_t const n, std::size_t const alignment) {
+    T* const p = static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{alignment}));
+    try {
+        if constexpr (ValueInitialize)
+            std::uninitialized_value_construct_n(p, n);
+        else
+            std::uninitialized_default_construct_n(p, n);
+    }
+    catch (...) {
+        ::operator delete(static_cast<void*>(p), std::align_val_t{alignment});
+        throw;
+    }
+    return aligned_array<T>(p, aligned_array_deleter<T>{n, alignment});
+}
+
+template<class Policy, class = void>
+struct policy_alignment : std::integral_constant<std::size_t, alignof(typename Policy::element_type)> {};
+
+template<class Policy>
+struct policy_alignment<Policy, std::void_t<decltype(Policy::alignment)>> : std::integral_constant<std::size_t, Policy::alignment> {};
+
+template<class Policy>
+inline constexpr std::size_t policy_alignment_v = policy_alignment<Policy>::value;
+
+} // namespace detail
+
+// Like default_container_policy, but elements are default-initialized, so
+// trivially constructible types are left uninitialized instead of being
+// zero-filled.
+template<class T, std::size_t Alignment = alignof(T)>
+struct uninitialized_container_policy {
+    static_assert((Alignment & (Alignment - 1)) == 0, "alignment must be a power of two");
+
+    using element_type = T;
+    using container_type = detail::aligned_array<T>;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using reference = T&;
+    using const_reference = T const&;
+    using offset_policy = uninitialized_container_policy<T, Alignment>;
+
+    static constexpr std::size_t alignment = Alignment < alignof(T) ? alignof(T) : Alignment;
+
+    container_type create(std::size_t const n) const { return detail::allocate_aligned_array<T, false>(n, alignment); }
+
+    reference access(container_type const& p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(container_type const& p, std::ptrdiff_t const i) const { return p[i]; }
+    reference access(pointer const p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return p[i]; }
 
     pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
     const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
@@ -27,3 +132,163 @@ struct default_container_policy {
     const_pointer data(container_type const& c) const { return c.get(); }
 };
 
+// Value-initializes like default_container_policy, but the first element is
+// aligned to `Alignment` bytes (a cache line by default).
+template<class T, std::size_t Alignment = 64>
+struct aligned_container_policy {
+    static_assert((Alignment & (Alignment - 1)) == 0, "alignment must be a power of two");
+
+    using element_type = T;
+    using container_type = detail::aligned_array<T>;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using reference = T&;
+    using const_reference = T const&;
+    using offset_policy = aligned_container_policy<T, Alignment>;
+
+    static constexpr std::size_t alignment = Alignment < alignof(T) ? alignof(T) : Alignment;
+
+    container_type create(std::size_t const n) const { return detail::allocate_aligned_array<T, true>(n, alignment); }
+
+    reference access(container_type const& p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(container_type const& p, std::ptrdiff_t const i) const { return p[i]; }
+    reference access(pointer const p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return p[i]; }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
+
+    element_type* decay(pointer const p) { return p; }
+    element_type const* decay(pointer const p) const { return p; }
+
+    pointer data(container_type& c) { return c.get(); }
+    const_pointer data(container_type const& c) const { return c.get(); }
+};
+
+namespace detail {
+
+inline constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+template<class T>
+struct huge_page_deleter {
+    std::size_t size = 0;
+    std::size_t mapped_bytes = 0; // 0 if the array came from operator new
+
+    void operator()(T* const p) const noexcept {
+        std::destroy_n(p, size);
+#if defined(__linux__)
+        if (mapped_bytes != 0) {
+            ::munmap(static_cast<void*>(p), mapped_bytes);
+            return;
+        }
+#endif
+        ::operator delete(static_cast<void*>(p), std::align_val_t{alignof(T) < 64 ? 64 : alignof(T)});
+    }
+};
+
+} // namespace detail
+
+// Allocations of at least one huge page are mapped anonymously, aligned to a
+// 2 MiB boundary and marked MADV_HUGEPAGE so the kernel backs them with
+// transparent huge pages. Smaller allocations fall back to a cache-line
+// aligned operator new. Elements are value-initialized; for arithmetic types
+// the fresh mapping is already zero and is not touched.
+template<class T>
+struct huge_page_container_policy {
+    using element_type = T;
+    using container_type = std::unique_ptr<T[], detail::huge_page_deleter<T>>;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using reference = T&;
+    using const_reference = T const&;
+    using offset_policy = huge_page_container_policy<T>;
+
+    static constexpr std::size_t alignment = alignof(T) < 64 ? 64 : alignof(T);
+
+    container_type create(std::size_t const n) const {
+        std::size_t const bytes = n * sizeof(T);
+#if defined(__linux__)
+        if (bytes >= detail::huge_page_size) {
+            std::size_t const mapped = (bytes + detail::huge_page_size - 1) & ~(detail::huge_page_size - 1);
+            void* const raw = ::mmap(nullptr, mapped + detail::huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED)
+                throw std::bad_alloc();
+
+            // Trim the over-allocation so the region starts on a huge page boundary.
+            auto const base = reinterpret_cast<std::uintptr_t>(raw);
+            auto const aligned = (base + detail::huge_page_size - 1) & ~(detail::huge_page_size - 1);
+            if (aligned != base)
+                ::munmap(raw, aligned - base);
+            if (std::size_t const tail = detail::huge_page_size - (aligned - base); tail != 0)
+                ::munmap(reinterpret_cast<void*>(aligned + mapped), tail);
+#if defined(MADV_HUGEPAGE)
+            ::madvise(reinterpret_cast<void*>(aligned), mapped, MADV_HUGEPAGE);
+#endif
+
+            T* const p = reinterpret_cast<T*>(aligned);
+            if constexpr (!std::is_arithmetic_v<T>) {
+                try {
+                    std::uninitialized_value_construct_n(p, n);
+                }
+                catch (...) {
+                    ::munmap(reinterpret_cast<void*>(aligned), mapped);
+                    throw;
+                }
+            }
+            return container_type(p, detail::huge_page_deleter<T>{n, mapped});
+        }
+#endif
+        auto a = detail::allocate_aligned_array<T, true>(n, alignment);
+        return container_type(a.release(), detail::huge_page_deleter<T>{n, 0});
+    }
+
+    reference access(container_type const& p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(container_type const& p, std::ptrdiff_t const i) const { return p[i]; }
+    reference access(pointer const p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return p[i]; }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
+
+    element_type* decay(pointer const p) { return p; }
+    element_type const* decay(pointer const p) const { return p; }
+
+    pointer data(container_type& c) { return c.get(); }
+    const_pointer data(container_type const& c) const { return c.get(); }
+};
+
+// Stores up to `N` elements inline in the container itself, so an mdarray with
+// all-static extents needs no heap allocation and is trivially copyable (and
+// usable in constant expressions) whenever T is. Views and slices taken from
+// such an mdarray point into the object and do not survive a move of it.
+template<class T, std::size_t N>
+struct inline_container_policy {
+    using element_type = T;
+    using container_type = std::array<T, N>;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using reference = T&;
+    using const_reference = T const&;
+    using offset_policy = default_container_policy<T>;
+
+    static constexpr std::size_t alignment = alignof(T);
+
+    constexpr container_type create([[maybe_unused]] std::size_t const n) const noexcept {
+        assert(n <= N);
+        return container_type{};
+    }
+
+    constexpr reference access(container_type& c, std::ptrdiff_t const i) noexcept { return c[i]; }
+    constexpr const_reference access(container_type const& c, std::ptrdiff_t const i) const noexcept { return c[i]; }
+    constexpr reference access(pointer const p, std::ptrdiff_t const i) noexcept { return p[i]; }
+    constexpr const_reference access(const_pointer const p, std::ptrdiff_t const i) const noexcept { return p[i]; }
+
+    constexpr pointer offset(pointer const p, std::ptrdiff_t const i) noexcept { return p + i; }
+    constexpr const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const noexcept { return p + i; }
+
+    constexpr element_type* decay(pointer const p) noexcept { return p; }
+    constexpr element_type const* decay(pointer const p) const noexcept { return p; }
+
+    constexpr pointer data(container_type& c) noexcept { return c.data(); }
+    constexpr const_pointer data(container_type const& c) const noexcept { return c.data(); }
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "container_policy.hpp"
+
+// Reference-counted element storage. Copies share the elements; detach()
+// gives this copy its own elements if they are shared. The count and the
+// elements live in a single allocation.
+//
+// Like std::shared_ptr, distinct cow_storage objects may be copied, detached
+// and destroyed concurrently even when they share elements. A single object
+// may be read concurrently, but not detached concurrently with any other use.
+template<class T>
+class cow_storage {
+    struct header {
+        std::atomic<std::size_t> refs;
+        std::size_t size;
+    };
+
+    static constexpr std::size_t alignment_ = alignof(T) > alignof(header) ? alignof(T) : alignof(header);
+    static constexpr std::size_t elements_offset_ = (sizeof(header) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+public:
+    ~cow_storage() noexcept { reset(); }
+    cow_storage() noexcept = default;
+
+    explicit cow_storage(std::size_t const n) : header_(allocate(n)) {
+        try {
+            std::uninitialized_value_construct_n(elements(), n);
+        }
+        catch (...) {
+            deallocate(header_);
+            throw;
+        }
+    }
+
+    cow_storage(cow_storage const& other) noexcept : header_(other.header_) {
+        if (header_ != nullptr)
+            header_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    cow_storage(cow_storage&& other) noexcept : header_(std::exchange(other.header_, nullptr)) {}
+
+    cow_storage& operator=(cow_storage const& other) noexcept {
+        cow_storage(other).swap(*this);
+        return *this;
+    }
+
+    cow_storage& operator=(cow_storage&& other) noexcept {
+        cow_storage(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void swap(cow_storage& other) noexcept { std::swap(header_, other.header_); }
+
+    T* data() const noexcept { return header_ != nullptr ? elements() : nullptr; }
+    std::size_t size() const noexcept { return header_ != nullptr ? header_->size : 0; }
+    std::size_t use_count() const noexcept { return header_ != nullptr ? header_->refs.load(std::memory_order_relaxed) : 0; }
+
+    // Acquire pairs with the release decrement of the last other owner, so
+    // their reads happen before our subsequent writes.
+    bool is_unique() const noexcept { return header_ == nullptr || header_->refs.load(std::memory_order_acquire) == 1; }
+
+    void detach() {
+        if (!is_unique())
+            copy_elements();
+    }
+
+private:
+    T* elements() const noexcept { return reinterpret_cast<T*>(reinterpret_cast<char*>(header_) + elements_offset_); }
+
+    static header* allocate(std::size_t const n) {
+        void* const p = ::operator new(elements_offset_ + n * sizeof(T), std::align_val_t{alignment_});
+        return ::new (p) header{{1}, n};
+    }
+
+    static void deallocate(header* const h) noexcept {
+        h->~header();
+        ::operator delete(static_cast<void*>(h), std::align_val_t{alignment_});
+    }
+
+    void reset() noexcept {
+        if (header_ != nullptr && header_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::destroy_n(elements(), header_->size);
+            deallocate(header_);
+        }
+        header_ = nullptr;
+    }
+
+    void copy_elements() {
+        std::size_t const n = header_->size;
+        header* const h = allocate(n);
+        try {
+            std::uninitialized_copy_n(elements(), n, reinterpret_cast<T*>(reinterpret_cast<char*>(h) + elements_offset_));
+        }
+        catch (...) {
+            deallocate(h);
+            throw;
+        }
+        reset();
+        header_ = h;
+    }
+
+    header* header_ = nullptr;
+};
+
+// Copy-on-write storage: copying a basic_mdarray is O(1) and shares the
+// elements, and the first mutable access through access() or data() on a
+// shared copy makes it a private deep copy. Const access never copies.
+//
+// Copies held by different threads are independent, with the guarantees of
+// cow_storage. An mdarray written from several threads at once (e.g. by
+// for_each_index) must be detached first, by calling the non-const data()
+// before handing it out. References and pointers from a mutable access alias
+// the shared elements once the mdarray is copied again, so do not write
+// through them after taking a copy.
+template<class T>
+struct cow_container_policy {
+    using element_type = T;
+    using container_type = cow_storage<T>;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using reference = T&;
+    using const_reference = T const&;
+    using offset_policy = default_container_policy<T>;
+
+    static constexpr std::size_t alignment = alignof(T);
+
+    container_type create(std::size_t const n) const { return container_type(n); }
+
+    reference access(container_type& c, std::ptrdiff_t const i) {
+        c.detach();
+        return c.data()[i];
+    }
+    const_reference access(container_type const& c, std::ptrdiff_t const i) const { return c.data()[i]; }
+    reference access(pointer const p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return p[i]; }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
+
+    element_type* decay(pointer const p) { return p; }
+    element_type const* decay(pointer const p) const { return p; }
+
+    pointer data(container_type& c) {
+        c.detach();
+        return c.data();
+    }
+    const_pointer data(container_type const& c) const { return c.data(); }
+};
@@ -0,0 +1,403 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "mdarray.hpp"
+
+// Lazy elementwise expressions over basic_mdarray and basic_mdarray_view.
+//
+// Arithmetic, comparison and math functions on mdarrays build an expression
+// tree instead of computing temporaries. Assigning the tree to an mdarray or
+// view evaluates it in one pass:
+//
+//   c = a * b + d;
+//   submdarray(c, 0, full_extent) = sqrt(x) * 2.0f;
+//
+// Operands must have the same rank. A dimension whose static extent is 1
+// broadcasts against the other operand, and scalars broadcast everywhere.
+// Building an expression from operands whose other extents differ, or
+// assigning one to a destination of different extents, throws
+// std::invalid_argument.
+// Expressions refer to basic_mdarray operands by address and must not
+// outlive them.
+
+namespace detail {
+
+template<class T>
+struct is_mdarray_like : std::false_type {};
+
+template<class T, class E, class LP, class CP>
+struct is_mdarray_like<basic_mdarray<T, E, LP, CP>> : std::true_type {};
+
+template<class T, class E, class LP, class CP>
+struct is_mdarray_like<basic_mdarray_view<T, E, LP, CP>> : std::true_type {};
+
+template<class T>
+struct is_mdarray_view : std::false_type {};
+
+template<class T, class E, class LP, class CP>
+struct is_mdarray_view<basic_mdarray_view<T, E, LP, CP>> : std::true_type {};
+
+template<class T>
+inline constexpr bool is_md_operand_v = is_mdarray_like<remove_cvref_t<T>>::value || is_md_expression_v<remove_cvref_t<T>>;
+
+template<class T>
+inline constexpr bool is_md_scalar_v = std::is_arithmetic_v<remove_cvref_t<T>>;
+
+// A basic_mdarray or view as a leaf of an expression.
+template<class MD>
+class md_terminal : public md_expression_base {
+    static constexpr bool is_view_ = is_mdarray_view<MD>::value;
+    using holder_type = std::conditional_t<is_view_, MD, MD const*>;
+
+    constexpr MD const& md() const noexcept {
+        if constexpr (is_view_)
+            return md_;
+        else
+            return *md_;
+    }
+
+    template<std::size_t N, std::size_t... Is>
+    constexpr decltype(auto) at_impl(std::array<std::ptrdiff_t, N> const& idx, std::index_sequence<Is...>) const {
+        // Dimensions with a static extent of 1 are broadcast.
+        return md()((MD::static_extent(Is) == 1 ? std::ptrdiff_t(0) : idx[Is])...);
+    }
+
+public:
+    using layout_type = typename MD::layout_type;
+    static constexpr bool is_scalar = false;
+
+    explicit constexpr md_terminal(MD const& md) noexcept : md_(holder(md)) {}
+
+    static constexpr std::size_t rank() noexcept { return MD::rank(); }
+    static constexpr std::ptrdiff_t static_extent(std::size_t const r) noexcept { return MD::static_extent(r); }
+    constexpr std::ptrdiff_t extent(std::size_t const r) const noexcept { return md().extent(r); }
+
+    template<std::size_t N>
+    constexpr decltype(auto) at(std::array<std::ptrdiff_t, N> const& idx) const {
+        return at_impl(idx, std::make_index_sequence<MD::rank()>{});
+    }
+
+    // True if flat(i) addresses the same element as a destination of layout
+    // `DstLayout` and extents `dst` at storage offset i.
+    template<class DstLayout, class DstExtents>
+    constexpr bool is_flat(DstExtents const& dst) const noexcept {
+        if constexpr (!std::is_same_v<layout_type, DstLayout> || !std::is_pointer_v<decltype(md().data())>)
+            return false;
+        else {
+            for (std::size_t r = 0; r < rank(); ++r) {
+                if (md().extent(r) != dst.extent(r))
+                    return false;
+            }
+            return md().is_contiguous();
+        }
+    }
+
+    constexpr decltype(auto) flat(std::ptrdiff_t const i) const noexcept { return md().data()[i]; }
+
+private:
+    static constexpr holder_type holder(MD const& md) noexcept {
+        if constexpr (is_view_)
+            return md;
+        else
+            return std::addressof(md);
+    }
+
+    holder_type md_;
+};
+
+template<class T>
+class md_scalar : public md_expression_base {
+public:
+    static constexpr bool is_scalar = true;
+
+    explicit constexpr md_scalar(T const value) noexcept : value_(value) {}
+
+    static constexpr std::size_t rank() noexcept { return 0; }
+    static constexpr std::ptrdiff_t static_extent(std::size_t) noexcept { return 1; }
+    constexpr std::ptrdiff_t extent(std::size_t) const noexcept { return 1; }
+
+    template<std::size_t N>
+    constexpr T at(std::array<std::ptrdiff_t, N> const&) const noexcept { return value_; }
+
+    template<class DstLayout, class DstExtents>
+    constexpr bool is_flat(DstExtents const&) const noexcept { return true; }
+
+    constexpr T flat(std::ptrdiff_t) const noexcept { return value_; }
+
+private:
+    T value_;
+};
+
+template<class Op, class E>
+class md_unary : public md_expression_base {
+public:
+    static constexpr bool is_scalar = E::is_scalar;
+
+    constexpr md_unary(Op op, E const& e) noexcept : op_(op), e_(e) {}
+
+    static constexpr std::size_t rank() noexcept { return E::rank(); }
+    static constexpr std::ptrdiff_t static_extent(std::size_t const r) noexcept { return E::static_extent(r); }
+    constexpr std::ptrdiff_t extent(std::size_t const r) const noexcept { return e_.extent(r); }
+
+    template<std::size_t N>
+    constexpr auto at(std::array<std::ptrdiff_t, N> const& idx) const { return op_(e_.at(idx)); }
+
+    template<class DstLayout, class DstExtents>
+    constexpr bool is_flat(DstExtents const& dst) const noexcept { return e_.template is_flat<DstLayout>(dst); }
+
+    constexpr auto flat(std::ptrdiff_t const i) const { return op_(e_.flat(i)); }
+
+private:
+    Op op_;
+    E e_;
+};
+
+template<class Op, class L, class R>
+class md_binary : public md_expression_base {
+    static_assert(L::is_scalar || R::is_scalar || L::rank() == R::rank(), "operands must have the same rank");
+
+public:
+    static constexpr bool is_scalar = L::is_scalar && R::is_scalar;
+
+    constexpr md_binary(Op op, L const& l, R const& r) : op_(op), l_(l), r_(r) {
+        for (std::size_t d = 0; d < rank(); ++d) {
+            if (L::static_extent(d) != 1 && R::static_extent(d) != 1 && l_.extent(d) != r_.extent(d))
+                throw std::invalid_argument("mdarray: expression operands have different extents");
+        }
+    }
+
+    static constexpr std::size_t rank() noexcept { return L::is_scalar ? R::rank() : L::rank(); }
+
+    static constexpr std::ptrdiff_t static_extent(std::size_t const r) noexcept {
+        return L::static_extent(r) == 1 ? R::static_extent(r) : L::static_extent(r);
+    }
+
+    constexpr std::ptrdiff_t extent(std::size_t const r) const noexcept {
+        return L::static_extent(r) == 1 ? r_.extent(r) : l_.extent(r);
+    }
+
+    template<std::size_t N>
+    constexpr auto at(std::array<std::ptrdiff_t, N> const& idx) const { return op_(l_.at(idx), r_.at(idx)); }
+
+    template<class DstLayout, class DstExtents>
+    constexpr bool is_flat(DstExtents const& dst) const noexcept {
+        return l_.template is_flat<DstLayout>(dst) && r_.template is_flat<DstLayout>(dst);
+    }
+
+    constexpr auto flat(std::ptrdiff_t const i) const { return op_(l_.flat(i), r_.flat(i)); }
+
+private:
+    Op op_;
+    L l_;
+    R r_;
+};
+
+template<class T>
+constexpr auto as_expression(T const& x) noexcept {
+    if constexpr (is_md_expression_v<T>)
+        return x;
+    else if constexpr (is_mdarray_like<T>::value)
+        return md_terminal<T>(x);
+    else
+        return md_scalar<T>(x);
+}
+
+template<class Op, class E>
+constexpr auto make_unary(Op op, E const& e) noexcept {
+    auto x = as_expression(e);
+    return md_unary<Op, decltype(x)>(op, x);
+}
+
+template<class Op, class L, class R>
+constexpr auto make_binary(Op op, L const& l, R const& r) {
+    auto x = as_expression(l);
+    auto y = as_expression(r);
+    return md_binary<Op, decltype(x), decltype(y)>(op, x, y);
+}
+
+template<class L, class R>
+using enable_if_md_binary_t = std::enable_if_t<
+    (is_md_operand_v<L> && (is_md_operand_v<R> || is_md_scalar_v<R>)) || (is_md_scalar_v<L> && is_md_operand_v<R>), int>;
+
+template<class T>
+using enable_if_md_operand_t = std::enable_if_t<is_md_operand_v<T>, int>;
+
+struct abs_op { template<class T> constexpr auto operator()(T const x) const { using std::abs; return abs(x); } };
+struct sqrt_op { template<class T> auto operator()(T const x) const { using std::sqrt; return sqrt(x); } };
+struct exp_op { template<class T> auto operator()(T const x) const { using std::exp; return exp(x); } };
+struct log_op { template<class T> auto operator()(T const x) const { using std::log; return log(x); } };
+struct sin_op { template<class T> auto operator()(T const x) const { using std::sin; return sin(x); } };
+struct cos_op { template<class T> auto operator()(T const x) const { using std::cos; return cos(x); } };
+struct tanh_op { template<class T> auto operator()(T const x) const { using std::tanh; return tanh(x); } };
+struct pow_op { template<class T, class U> auto operator()(T const x, U const y) const { using std::pow; return pow(x, y); } };
+struct min_op { template<class T, class U> constexpr auto operator()(T const x, U const y) const { return y < x ? y : x; } };
+struct max_op { template<class T, class U> constexpr auto operator()(T const x, U const y) const { return x < y ? y : x; } };
+
+template<class F>
+struct map_op {
+    F f;
+    template<class... Ts>
+    constexpr auto operator()(Ts const... xs) const { return f(xs...); }
+};
+
+// Assigns the elements of one line along dimension Inner, starting at
+// `start`. Inner is a template parameter so that the index array can live
+// in registers and the line can be vectorized.
+template<std::size_t Inner, class Dst, class Expr, std::size_t Rank>
+constexpr void assign_line(Dst& dst, Expr const& expr, std::array<std::ptrdiff_t, Rank> idx, std::ptrdiff_t const n) {
+    using value_type = typename Dst::value_type;
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        idx[Inner] = i;
+        dst(idx) = static_cast<value_type>(expr.at(idx));
+    }
+}
+
+template<class Dst, class Expr, std::size_t Rank, std::size_t... Rs>
+constexpr void assign_line(Dst& dst, Expr const& expr, std::array<std::ptrdiff_t, Rank> const& idx, std::size_t const inner,
+                           std::ptrdiff_t const n, std::index_sequence<Rs...>) {
+    ((inner == Rs ? assign_line<Rs>(dst, expr, idx, n) : void()), ...);
+}
+
+template<class Dst, class Expr>
+constexpr void assign_expression(Dst& dst, Expr const& expr) {
+    constexpr std::size_t rank = Dst::rank();
+    static_assert(Expr::is_scalar || Expr::rank() == rank, "expression rank does not match the destination");
+    using value_type = typename Dst::value_type;
+    using mapping_type = typename Dst::mapping_type;
+
+    for (std::size_t r = 0; r < rank; ++r) {
+        if (Expr::static_extent(r) != 1 && expr.extent(r) != dst.extent(r))
+            throw std::invalid_argument("mdarray: expression extents do not match the destination");
+    }
+
+    if constexpr (mapping_type::is_always_contiguous() && std::is_pointer_v<typename Dst::pointer>) {
+        if (expr.template is_flat<typename Dst::layout_type>(dst.extents())) {
+            auto* const p = dst.data();
+            std::ptrdiff_t const n = dst.size();
+            for (std::ptrdiff_t i = 0; i < n; ++i)
+                p[i] = static_cast<value_type>(expr.flat(i));
+            return;
+        }
+    }
+
+    std::array<std::ptrdiff_t, rank> idx{};
+    if constexpr (rank == 0) {
+        dst(idx) = static_cast<value_type>(expr.at(idx));
+    }
+    else {
+        if (dst.size() == 0)
+            return;
+        auto const order = loop_order(dst);
+        std::size_t const inner = order[rank - 1];
+        std::ptrdiff_t const inner_extent = dst.extent(inner);
+        for (;;) {
+            assign_line(dst, expr, idx, inner, inner_extent, std::make_index_sequence<rank>{});
+
+            std::size_t k = rank - 1;
+            for (; k-- > 0;) {
+                std::size_t const r = order[k];
+                if (++idx[r] < dst.extent(r))
+                    break;
+                idx[r] = 0;
+            }
+            if (k == std::size_t(-1))
+                return;
+        }
+    }
+}
+
+} // namespace detail
+
+// Evaluates `expr` into `dst` in a single pass. When every operand is
+// contiguous and shares the destination's layout and extents the loop runs
+// over storage offsets and can be vectorized; otherwise it follows the
+// destination's strides.
+template<class T, class E, class LP, class CP, class Expr, detail::enable_if_md_operand_t<Expr> = 0>
+constexpr void assign(basic_mdarray<T, E, LP, CP>& dst, Expr const& expr) {
+    detail::assign_expression(dst, detail::as_expression(expr));
+}
+
+template<class T, class E, class LP, class CP, class Expr, detail::enable_if_md_operand_t<Expr> = 0>
+constexpr void assign(basic_mdarray_view<T, E, LP, CP> dst, Expr const& expr) {
+    detail::assign_expression(dst, detail::as_expression(expr));
+}
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator+(L const& l, R const& r) { return detail::make_binary(std::plus<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator-(L const& l, R const& r) { return detail::make_binary(std::minus<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator*(L const& l, R const& r) { return detail::make_binary(std::multiplies<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator/(L const& l, R const& r) { return detail::make_binary(std::divides<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator%(L const& l, R const& r) { return detail::make_binary(std::modulus<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator==(L const& l, R const& r) { return detail::make_binary(std::equal_to<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator!=(L const& l, R const& r) { return detail::make_binary(std::not_equal_to<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator<(L const& l, R const& r) { return detail::make_binary(std::less<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator<=(L const& l, R const& r) { return detail::make_binary(std::less_equal<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator>(L const& l, R const& r) { return detail::make_binary(std::greater<>{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto operator>=(L const& l, R const& r) { return detail::make_binary(std::greater_equal<>{}, l, r); }
+
+template<class E, detail::enable_if_md_operand_t<E> = 0>
+constexpr auto operator-(E const& e) noexcept { return detail::make_unary(std::negate<>{}, e); }
+
+template<class E, detail::enable_if_md_operand_t<E> = 0>
+constexpr auto abs(E const& e) noexcept { return detail::make_unary(detail::abs_op{}, e); }
+
+template<class E, detail::enable_if_md_operand_t<E> = 0>
+constexpr auto sqrt(E const& e) noexcept { return detail::make_unary(detail::sqrt_op{}, e); }
+
+template<class E, detail::enable_if_md_operand_t<E> = 0>
+constexpr auto exp(E const& e) noexcept { return detail::make_unary(detail::exp_op{}, e); }
+
+template<class E, detail::enable_if_md_operand_t<E> = 0>
+constexpr auto log(E const& e) noexcept { return detail::make_unary(detail::log_op{}, e); }
+
+template<class E, detail::enable_if_md_operand_t<E> = 0>
+constexpr auto sin(E const& e) noexcept { return detail::make_unary(detail::sin_op{}, e); }
+
+template<class E, detail::enable_if_md_operand_t<E> = 0>
+constexpr auto cos(E const& e) noexcept { return detail::make_unary(detail::cos_op{}, e); }
+
+template<class E, detail::enable_if_md_operand_t<E> = 0>
+constexpr auto tanh(E const& e) noexcept { return detail::make_unary(detail::tanh_op{}, e); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto pow(L const& l, R const& r) { return detail::make_binary(detail::pow_op{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto min(L const& l, R const& r) { return detail::make_binary(detail::min_op{}, l, r); }
+
+template<class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto max(L const& l, R const& r) { return detail::make_binary(detail::max_op{}, l, r); }
+
+// Applies a user function elementwise: map([](float x) { return x * x; }, a).
+template<class F, class E, detail::enable_if_md_operand_t<E> = 0>
+constexpr auto map(F f, E const& e) noexcept { return detail::make_unary(detail::map_op<F>{f}, e); }
+
+template<class F, class L, class R, detail::enable_if_md_binary_t<L, R> = 0>
+constexpr auto map(F f, L const& l, R const& r) { return detail::make_binary(detail::map_op<F>{f}, l, r); }
@@ -1,42 +1,88 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 
 static inline constexpr std::ptrdiff_t dynamic_extent = -1;
 
 template<std::ptrdiff_t... Extents>
 inline constexpr std::size_t count_dynamic_extents() {
-    return (static_cast<std::size_t>(Extents == dynamic_extent) + ...);
+    return (std::size_t(0) + ... + static_cast<std::size_t>(Extents == dynamic_extent));
 }
 
-template<std::size_t DynamicCount, std::ptrdiff_t... Extents>
+namespace detail {
+
+// True if every value of From is representable in the signed IndexType.
+template<class IndexType, class From>
+constexpr bool index_always_fits() noexcept {
+    if constexpr (!std::is_integral_v<From>)
+        return true;
+    else if constexpr (std::is_signed_v<From>)
+        return std::numeric_limits<From>::min() >= std::numeric_limits<IndexType>::min() && std::numeric_limits<From>::max() <= std::numeric_limits<IndexType>::max();
+    else
+        return static_cast<std::uintmax_t>(std::numeric_limits<From>::max()) <= static_cast<std::uintmax_t>(std::numeric_limits<IndexType>::max());
+}
+
+template<class IndexType, class From>
+inline constexpr bool index_always_fits_v = index_always_fits<IndexType, From>();
+
+// Converts an extent, stride or span to IndexType, throwing
+// std::overflow_error if it does not fit. Free when every value of From fits.
+template<class IndexType, class From>
+constexpr IndexType checked_index_cast(From const v) {
+    if constexpr (!index_always_fits_v<IndexType, From>) {
+        bool const fits = std::is_signed_v<From> && v < 0
+            ? static_cast<std::intmax_t>(v) >= static_cast<std::intmax_t>(std::numeric_limits<IndexType>::min())
+            : static_cast<std::uintmax_t>(v) <= static_cast<std::uintmax_t>(std::numeric_limits<IndexType>::max());
+        if (!fits)
+            throw std::overflow_error("mdarray: value does not fit in index_type");
+    }
+    return static_cast<IndexType>(v);
+}
+
+// Throws std::invalid_argument if `other` has a dynamic extent where
+// extents type To has a static one, and the two differ.
+template<class To, class From>
+constexpr void check_static_extents(From const& other) {
+    for (std::size_t i = 0; i < From::rank(); ++i) {
+        if (To::static_extent(i) != dynamic_extent && From::static_extent(i) == dynamic_extent
+            && static_cast<std::intmax_t>(other.extent(i)) != static_cast<std::intmax_t>(To::static_extent(i)))
+            throw std::invalid_argument("mdarray: extent does not match static extent");
+    }
+}
+
+} // namespace detail
+
+template<class IndexType, std::size_t DynamicCount, std::ptrdiff_t... Extents>
 class extents_base {
+    static_assert(std::is_integral_v<IndexType> && std::is_signed_v<IndexType>, "index_type must be a signed integral type");
+    static_assert(((Extents == dynamic_extent || (Extents >= 0 && Extents <= std::numeric_limits<IndexType>::max())) && ...),
+                  "static extents must fit in index_type");
 public:
-    using index_type = std::ptrdiff_t;
+    using index_type = IndexType;
 private:
-    static constexpr index_type static_size_ = ((Extents == dynamic_extent ? 1 : Extents) * ...); 
+    static constexpr index_type static_size_ = (index_type(1) * ... * static_cast<index_type>(Extents == dynamic_extent ? 1 : Extents));
+    static constexpr std::array<index_type, sizeof...(Extents)> static_extents_ = {static_cast<index_type>(Extents)...};
 
-    template<std::size_t... Is>
-    static constexpr index_type static_extent_impl(std::size_t const n, std::index_sequence<Is...>) noexcept {
-        return ((n == Is ? Extents : 1) * ...);
+    // Maps every dimension to its slot in dynamic_storage_ so extent() is a
+    // table lookup instead of a recursive walk over the extents pack.
+    static constexpr std::array<std::size_t, sizeof...(Extents)> make_dynamic_indices() noexcept {
+        std::array<std::size_t, sizeof...(Extents)> indices{};
+        std::size_t dynamic_index = 0;
+        for (std::size_t i = 0; i < sizeof...(Extents); ++i)
+            indices[i] = static_extents_[i] == dynamic_extent ? dynamic_index++ : 0;
+        return indices;
     }
 
-    template<std::size_t DynamicIndex>
-    constexpr index_type extent_impl(std::size_t const n, std::integer_sequence<std::ptrdiff_t>, std::index_sequence<>) const noexcept {
-        return 1;
-    }
+    static constexpr std::array<std::size_t, sizeof...(Extents)> dynamic_indices_ = make_dynamic_indices();
 
-    template<std::size_t DynamicIndex, std::ptrdiff_t E, std::ptrdiff_t... Es, std::size_t I, std::size_t... Is>
-    constexpr index_type extent_impl(std::size_t const n, std::integer_sequence<std::ptrdiff_t, E, Es...>, std::index_sequence<I, Is...>) const noexcept {
-        if constexpr (E == dynamic_extent) {
-            return n == I ? dynamic_storage_[DynamicIndex] 
-                          : extent_impl<DynamicIndex + 1>(n, std::integer_sequence<std::ptrdiff_t, Es...>{}, std::index_sequence<Is...>{});
-        }
-        else {
-            return n == I ? E 
-                          : extent_impl<DynamicIndex>(n, std::integer_sequence<std::ptrdiff_t, Es...>{}, std::index_sequence<Is...>{});
-        }
-    }
+    template<class From>
+    static constexpr bool fits_v = detail::index_always_fits_v<index_type, From>;
 
 public:
     ~extents_base() noexcept = default;
@@ -46,48 +92,51 @@ public:
     constexpr extents_base& operator=(extents_base const&) = default;
     constexpr extents_base& operator=(extents_base&&) = default;
 
-    template<class... IndexType>
-    constexpr explicit extents_base(IndexType... DynamicExtents) noexcept 
-        : dynamic_storage_{DynamicExtents...}
+    template<class... OtherIndexType, std::enable_if_t<std::conjunction_v<std::is_convertible<OtherIndexType, index_type>...>, int> = 0>
+    constexpr explicit extents_base(OtherIndexType... DynamicExtents) noexcept((fits_v<OtherIndexType> && ...))
+        : dynamic_storage_{detail::checked_index_cast<index_type>(DynamicExtents)...}
     {
-        static_assert(std::conjunction_v<std::is_convertible<IndexType, index_type>...>, "");
-        static_assert(DynamicCount == sizeof...(IndexType), "");
+        static_assert(DynamicCount == sizeof...(OtherIndexType), "");
     }
 
-    template<class IndexType>
-    constexpr extents_base(std::array<IndexType, DynamicCount> const& other) noexcept {
-        static_assert(std::is_convertible_v<IndexType,  index_type>, "");
+    template<class OtherIndexType>
+    constexpr extents_base(std::array<OtherIndexType, DynamicCount> const& other) noexcept(fits_v<OtherIndexType>) {
+        static_assert(std::is_convertible_v<OtherIndexType,  index_type>, "");
         for (std::size_t i = 0; i < DynamicCount; ++i)
-            dynamic_storage_[i] = other[i];
+            dynamic_storage_[i] = detail::checked_index_cast<index_type>(other[i]);
     }
 
-    template<std::ptrdiff_t... OtherExtents>
-    constexpr extents_base(extents_base<OtherExtents...> const& other) {
+    // Converts from extents of another index type or with other static
+    // extents; throws std::overflow_error if a dynamic extent does not fit in
+    // index_type and std::invalid_argument if a dynamic extent of `other`
+    // differs from the static extent it converts to.
+    template<class OtherIndexType, std::size_t OtherDynamicCount, std::ptrdiff_t... OtherExtents>
+    constexpr extents_base(extents_base<OtherIndexType, OtherDynamicCount, OtherExtents...> const& other) {
         *this = other;
     }
 
-    template<std::ptrdiff_t... OtherExtents>
-    constexpr extents_base& operator=(extents_base<OtherExtents...> const& other) {
+    template<class OtherIndexType, std::size_t OtherDynamicCount, std::ptrdiff_t... OtherExtents>
+    constexpr extents_base& operator=(extents_base<OtherIndexType, OtherDynamicCount, OtherExtents...> const& other) {
         static_assert(sizeof...(Extents) == sizeof...(OtherExtents), "");
-        static_assert(std::conjunction_v<std::conjunction<std::bool_constant<Extents != dynamic_extent>, 
-                                         std::bool_constant<OtherExtents != dynamic_extent>,
-                                         std::bool_constant<Extents == OtherExtents>>...>, "");
+        static_assert(((Extents == dynamic_extent || OtherExtents == dynamic_extent || Extents == OtherExtents) && ...), "");
+        detail::check_static_extents<extents_base>(other);
         std::size_t dynamic_index = 0;
         for (std::size_t i = 0; i < sizeof...(Extents); ++i) {
             if (static_extent(i) == dynamic_extent)
-                dynamic_storage_[dynamic_index++] = other.extent(i);
+                dynamic_storage_[dynamic_index++] = detail::checked_index_cast<index_type>(other.extent(i));
         }
+        return *this;
     }
 
     static constexpr std::size_t rank() noexcept { return sizeof...(Extents); }
     static constexpr std::size_t rank_dynamic() noexcept { return DynamicCount; }
 
     static constexpr index_type static_extent(std::size_t const n) noexcept {
-        return static_extent_impl(n, std::make_index_sequence<sizeof...(Extents)>{});
+        return static_extents_[n];
     }
 
     constexpr index_type extent(std::size_t const n) const noexcept {
-        return extent_impl<0>(n, std::integer_sequence<std::ptrdiff_t, Extents...>{}, std::make_index_sequence<sizeof...(Extents)>{});
+        return static_extents_[n] == dynamic_extent ? dynamic_storage_[dynamic_indices_[n]] : static_extents_[n];
     }
 
     constexpr index_type size() const noexcept { 
@@ -101,18 +150,16 @@ private:
     std::array<index_type, DynamicCount> dynamic_storage_ = {};
 };
 
-template<std::ptrdiff_t... Extents>
-class extents_base<0, Extents...> {
+template<class IndexType, std::ptrdiff_t... Extents>
+class extents_base<IndexType, 0, Extents...> {
+    static_assert(std::is_integral_v<IndexType> && std::is_signed_v<IndexType>, "index_type must be a signed integral type");
     static_assert(((Extents != dynamic_extent) && ...), "");
+    static_assert(((Extents >= 0 && Extents <= std::numeric_limits<IndexType>::max()) && ...), "static extents must fit in index_type");
 public:
-    using index_type = std::ptrdiff_t;
+    using index_type = IndexType;
 private:
-    static constexpr index_type size_ = (Extents * ...);
-
-    template<std::size_t... Is>
-    static constexpr index_type static_extent_impl(std::size_t const n, std::index_sequence<Is...>) noexcept {
-        return ((n == Is ? Extents : 1) * ...);
-    }
+    static constexpr index_type size_ = (index_type(1) * ... * static_cast<index_type>(Extents));
+    static constexpr std::array<index_type, sizeof...(Extents)> static_extents_ = {static_cast<index_type>(Extents)...};
 
 public:
     ~extents_base() noexcept = default;
@@ -122,20 +169,21 @@ public:
     extents_base& operator=(extents_base const&) = default;
     extents_base& operator=(extents_base&&) = default;
 
-    template<class IndexType>
-    constexpr extents_base(std::array<IndexType, 0> const& other) noexcept {
-        static_assert(std::is_convertible_v<IndexType,  index_type>, "");
+    template<class OtherIndexType>
+    constexpr extents_base(std::array<OtherIndexType, 0> const&) noexcept {
+        static_assert(std::is_convertible_v<OtherIndexType,  index_type>, "");
     }
 
-    template<std::ptrdiff_t... OtherExtents>
-    constexpr extents_base(extents_base<OtherExtents...> const& other) {
+    template<class OtherIndexType, std::size_t OtherDynamicCount, std::ptrdiff_t... OtherExtents>
+    constexpr extents_base(extents_base<OtherIndexType, OtherDynamicCount, OtherExtents...> const& other) {
         *this = other;
     }
 
-    template<std::ptrdiff_t... OtherExtents>
-    constexpr extents_base& operator=(extents_base<OtherExtents...> const& other) {
+    template<class OtherIndexType, std::size_t OtherDynamicCount, std::ptrdiff_t... OtherExtents>
+    constexpr extents_base& operator=(extents_base<OtherIndexType, OtherDynamicCount, OtherExtents...> const& other) {
         static_assert(sizeof...(Extents) == sizeof...(OtherExtents), "");
-        static_assert(((Extents == OtherExtents) && ...), "");
+        static_assert(((OtherExtents == dynamic_extent || Extents == OtherExtents) && ...), "");
+        detail::check_static_extents<extents_base>(other);
         return *this;
     }
 
@@ -143,7 +191,7 @@ public:
     static constexpr std::size_t rank_dynamic() noexcept { return 0; }
 
     static constexpr index_type static_extent(std::size_t const n) noexcept {
-        return static_extent_impl(n, std::make_index_sequence<sizeof...(Extents)>{});
+        return static_extents_[n];
     }
 
     constexpr index_type extent(std::size_t const n) const noexcept {
@@ -153,28 +201,35 @@ public:
     constexpr index_type size() const noexcept { return size_; }
 };
 
-template<std::ptrdiff_t... Extents> 
-class extents : public extents_base<count_dynamic_extents<Extents...>(), Extents...> {
-    using base = extents_base<count_dynamic_extents<Extents...>(), Extents...>;
+// Extents whose extent(), strides and offsets are computed in IndexType. A
+// 32-bit index type halves the storage of dynamic extents and strides and
+// keeps offset arithmetic in 32-bit registers; mappings over it throw
+// std::overflow_error if their span does not fit.
+template<class IndexType, std::ptrdiff_t... Extents>
+class basic_extents : public extents_base<IndexType, count_dynamic_extents<Extents...>(), Extents...> {
+    using base = extents_base<IndexType, count_dynamic_extents<Extents...>(), Extents...>;
 public:
     template<class... Args>
-    extents(Args&&... args) : base(std::forward<Args>(args)...) {}
+    constexpr basic_extents(Args&&... args) : base(std::forward<Args>(args)...) {}
 };
 
+template<std::ptrdiff_t... Extents>
+using extents = basic_extents<std::ptrdiff_t, Extents...>;
+
 template<class Lhs, class Rhs, std::size_t... Is>
 constexpr bool extents_equal(Lhs const& lhs, Rhs const& rhs, std::index_sequence<Is...>) noexcept {
-    return ((lhs.extent(Is) == rhs.extent(Is)) && ...);
+    return ((static_cast<std::ptrdiff_t>(lhs.extent(Is)) == static_cast<std::ptrdiff_t>(rhs.extent(Is))) && ...);
 }
 
-template<std::ptrdiff_t... Lhs, std::ptrdiff_t... Rhs>
-constexpr bool operator==(extents<Lhs...> const& lhs, extents<Rhs...> const& rhs) noexcept {
+template<class LhsIndex, std::ptrdiff_t... Lhs, class RhsIndex, std::ptrdiff_t... Rhs>
+constexpr bool operator==(basic_extents<LhsIndex, Lhs...> const& lhs, basic_extents<RhsIndex, Rhs...> const& rhs) noexcept {
     if constexpr (sizeof...(Lhs) != sizeof...(Rhs))
         return false;
     else
         return extents_equal(lhs, rhs, std::make_index_sequence<sizeof...(Lhs)>{});
 }
 
-template<std::ptrdiff_t... Lhs, std::ptrdiff_t... Rhs>
-constexpr bool operator!=(extents<Lhs...> const& lhs, extents<Rhs...> const& rhs) noexcept {
+template<class LhsIndex, std::ptrdiff_t... Lhs, class RhsIndex, std::ptrdiff_t... Rhs>
+constexpr bool operator!=(basic_extents<LhsIndex, Lhs...> const& lhs, basic_extents<RhsIndex, Rhs...> const& rhs) noexcept {
     return !(lhs == rhs);
 }
\ No newline at end of file
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstdio>
+
+#include "mdarray.hpp"
+
+#if defined(MDARRAY_INSTRUMENT)
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#endif
+
+// Opt-in bounds checking and access profiling. layout_instrumented<L> lays
+// elements out exactly as L does. When MDARRAY_INSTRUMENT is defined (the
+// MDARRAY_INSTRUMENT CMake option), its mapping also checks every index
+// passed to operator() against extent(r) and records the access in the
+// array's access_profile. An out-of-range index prints the index and the
+// extents and aborts, since element access is noexcept.
+//
+// Each access is classified by the distance from the previous offset of the
+// same array: repeated (0), sequential (+-1), strided (the same distance as
+// the previous step) or random (anything else). write_access_report() prints
+// one line per array that was accessed; if it is never called, the report
+// is written to stderr at exit. Arrays whose accesses are mostly strided or
+// random are the ones that deserve a different layout.
+//
+// Only element access through a mapping is observed: an array shares its
+// profile with its copies, its view() and arrays constructed from its
+// mapping(). submdarray slices use layout_stride, and algorithms that
+// address data() directly bypass the mapping. Counters are relaxed atomics,
+// so concurrent access from several threads is counted exactly but
+// classified approximately.
+//
+// Without MDARRAY_INSTRUMENT, layout_instrumented<L> is L itself, so an
+// instrumented array is the same type, and compiles to the same code, as an
+// uninstrumented one; set_access_label and write_access_report do nothing.
+
+#if defined(MDARRAY_INSTRUMENT)
+
+// Access counts of one array. Each access costs one relaxed atomic
+// increment; the first access of an array counts as random.
+struct access_profile {
+    explicit access_profile(std::size_t const id, std::string extents) : id(id), extents(std::move(extents)) {}
+
+    std::size_t const id;
+    std::string const extents;
+    std::string label;
+
+    std::atomic<std::uint64_t> repeated{0};
+    std::atomic<std::uint64_t> sequential{0};
+    std::atomic<std::uint64_t> strided{0};
+    std::atomic<std::uint64_t> random{0};
+
+    std::uint64_t accesses() const noexcept {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        return repeated.load(relaxed) + sequential.load(relaxed) + strided.load(relaxed) + random.load(relaxed);
+    }
+
+    void record(std::ptrdiff_t const offset) noexcept {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        std::ptrdiff_t const step = offset - last_offset_.load(relaxed);
+        std::ptrdiff_t const last_step = last_step_.load(relaxed);
+        last_offset_.store(offset, relaxed);
+        last_step_.store(step, relaxed);
+        if (step == 0)
+            repeated.fetch_add(1, relaxed);
+        else if (step == 1 || step == -1)
+            sequential.fetch_add(1, relaxed);
+        else if (step == last_step) {
+            strided.fetch_add(1, relaxed);
+            stride_.store(step, relaxed);
+        }
+        else
+            random.fetch_add(1, relaxed);
+    }
+
+    // The most recent non-unit step classified as strided; 0 if none.
+    std::ptrdiff_t stride() const noexcept { return stride_.load(std::memory_order_relaxed); }
+
+private:
+    // Far enough from any offset that the first step is never 0 or +-1.
+    std::atomic<std::ptrdiff_t> last_offset_{std::numeric_limits<std::ptrdiff_t>::min() / 2};
+    std::atomic<std::ptrdiff_t> last_step_{0};
+    std::atomic<std::ptrdiff_t> stride_{0};
+};
+
+namespace detail {
+
+// Owns the profiles of every instrumented array, so arrays destroyed before
+// the report still appear in it. Profiles that were never accessed are
+// dropped once their last mapping is gone.
+class access_registry {
+public:
+    static access_registry& global() {
+        static access_registry registry;
+        return registry;
+    }
+
+    std::shared_ptr<access_profile> create(std::string extents) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (profiles_.size() >= prune_at_) {
+            profiles_.erase(std::remove_if(profiles_.begin(), profiles_.end(), [](auto const& p) {
+                return p.use_count() == 1 && p->accesses() == 0;
+            }), profiles_.end());
+            prune_at_ = std::max<std::size_t>(64, 2 * profiles_.size());
+        }
+        profiles_.push_back(std::make_shared<access_profile>(++last_id_, std::move(extents)));
+        return profiles_.back();
+    }
+
+    void write_report(std::FILE* const out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reported_ = true;
+        std::fprintf(out, "mdarray access report\n");
+        std::fprintf(out, "  %-24s %-20s %12s %7s %7s %7s %7s  %s\n", "array", "extents", "accesses", "repeat", "seq", "strided",
+                     "random", "note");
+        for (auto const& p : profiles_) {
+            std::uint64_t const n = p->accesses();
+            if (n == 0)
+                continue;
+            auto const percent = [&](std::atomic<std::uint64_t> const& c) { return 100.0 * double(c.load(std::memory_order_relaxed)) / double(n); };
+            double const strided = percent(p->strided);
+            double const random = percent(p->random);
+            std::string const name = "#" + std::to_string(p->id) + (p->label.empty() ? "" : " " + p->label);
+            char note[64] = "";
+            if (strided >= 50.0)
+                std::snprintf(note, sizeof(note), "mostly stride %td", p->stride());
+            else if (random >= 50.0)
+                std::snprintf(note, sizeof(note), "mostly random");
+            std::fprintf(out, "  %-24s %-20s %12llu %6.1f%% %6.1f%% %6.1f%% %6.1f%%  %s\n", name.c_str(), p->extents.c_str(),
+                         static_cast<unsigned long long>(n), percent(p->repeated), percent(p->sequential), strided, random, note);
+        }
+    }
+
+    ~access_registry() {
+        bool const accessed = std::any_of(profiles_.begin(), profiles_.end(),
+                                          [](auto const& p) { return p->accesses() != 0; });
+        if (accessed && !reported_)
+            write_report(stderr);
+    }
+
+private:
+    access_registry() = default;
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<access_profile>> profiles_;
+    std::size_t prune_at_ = 64;
+    std::size_t last_id_ = 0;
+    mutable bool reported_ = false;
+};
+
+template<class Extents>
+std::string format_extents(Extents const& e) {
+    std::string s = "[";
+    for (std::size_t r = 0; r < Extents::rank(); ++r)
+        s += (r == 0 ? "" : ", ") + std::to_string(e.extent(r));
+    return s + "]";
+}
+
+template<class Extents, class Layout>
+class instrumented_mapping : public Layout::template mapping<Extents> {
+    using base_mapping = typename Layout::template mapping<Extents>;
+    using index_type = typename Extents::index_type;
+
+    std::shared_ptr<access_profile> make_profile() const {
+        return access_registry::global().create(format_extents(static_cast<Extents const&>(*this)));
+    }
+
+    template<class... Indices>
+    [[noreturn]] void out_of_bounds(Indices... is) const noexcept {
+        std::array<std::ptrdiff_t, sizeof...(Indices)> const idx = {static_cast<std::ptrdiff_t>(is)...};
+        std::string s = "(";
+        for (std::size_t r = 0; r < idx.size(); ++r)
+            s += (r == 0 ? "" : ", ") + std::to_string(idx[r]);
+        std::fprintf(stderr, "mdarray: index %s) out of bounds for extents %s of array #%zu%s%s\n", s.c_str(),
+                     profile_->extents.c_str(), profile_->id, profile_->label.empty() ? "" : " ", profile_->label.c_str());
+        std::abort();
+    }
+
+    template<std::size_t... Rs, class... Indices>
+    bool in_bounds(std::index_sequence<Rs...>, Indices... is) const noexcept {
+        return ((static_cast<std::ptrdiff_t>(is) >= 0 && static_cast<std::ptrdiff_t>(is) < this->extent(Rs)) && ...);
+    }
+
+public:
+    static constexpr bool observes_indices = true;
+
+    using base_mapping::base_mapping;
+    instrumented_mapping() : base_mapping() {}
+    instrumented_mapping(base_mapping const& m) : base_mapping(m) {}
+    instrumented_mapping(instrumented_mapping const&) = default;
+    instrumented_mapping(instrumented_mapping&&) noexcept = default;
+
+    instrumented_mapping& operator=(instrumented_mapping const&) = default;
+    instrumented_mapping& operator=(instrumented_mapping&&) noexcept = default;
+
+    template<class... Indices>
+    index_type operator()(Indices... is) const noexcept {
+        if (!in_bounds(std::index_sequence_for<Indices...>{}, is...))
+            out_of_bounds(is...);
+        index_type const offset = base_mapping::operator()(is...);
+        profile_->record(offset);
+        return offset;
+    }
+
+    access_profile& profile() const noexcept { return *profile_; }
+
+    template<class OtherExtents>
+    bool operator==(instrumented_mapping<OtherExtents, Layout> const& other) const noexcept {
+        return static_cast<base_mapping const&>(*this) == static_cast<typename Layout::template mapping<OtherExtents> const&>(other);
+    }
+
+    template<class OtherExtents>
+    bool operator!=(instrumented_mapping<OtherExtents, Layout> const& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    std::shared_ptr<access_profile> profile_ = make_profile();
+};
+
+} // namespace detail
+
+template<class Layout>
+struct layout_instrumented {
+    template<class Extents>
+    using mapping = detail::instrumented_mapping<Extents, Layout>;
+};
+
+// Names `md` in the access report and in out-of-bounds messages.
+template<class MD>
+void set_access_label(MD const& md, char const* const label) {
+    if constexpr (detail::observes_indices_v<typename MD::mapping_type>)
+        md.mapping().profile().label = label;
+}
+
+inline void write_access_report(std::FILE* const out = stderr) {
+    detail::access_registry::global().write_report(out);
+}
+
+#else
+
+template<class Layout>
+using layout_instrumented = Layout;
+
+template<class MD>
+void set_access_label(MD const&, char const*) noexcept {}
+
+inline void write_access_report(std::FILE* = stderr) noexcept {}
+
+#endif
@@ -1,48 +1,150 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
+#include "extents.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MDARRAY_MORTON_X86 1
+#endif
+
+#if defined(MDARRAY_MORTON_X86) && defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 namespace detail {
 
-template<class Extents, bool IsLeft>
-class mapping_base : public Extents {
+// The strides of a mapping_base. Held as a base class so that it adds no
+// bytes when all extents are static and there is nothing to store.
+template<class StrideArray, bool IsStatic>
+struct mapping_strides {
+    constexpr mapping_strides() noexcept = default;
+    constexpr explicit mapping_strides(StrideArray const& s) noexcept : strides_(s) {}
+
+    StrideArray strides_{};
+};
+
+template<class StrideArray>
+struct mapping_strides<StrideArray, true> {};
+
+// Pad > 1 rounds the pitch of the leading (unit-stride) dimension up to a
+// multiple of Pad elements, skipping multiples of 8 * Pad so that
+// power-of-two extents do not map successive rows or columns onto the same
+// cache sets.
+//
+// With an index type narrower than std::ptrdiff_t the strides are computed
+// in std::ptrdiff_t, and construction throws std::overflow_error if the span
+// does not fit in the index type; offsets are then computed in it unchecked.
+template<class Extents, bool IsLeft, std::size_t Pad = 1>
+class mapping_base : public Extents, private mapping_strides<std::array<typename Extents::index_type, Extents::rank()>, Extents::rank_dynamic() == 0> {
+    static_assert(Pad > 0, "");
+
     using index_type = typename Extents::index_type;
+    using stride_array = std::array<index_type, Extents::rank()>;
+
+    static constexpr bool checks_span_ = !index_always_fits_v<index_type, std::ptrdiff_t>;
+    static constexpr bool is_static_ = (Extents::rank_dynamic() == 0);
+    static constexpr bool is_padded_ = (Pad > 1 && Extents::rank() > 1);
+    static constexpr std::size_t leading_ = IsLeft ? 0 : Extents::rank() - 1;
+    static constexpr std::size_t outermost_ = IsLeft ? Extents::rank() - 1 : 0;
+
+    static constexpr std::ptrdiff_t padded_extent(std::size_t const r, std::ptrdiff_t const e) noexcept {
+        if (!is_padded_ || r != leading_)
+            return e;
+        constexpr auto pad = static_cast<std::ptrdiff_t>(Pad);
+        std::ptrdiff_t const pitch = (e + pad - 1) / pad * pad;
+        return (pitch / pad) % 8 == 0 ? pitch + pad : pitch;
+    }
+
+    template<class ExtentFn>
+    static constexpr stride_array compute_strides(ExtentFn const& extent) noexcept(!checks_span_) {
+        stride_array s{};
+        std::ptrdiff_t product = 1;
+        if constexpr (IsLeft) {
+            for (std::size_t r = 0; r < Extents::rank(); ++r) {
+                s[r] = static_cast<index_type>(product);
+                product *= padded_extent(r, extent(r));
+            }
+        }
+        else { // IsRight
+            for (std::size_t r = Extents::rank(); r-- > 0;) {
+                s[r] = static_cast<index_type>(product);
+                product *= padded_extent(r, extent(r));
+            }
+        }
+        if constexpr (checks_span_)
+            (void)checked_index_cast<index_type>(product);
+        return s;
+    }
+
+    // With all extents static the strides are folded into constants, so the
+    // offset computation reduces to a dot product with immediates.
+    static constexpr stride_array static_strides_ = compute_strides([](std::size_t const r) { return Extents::static_extent(r); });
+
+    using stride_storage = mapping_strides<stride_array, is_static_>;
+
+    constexpr stride_storage make_strides() const noexcept(!checks_span_) {
+        if constexpr (is_static_)
+            return {};
+        else
+            return stride_storage(compute_strides([this](std::size_t const r) { return static_cast<Extents const&>(*this).extent(r); }));
+    }
+
+    template<std::size_t I>
+    constexpr index_type stride_at() const noexcept {
+        if constexpr (is_static_)
+            return static_strides_[I];
+        else
+            return this->strides_[I];
+    }
 
     template<std::size_t... Is, class... Indices>
-    index_type op_helper(std::index_sequence<Is...>, Indices... is) const {
-        return ((is * stride(Is)) + ...);
+    constexpr index_type op_helper(std::index_sequence<Is...>, Indices... is) const noexcept {
+        return ((static_cast<index_type>(is) * stride_at<Is>()) + ...);
     }
 public:
-    constexpr mapping_base() noexcept : Extents() {}
-    constexpr mapping_base(mapping_base const& other) noexcept : Extents(static_cast<Extents const&>(other)) {}
-    constexpr mapping_base(mapping_base&& other) noexcept : Extents(std::move(static_cast<std::add_rvalue_reference_t<Extents>>(other))) {}
-    constexpr mapping_base(Extents const& e) noexcept : Extents(e) {}
-    template<class OtherExtents, bool B>
-    constexpr mapping_base(mapping_base<OtherExtents, B> const& other) : Extents(static_cast<OtherExtents const&>(other)) {}
+    constexpr mapping_base() noexcept : Extents(), stride_storage(make_strides()) {}
+    constexpr mapping_base(mapping_base const&) noexcept = default;
+    constexpr mapping_base(mapping_base&&) noexcept = default;
+    constexpr mapping_base(Extents const& e) noexcept(!checks_span_) : Extents(e), stride_storage(make_strides()) {}
+    template<class OtherExtents, bool B, std::size_t P>
+    constexpr mapping_base(mapping_base<OtherExtents, B, P> const& other) : Extents(static_cast<OtherExtents const&>(other)), stride_storage(make_strides()) {}
 
     mapping_base& operator=(mapping_base&&) noexcept = default;
     mapping_base& operator=(mapping_base const& other) noexcept = default;
-    template<class OtherExtents, bool B>
-    constexpr mapping_base& operator=(mapping_base<OtherExtents, B> const& other) {
+    template<class OtherExtents, bool B, std::size_t P>
+    constexpr mapping_base& operator=(mapping_base<OtherExtents, B, P> const& other) {
         static_cast<Extents&>(*this) = static_cast<OtherExtents const&>(other);
+        static_cast<stride_storage&>(*this) = make_strides();
         return *this;
     }
 
-    Extents extents() const noexcept { return static_cast<Extents const&>(*this); }
+    constexpr Extents extents() const noexcept { return static_cast<Extents const&>(*this); }
 
     constexpr index_type required_span_size() const noexcept {
-        return static_cast<Extents const&>(*this).size();
+        index_type const size = static_cast<Extents const&>(*this).size();
+        if constexpr (is_padded_)
+            return size == 0 ? 0 : stride(outermost_) * static_cast<Extents const&>(*this).extent(outermost_);
+        else
+            return size;
     }
 
-    index_type operator[](index_type i) const {
+    // Offset of index i along the outermost dimension.
+    constexpr index_type operator[](index_type const i) const noexcept {
         if constexpr (Extents::rank() == 0)
             return 0;
         else
-            return i * stride(i);
+            return i * stride(outermost_);
     }
 
     template<class... Indices>
-    index_type operator()(Indices... is) const {
+    constexpr index_type operator()(Indices... is) const noexcept {
         static_assert(sizeof...(Indices) == Extents::rank());
         static_assert((std::is_convertible_v<Indices, index_type> && ...), "");
 
@@ -53,37 +155,508 @@ public:
     }
 
     static constexpr bool is_always_unique() { return true; }
-    static constexpr bool is_always_contiguous() { return true; }
+    static constexpr bool is_always_contiguous() { return !is_padded_; }
     static constexpr bool is_always_strided() { return true; }
 
     constexpr bool is_unique() const { return true; }
-    constexpr bool is_contiguous() const { return true; }
+    constexpr bool is_contiguous() const {
+        if constexpr (is_padded_) {
+            index_type const e = static_cast<Extents const&>(*this).extent(leading_);
+            return padded_extent(leading_, e) == e;
+        }
+        else
+            return true;
+    }
     constexpr bool is_strided() const { return true; }
 
-    index_type stride(std::size_t const r) const noexcept {
-        if constexpr (IsLeft) {
-            index_type s = 1;
-            for (std::size_t k = 0; k < r; ++k)
-                s *= static_cast<Extents const&>(*this).extent(k);
-            return s;
+    constexpr index_type stride(std::size_t const r) const noexcept {
+        if constexpr (is_static_)
+            return static_strides_[r];
+        else
+            return this->strides_[r];
+    }
+
+    template<class OtherExtents, bool B, std::size_t P>
+    constexpr bool operator==(mapping_base<OtherExtents, B, P> const& other) const noexcept {
+        if (!(static_cast<Extents const&>(*this) == static_cast<OtherExtents const&>(other)))
+            return false;
+        for (std::size_t r = 0; r < Extents::rank(); ++r) {
+            if (stride(r) != other.stride(r))
+                return false;
         }
-        else { // IsRight
-            index_type s = 1;
-            for (std::size_t k = r + 1; k < static_cast<Extents const&>(*this).rank(); ++k)
-                s *= static_cast<Extents const&>(*this).extent(r);
-            return s;
+        return true;
+    }
+
+    template<class OtherExtents, bool B, std::size_t P>
+    constexpr bool operator!=(mapping_base<OtherExtents, B, P> const& other) const noexcept {
+        return !(*this == other);
+    }
+};
+
+template<class Extents>
+class stride_mapping : public Extents {
+    using index_type = typename Extents::index_type;
+    using stride_array = std::array<index_type, Extents::rank()>;
+
+    static constexpr bool checks_span_ = !index_always_fits_v<index_type, std::ptrdiff_t>;
+
+    template<std::size_t... Is, class... Indices>
+    constexpr index_type op_helper(std::index_sequence<Is...>, Indices... is) const noexcept {
+        return ((static_cast<index_type>(is) * strides_[Is]) + ...);
+    }
+
+    static constexpr stride_array right_strides(Extents const& e) noexcept {
+        stride_array s{};
+        index_type product = 1;
+        for (std::size_t r = Extents::rank(); r-- > 0;) {
+            s[r] = product;
+            product *= e.extent(r);
+        }
+        return s;
+    }
+
+    // The span computed in std::ptrdiff_t must fit in index_type.
+    constexpr void check_span() const {
+        if constexpr (checks_span_) {
+            std::ptrdiff_t span = 1;
+            for (std::size_t r = 0; r < Extents::rank(); ++r) {
+                std::ptrdiff_t const e = static_cast<Extents const&>(*this).extent(r);
+                if (e == 0)
+                    return;
+                span += (e - 1) * static_cast<std::ptrdiff_t>(strides_[r]);
+            }
+            (void)checked_index_cast<index_type>(span);
+        }
+    }
+public:
+    constexpr stride_mapping() noexcept : Extents(), strides_(right_strides(*this)) {}
+    constexpr stride_mapping(stride_mapping const&) noexcept = default;
+    constexpr stride_mapping(stride_mapping&&) noexcept = default;
+    constexpr stride_mapping(Extents const& e, stride_array const& strides) noexcept(!checks_span_) : Extents(e), strides_(strides) { check_span(); }
+    // Strides of another index type, checked to fit in index_type.
+    template<class OtherIndexType, std::enable_if_t<!std::is_same_v<OtherIndexType, index_type>, int> = 0>
+    constexpr stride_mapping(Extents const& e, std::array<OtherIndexType, Extents::rank()> const& strides) : Extents(e) {
+        for (std::size_t r = 0; r < Extents::rank(); ++r)
+            strides_[r] = checked_index_cast<index_type>(strides[r]);
+        check_span();
+    }
+    template<class OtherExtents, bool B, std::size_t P>
+    constexpr stride_mapping(mapping_base<OtherExtents, B, P> const& other) : Extents(static_cast<OtherExtents const&>(other)) {
+        for (std::size_t r = 0; r < Extents::rank(); ++r)
+            strides_[r] = checked_index_cast<index_type>(other.stride(r));
+        check_span();
+    }
+
+    stride_mapping& operator=(stride_mapping&&) noexcept = default;
+    stride_mapping& operator=(stride_mapping const&) noexcept = default;
+
+    constexpr Extents extents() const noexcept { return static_cast<Extents const&>(*this); }
+    constexpr stride_array strides() const noexcept { return strides_; }
+
+    constexpr index_type required_span_size() const noexcept {
+        index_type span = 1;
+        for (std::size_t r = 0; r < Extents::rank(); ++r) {
+            index_type const e = static_cast<Extents const&>(*this).extent(r);
+            if (e == 0)
+                return 0;
+            span += (e - 1) * strides_[r];
+        }
+        return span;
+    }
+
+    template<class... Indices>
+    constexpr index_type operator()(Indices... is) const noexcept {
+        static_assert(sizeof...(Indices) == Extents::rank());
+        static_assert((std::is_convertible_v<Indices, index_type> && ...), "");
+
+        if constexpr (Extents::rank() == 0)
+            return 0;
+        else
+            return op_helper(std::make_index_sequence<sizeof...(Indices)>{}, is...);
+    }
+
+    static constexpr bool is_always_unique() { return true; }
+    static constexpr bool is_always_contiguous() { return false; }
+    static constexpr bool is_always_strided() { return true; }
+
+    constexpr bool is_unique() const { return true; }
+    constexpr bool is_contiguous() const { return required_span_size() == static_cast<Extents const&>(*this).size(); }
+    constexpr bool is_strided() const { return true; }
+
+    constexpr index_type stride(std::size_t const r) const noexcept { return strides_[r]; }
+
+    template<class OtherExtents>
+    constexpr bool operator==(stride_mapping<OtherExtents> const& other) const noexcept {
+        if (!(static_cast<Extents const&>(*this) == static_cast<OtherExtents const&>(other)))
+            return false;
+        for (std::size_t r = 0; r < Extents::rank(); ++r) {
+            if (strides_[r] != other.stride(r))
+                return false;
+        }
+        return true;
+    }
+
+    template<class OtherExtents>
+    constexpr bool operator!=(stride_mapping<OtherExtents> const& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    stride_array strides_{};
+};
+
+// Stores the index space as a row-major grid of Tile... sized blocks, each
+// block contiguous and row-major inside. Edge tiles are allocated in full,
+// so the mapping is contiguous only if every extent is a multiple of its
+// tile extent.
+template<class Extents, std::ptrdiff_t... Tile>
+class tiled_mapping : public Extents {
+    static_assert(sizeof...(Tile) == Extents::rank(), "one tile extent per dimension");
+    static_assert(((Tile > 0) && ...), "tile extents must be positive");
+
+    using index_type = typename Extents::index_type;
+    using index_array = std::array<index_type, Extents::rank()>;
+
+    static constexpr bool checks_span_ = !index_always_fits_v<index_type, std::ptrdiff_t>;
+    static constexpr index_array tile_ = {Tile...};
+    static constexpr index_type tile_size_ = (index_type(1) * ... * Tile);
+
+    static constexpr index_array in_tile_strides_ = [] {
+        index_array s{};
+        index_type product = 1;
+        for (std::size_t r = Extents::rank(); r-- > 0;) {
+            s[r] = product;
+            product *= tile_[r];
+        }
+        return s;
+    }();
+
+    constexpr index_type tile_count(std::size_t const r) const noexcept {
+        return (static_cast<Extents const&>(*this).extent(r) + tile_[r] - 1) / tile_[r];
+    }
+
+    constexpr index_array make_tile_strides() const noexcept(!checks_span_) {
+        index_array s{};
+        std::ptrdiff_t product = tile_size_;
+        for (std::size_t r = Extents::rank(); r-- > 0;) {
+            s[r] = static_cast<index_type>(product);
+            product *= tile_count(r);
+        }
+        if constexpr (checks_span_)
+            (void)checked_index_cast<index_type>(product);
+        return s;
+    }
+
+    template<std::size_t... Is, class... Indices>
+    constexpr index_type op_helper(std::index_sequence<Is...>, Indices... is) const noexcept {
+        // Indices are non-negative; unsigned division by the constant tile
+        // extents compiles to shifts and masks for powers of two.
+        using unsigned_index = std::make_unsigned_t<index_type>;
+        return ((static_cast<index_type>(static_cast<unsigned_index>(is) / static_cast<unsigned_index>(tile_[Is])) * tile_strides_[Is]
+                 + static_cast<index_type>(static_cast<unsigned_index>(is) % static_cast<unsigned_index>(tile_[Is])) * in_tile_strides_[Is]) + ...);
+    }
+public:
+    constexpr tiled_mapping() noexcept : Extents(), tile_strides_(make_tile_strides()) {}
+    constexpr tiled_mapping(tiled_mapping const&) noexcept = default;
+    constexpr tiled_mapping(tiled_mapping&&) noexcept = default;
+    constexpr tiled_mapping(Extents const& e) noexcept(!checks_span_) : Extents(e), tile_strides_(make_tile_strides()) {}
+
+    tiled_mapping& operator=(tiled_mapping&&) noexcept = default;
+    tiled_mapping& operator=(tiled_mapping const&) noexcept = default;
+
+    constexpr Extents extents() const noexcept { return static_cast<Extents const&>(*this); }
+    static constexpr index_type tile_extent(std::size_t const r) noexcept { return tile_[r]; }
+
+    constexpr index_type required_span_size() const noexcept {
+        if constexpr (Extents::rank() == 0)
+            return 1;
+        else
+            return static_cast<Extents const&>(*this).size() == 0 ? 0 : tile_strides_[0] * tile_count(0);
+    }
+
+    template<class... Indices>
+    constexpr index_type operator()(Indices... is) const noexcept {
+        static_assert(sizeof...(Indices) == Extents::rank());
+        static_assert((std::is_convertible_v<Indices, index_type> && ...), "");
+
+        if constexpr (Extents::rank() == 0)
+            return 0;
+        else
+            return op_helper(std::make_index_sequence<sizeof...(Indices)>{}, is...);
+    }
+
+    static constexpr bool is_always_unique() { return true; }
+    static constexpr bool is_always_contiguous() { return false; }
+    static constexpr bool is_always_strided() { return false; }
+
+    constexpr bool is_unique() const { return true; }
+    constexpr bool is_contiguous() const { return required_span_size() == static_cast<Extents const&>(*this).size(); }
+    constexpr bool is_strided() const { return Extents::rank() <= 1; }
+
+    // Only meaningful if is_strided().
+    constexpr index_type stride(std::size_t) const noexcept { return 1; }
+
+    template<class OtherExtents>
+    constexpr bool operator==(tiled_mapping<OtherExtents, Tile...> const& other) const noexcept {
+        return static_cast<Extents const&>(*this) == static_cast<OtherExtents const&>(other);
+    }
+
+    template<class OtherExtents>
+    constexpr bool operator!=(tiled_mapping<OtherExtents, Tile...> const& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    index_array tile_strides_{};
+};
+
+// Spreads the low bits of `x` apart so that bit b lands on bit b * step.
+constexpr std::uint64_t spread_bits(std::uint64_t x, std::size_t const bits, std::size_t const step) noexcept {
+    switch (step) {
+    case 1:
+        return x;
+    // The leading stages only move bits above 16 and 8; skip them for
+    // narrower indices.
+    case 2:
+        if (bits > 16)
+            x = (x | x << 16) & 0x0000ffff0000ffff;
+        if (bits > 8)
+            x = (x | x << 8) & 0x00ff00ff00ff00ff;
+        x = (x | x << 4) & 0x0f0f0f0f0f0f0f0f;
+        x = (x | x << 2) & 0x3333333333333333;
+        return (x | x << 1) & 0x5555555555555555;
+    case 3:
+        if (bits > 16)
+            x = (x | x << 32) & 0x001f00000000ffff;
+        if (bits > 8)
+            x = (x | x << 16) & 0x001f0000ff0000ff;
+        x = (x | x << 8) & 0x100f00f00f00f00f;
+        x = (x | x << 4) & 0x10c30c30c30c30c3;
+        return (x | x << 2) & 0x1249249249249249;
+    default: {
+        std::uint64_t result = 0;
+        for (std::size_t b = 0; b < bits; ++b)
+            result |= ((x >> b) & 1) << (b * step);
+        return result;
+    }
+    }
+}
+
+#if defined(MDARRAY_MORTON_X86) && !defined(__BMI2__)
+// pdep is microcoded, and slower than the shifts and masks, on AMD CPUs
+// before Zen 3.
+inline bool detect_fast_pdep() noexcept {
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("bmi2"))
+        return false;
+    return !__builtin_cpu_is("amd") || !(__builtin_cpu_is("bdver4") || __builtin_cpu_is("znver1") || __builtin_cpu_is("znver2"));
+}
+
+// Read on every element access, so a plain flag rather than a function-local
+// static. Arrays used during static initialization may see it still false
+// and take the portable path.
+inline bool const fast_pdep = detect_fast_pdep();
+
+// pdep for builds without -mbmi2. A target("bmi2") function would not be
+// inlined into element access, and the call costs more than pdep saves, so
+// the instruction is emitted directly.
+inline std::uint64_t pdep(std::uint64_t const x, std::uint64_t const mask) noexcept {
+    std::uint64_t result;
+    asm("pdepq %2, %1, %0" : "=r"(result) : "r"(x), "rm"(mask));
+    return result;
+}
+#endif
+
+// Z-order: the offset interleaves the bits of the indices, lowest bits
+// first, so every aligned power-of-two block is contiguous. Once the indices
+// of a dimension run out of bits it drops out of the interleave, so unequal
+// extents do not round the span up to a cube.
+//
+// Each dimension's bits are deposited with BMI2 pdep when compiled with it,
+// or when the CPU has a fast pdep at run time; otherwise the levels where
+// the same set of dimensions interleave form a segment, and each segment is
+// spread with shifts and masks. Equal power-of-two extents form a single
+// segment with a compile-time spread.
+template<class Extents>
+class morton_mapping : public Extents {
+    using index_type = typename Extents::index_type;
+    static constexpr std::size_t rank_ = Extents::rank();
+    static constexpr bool checks_span_ = !index_always_fits_v<index_type, std::ptrdiff_t>;
+
+    struct segment {
+        std::uint32_t first_level = 0;
+        std::uint32_t levels = 0;
+        std::uint32_t step = 0;
+        std::uint32_t offset = 0;
+    };
+
+    struct dimension_code {
+        std::uint64_t mask = 0;
+        std::array<segment, rank_> segments{};
+        std::size_t segment_count = 0;
+    };
+
+    using code_array = std::array<dimension_code, rank_>;
+
+    static constexpr std::size_t bit_width(index_type const n) noexcept {
+        std::size_t bits = 0;
+        for (auto v = static_cast<std::uint64_t>(n); v != 0; v >>= 1)
+            ++bits;
+        return bits;
+    }
+
+    constexpr code_array make_codes() const noexcept {
+        code_array codes{};
+        std::array<std::size_t, rank_> bits{};
+        std::size_t max_bits = 0;
+        for (std::size_t r = 0; r < rank_; ++r) {
+            index_type const e = static_cast<Extents const&>(*this).extent(r);
+            bits[r] = e > 1 ? bit_width(e - 1) : 0;
+            max_bits = bits[r] > max_bits ? bits[r] : max_bits;
         }
+
+        std::size_t out = 0;
+        for (std::size_t first = 0; first < max_bits;) {
+            std::size_t last = max_bits;
+            std::size_t step = 0;
+            for (std::size_t r = 0; r < rank_; ++r) {
+                if (bits[r] > first) {
+                    last = bits[r] < last ? bits[r] : last;
+                    ++step;
+                }
+            }
+            std::size_t position = 0;
+            for (std::size_t r = 0; r < rank_; ++r) {
+                if (bits[r] <= first)
+                    continue;
+                auto& code = codes[r];
+                code.segments[code.segment_count++] = segment{static_cast<std::uint32_t>(first), static_cast<std::uint32_t>(last - first),
+                                                              static_cast<std::uint32_t>(step), static_cast<std::uint32_t>(out + position)};
+                for (std::size_t level = first; level < last; ++level)
+                    code.mask |= std::uint64_t(1) << (out + (level - first) * step + position);
+                ++position;
+            }
+            out += (last - first) * step;
+            first = last;
+        }
+        return codes;
     }
 
-    template<class OtherExtents, bool B>
-    constexpr bool operator==(mapping_base<OtherExtents, B> const& other) const noexcept {
+    // True if every dimension interleaves over all its bits with all others,
+    // as for equal power-of-two extents; encode() then needs no segment loop.
+    constexpr bool make_interleaves_all() const noexcept {
+        for (auto const& code : codes_) {
+            if (code.segment_count != 1 || code.segments[0].step != rank_)
+                return false;
+        }
+        return true;
+    }
+
+    constexpr std::uint64_t encode(std::size_t const r, std::uint64_t const i) const noexcept {
+        auto const& code = codes_[r];
+#if defined(MDARRAY_MORTON_X86) && defined(__BMI2__)
+        if (!__builtin_is_constant_evaluated())
+            return _pdep_u64(i, code.mask);
+#endif
+        if (interleaves_all_)
+            return spread_bits(i, code.segments[0].levels, rank_) << r;
+        std::uint64_t result = 0;
+        for (std::size_t s = 0; s < code.segment_count; ++s) {
+            segment const& seg = code.segments[s];
+            std::uint64_t const bits = (i >> seg.first_level) & ((std::uint64_t(1) << seg.levels) - 1);
+            result |= spread_bits(bits, seg.levels, seg.step) << seg.offset;
+        }
+        return result;
+    }
+
+    template<std::size_t... Is, class... Indices>
+    constexpr index_type op_helper(std::index_sequence<Is...>, Indices... is) const noexcept {
+#if defined(MDARRAY_MORTON_X86) && !defined(__BMI2__)
+        // One test per access, not per dimension, so that loops over the
+        // array can be unswitched on it.
+        if (!__builtin_is_constant_evaluated() && fast_pdep)
+            return static_cast<index_type>((pdep(static_cast<std::uint64_t>(is), codes_[Is].mask) | ...));
+#endif
+        return static_cast<index_type>((encode(Is, static_cast<std::uint64_t>(is)) | ...));
+    }
+public:
+    static constexpr std::size_t tile_bits = Extents::rank() == 0 ? 0 : 9 / Extents::rank();
+
+    constexpr morton_mapping() noexcept : Extents(), codes_(make_codes()), interleaves_all_(make_interleaves_all()) {}
+    constexpr morton_mapping(morton_mapping const&) noexcept = default;
+    constexpr morton_mapping(morton_mapping&&) noexcept = default;
+    constexpr morton_mapping(Extents const& e) noexcept(!checks_span_) : Extents(e), codes_(make_codes()), interleaves_all_(make_interleaves_all()) {
+        if constexpr (checks_span_ && Extents::rank() > 0) {
+            std::uint64_t last = 0;
+            for (std::size_t r = 0; r < Extents::rank(); ++r) {
+                index_type const n = static_cast<Extents const&>(*this).extent(r);
+                if (n == 0)
+                    return;
+                last |= encode(r, static_cast<std::uint64_t>(n - 1));
+            }
+            (void)checked_index_cast<index_type>(last + 1);
+        }
+    }
+
+    morton_mapping& operator=(morton_mapping&&) noexcept = default;
+    morton_mapping& operator=(morton_mapping const&) noexcept = default;
+
+    constexpr Extents extents() const noexcept { return static_cast<Extents const&>(*this); }
+
+    // Aligned blocks of this extent in every dimension (about 512 elements)
+    // are contiguous in memory.
+    static constexpr index_type tile_extent(std::size_t) noexcept { return index_type(1) << tile_bits; }
+
+    constexpr index_type required_span_size() const noexcept {
+        if constexpr (Extents::rank() == 0)
+            return 1;
+        else {
+            std::uint64_t last = 0;
+            for (std::size_t r = 0; r < Extents::rank(); ++r) {
+                index_type const e = static_cast<Extents const&>(*this).extent(r);
+                if (e == 0)
+                    return 0;
+                last |= encode(r, static_cast<std::uint64_t>(e - 1));
+            }
+            return static_cast<index_type>(last) + 1;
+        }
+    }
+
+    template<class... Indices>
+    constexpr index_type operator()(Indices... is) const noexcept {
+        static_assert(sizeof...(Indices) == Extents::rank());
+        static_assert((std::is_convertible_v<Indices, index_type> && ...), "");
+
+        if constexpr (Extents::rank() == 0)
+            return 0;
+        else
+            return op_helper(std::make_index_sequence<sizeof...(Indices)>{}, is...);
+    }
+
+    static constexpr bool is_always_unique() { return true; }
+    static constexpr bool is_always_contiguous() { return false; }
+    static constexpr bool is_always_strided() { return false; }
+
+    constexpr bool is_unique() const { return true; }
+    constexpr bool is_contiguous() const { return required_span_size() == static_cast<Extents const&>(*this).size(); }
+    constexpr bool is_strided() const { return Extents::rank() <= 1; }
+
+    // Only meaningful if is_strided().
+    constexpr index_type stride(std::size_t) const noexcept { return 1; }
+
+    template<class OtherExtents>
+    constexpr bool operator==(morton_mapping<OtherExtents> const& other) const noexcept {
         return static_cast<Extents const&>(*this) == static_cast<OtherExtents const&>(other);
     }
 
-    template<class OtherExtents, bool B>
-    constexpr bool operator!=(mapping_base<OtherExtents, B> const& other) const noexcept {
+    template<class OtherExtents>
+    constexpr bool operator!=(morton_mapping<OtherExtents> const& other) const noexcept {
         return !(*this == other);
     }
+
+private:
+    code_array codes_{};
+    bool interleaves_all_ = false;
 };
 
 } // namespace detail
@@ -96,4 +669,106 @@ struct layout_left {
 struct layout_right {
     template<class Extent>
     using mapping = detail::mapping_base<Extent, false>;
-};
\ No newline at end of file
+};
+
+// layout_left/layout_right with the leading dimension padded to a multiple
+// of `Pad` elements; 64 / sizeof(T) pads rows or columns to cache lines.
+template<std::size_t Pad>
+struct layout_left_padded {
+    template<class Extent>
+    using mapping = detail::mapping_base<Extent, true, Pad>;
+};
+
+template<std::size_t Pad>
+struct layout_right_padded {
+    template<class Extent>
+    using mapping = detail::mapping_base<Extent, false, Pad>;
+};
+
+template<std::size_t Pad>
+using layout_padded = layout_left_padded<Pad>;
+
+struct layout_stride {
+    template<class Extent>
+    using mapping = detail::stride_mapping<Extent>;
+};
+// Row-major grid of contiguous, row-major TileExtents... blocks. Not strided.
+template<std::ptrdiff_t... TileExtents>
+struct layout_tiled {
+    template<class Extent>
+    using mapping = detail::tiled_mapping<Extent, TileExtents...>;
+};
+
+// Z-order (Morton) curve; uses BMI2 pdep where the CPU has a fast one. Not
+// strided.
+struct layout_morton {
+    template<class Extent>
+    using mapping = detail::morton_mapping<Extent>;
+};
+
+// A box of indices [first, first + extents) of a rank-Rank index space.
+template<std::size_t Rank>
+struct tile_region {
+    std::array<std::ptrdiff_t, Rank> first{};
+    std::array<std::ptrdiff_t, Rank> extents{};
+};
+
+// Calls f(tile) for every tile of shape `tile_extents` covering `md`, in
+// row-major tile order. Edge tiles are clipped to the extents of `md`.
+template<class MD, class F>
+void for_each_tile(MD const& md, std::array<std::ptrdiff_t, MD::rank()> const& tile_extents, F&& f) {
+    constexpr std::size_t rank = MD::rank();
+    for (std::size_t r = 0; r < rank; ++r) {
+        if (md.extent(r) == 0)
+            return;
+    }
+    tile_region<rank> tile;
+    for (;;) {
+        for (std::size_t r = 0; r < rank; ++r)
+            tile.extents[r] = std::min(tile_extents[r], md.extent(r) - tile.first[r]);
+        f(static_cast<tile_region<rank> const&>(tile));
+
+        std::size_t r = rank;
+        while (r-- > 0) {
+            tile.first[r] += tile_extents[r];
+            if (tile.first[r] < md.extent(r))
+                break;
+            tile.first[r] = 0;
+        }
+        if (r == std::size_t(-1))
+            return;
+    }
+}
+
+// Tiles of the layout's own block shape (layout_tiled, layout_morton), each
+// of which covers a contiguous range of storage.
+template<class MD, class F>
+void for_each_tile(MD const& md, F&& f) {
+    using mapping_type = typename MD::mapping_type;
+    std::array<std::ptrdiff_t, MD::rank()> tile_extents{};
+    for (std::size_t r = 0; r < MD::rank(); ++r)
+        tile_extents[r] = mapping_type::tile_extent(r);
+    for_each_tile(md, tile_extents, std::forward<F>(f));
+}
+
+namespace detail {
+
+// One loop per dimension, so the compiler sees an ordinary loop nest.
+template<std::size_t D, std::size_t Rank, class F, class... Indices>
+void for_each_index_in_impl(tile_region<Rank> const& tile, F& f, Indices... is) {
+    if constexpr (D == Rank)
+        f(is...);
+    else {
+        std::ptrdiff_t const last = tile.first[D] + tile.extents[D];
+        for (std::ptrdiff_t i = tile.first[D]; i < last; ++i)
+            for_each_index_in_impl<D + 1>(tile, f, is..., i);
+    }
+}
+
+} // namespace detail
+
+// Calls f(i0, i1, ..., iN) for every index in `tile`, last index fastest.
+template<std::size_t Rank, class F>
+void for_each_index_in(tile_region<Rank> const& tile, F&& f) {
+    detail::for_each_index_in_impl<0>(tile, f);
+}
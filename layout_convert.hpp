@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+#include "mdarray.hpp"
+
+// Element copies between mdarrays whose layouts differ, most importantly
+// layout_left <-> layout_right.
+//
+// When source and destination each have a unit-stride dimension and those
+// dimensions differ, every plane spanned by the two is copied with a
+// cache-oblivious transpose: the plane is split recursively until a tile fits
+// in L1, and tiles of 4- and 8-byte elements are transposed in SSE registers.
+
+namespace detail {
+
+inline constexpr std::ptrdiff_t transpose_tile_size = 32;
+
+#if defined(__SSE2__)
+// dst(x, y) = src(x, y) for a 4x4 block, where src(x, y) = src[x + y * ss]
+// and dst(x, y) = dst[y + x * ds].
+inline void transpose4x4_32(void const* const src, std::ptrdiff_t const ss, void* const dst, std::ptrdiff_t const ds) noexcept {
+    auto const* const s = static_cast<float const*>(src);
+    auto* const d = static_cast<float*>(dst);
+    __m128 r0 = _mm_loadu_ps(s);
+    __m128 r1 = _mm_loadu_ps(s + ss);
+    __m128 r2 = _mm_loadu_ps(s + 2 * ss);
+    __m128 r3 = _mm_loadu_ps(s + 3 * ss);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(d, r0);
+    _mm_storeu_ps(d + ds, r1);
+    _mm_storeu_ps(d + 2 * ds, r2);
+    _mm_storeu_ps(d + 3 * ds, r3);
+}
+
+inline void transpose2x2_64(void const* const src, std::ptrdiff_t const ss, void* const dst, std::ptrdiff_t const ds) noexcept {
+    auto const* const s = static_cast<double const*>(src);
+    auto* const d = static_cast<double*>(dst);
+    __m128d const r0 = _mm_loadu_pd(s);
+    __m128d const r1 = _mm_loadu_pd(s + ss);
+    _mm_storeu_pd(d, _mm_unpacklo_pd(r0, r1));
+    _mm_storeu_pd(d + ds, _mm_unpackhi_pd(r0, r1));
+}
+#endif
+
+// Transposes one tile: dst[y + x * ds] = src[x + y * ss] for x < nx, y < ny.
+template<class T>
+void transpose_tile(T const* const src, std::ptrdiff_t const ss, T* const dst, std::ptrdiff_t const ds,
+                    std::ptrdiff_t const nx, std::ptrdiff_t const ny) noexcept {
+    std::ptrdiff_t x0 = 0;
+    std::ptrdiff_t y0 = 0;
+#if defined(__SSE2__)
+    if constexpr (std::is_trivially_copyable_v<T> && (sizeof(T) == 4 || sizeof(T) == 8)) {
+        constexpr std::ptrdiff_t block = sizeof(T) == 4 ? 4 : 2;
+        x0 = nx - nx % block;
+        y0 = ny - ny % block;
+        for (std::ptrdiff_t y = 0; y < y0; y += block) {
+            for (std::ptrdiff_t x = 0; x < x0; x += block) {
+                if constexpr (sizeof(T) == 4)
+                    transpose4x4_32(src + x + y * ss, ss, dst + y + x * ds, ds);
+                else
+                    transpose2x2_64(src + x + y * ss, ss, dst + y + x * ds, ds);
+            }
+        }
+    }
+#endif
+    for (std::ptrdiff_t y = 0; y < ny; ++y) {
+        for (std::ptrdiff_t x = x0; x < nx; ++x)
+            dst[y + x * ds] = src[x + y * ss];
+    }
+    for (std::ptrdiff_t y = y0; y < ny; ++y) {
+        for (std::ptrdiff_t x = 0; x < x0; ++x)
+            dst[y + x * ds] = src[x + y * ss];
+    }
+}
+
+// Cache-oblivious transpose of an nx-by-ny plane: halves the longer side
+// until a tile fits in L1.
+template<class T>
+void transpose_plane(T const* const src, std::ptrdiff_t const ss, T* const dst, std::ptrdiff_t const ds,
+                     std::ptrdiff_t const nx, std::ptrdiff_t const ny) noexcept {
+    if (nx <= transpose_tile_size && ny <= transpose_tile_size) {
+        transpose_tile(src, ss, dst, ds, nx, ny);
+    }
+    else if (nx >= ny) {
+        std::ptrdiff_t const half = nx / 2;
+        transpose_plane(src, ss, dst, ds, half, ny);
+        transpose_plane(src + half, ss, dst + half * ds, ds, nx - half, ny);
+    }
+    else {
+        std::ptrdiff_t const half = ny / 2;
+        transpose_plane(src, ss, dst, ds, nx, half);
+        transpose_plane(src + half * ss, ss, dst + half, ds, nx, ny - half);
+    }
+}
+
+template<class MD>
+std::ptrdiff_t unit_stride_dim(MD const& md) noexcept {
+    if constexpr (MD::is_always_strided()) {
+        for (std::size_t r = 0; r < MD::rank(); ++r) {
+            if (md.stride(r) == 1 && md.extent(r) > 1)
+                return static_cast<std::ptrdiff_t>(r);
+        }
+    }
+    return -1;
+}
+
+// Calls f(idx) for every index of `extents` with idx[a] = idx[b] = 0.
+template<std::size_t Rank, class F>
+void for_each_index_except(std::array<std::ptrdiff_t, Rank> const& extents, std::size_t const a, std::size_t const b, F&& f) {
+    std::array<std::ptrdiff_t, Rank> idx{};
+    for (std::size_t r = 0; r < Rank; ++r) {
+        if (r != a && r != b && extents[r] == 0)
+            return;
+    }
+    for (;;) {
+        f(idx);
+        std::size_t r = Rank;
+        while (r-- > 0) {
+            if (r == a || r == b)
+                continue;
+            if (++idx[r] < extents[r])
+                break;
+            idx[r] = 0;
+        }
+        if (r == std::size_t(-1))
+            return;
+    }
+}
+
+template<class MD, std::size_t Rank>
+std::ptrdiff_t storage_offset(MD const& md, std::array<std::ptrdiff_t, Rank> const& idx) noexcept {
+    std::ptrdiff_t offset = 0;
+    for (std::size_t r = 0; r < Rank; ++r)
+        offset += idx[r] * md.stride(r);
+    return offset;
+}
+
+} // namespace detail
+
+// Copies every element of `src` into `dst`, which must have the same extents.
+template<class Src, class Dst>
+void copy(Src const& src, Dst&& dst) {
+    using dst_type = detail::remove_cvref_t<Dst>;
+    constexpr std::size_t rank = Src::rank();
+    static_assert(rank == dst_type::rank(), "");
+    std::array<std::ptrdiff_t, rank> extents{};
+    for (std::size_t r = 0; r < rank; ++r) {
+        assert(src.extent(r) == dst.extent(r));
+        extents[r] = src.extent(r);
+    }
+
+    if constexpr (detail::has_raw_pointer_v<Src> && detail::has_raw_pointer_v<dst_type>
+                  && Src::is_always_strided() && dst_type::is_always_strided()) {
+        if (detail::same_flat_storage(src, dst)) {
+            std::copy(src.data(), src.data() + src.size(), dst.data());
+            return;
+        }
+
+        std::ptrdiff_t const a = detail::unit_stride_dim(src);
+        std::ptrdiff_t const b = detail::unit_stride_dim(dst);
+        if (a >= 0 && b >= 0) {
+            auto const* const s = src.data();
+            auto* const d = dst.data();
+
+            if (a == b) {
+                // Same fast dimension: copy contiguous rows.
+                std::ptrdiff_t const n = extents[a];
+                detail::for_each_index_except(extents, a, a, [&](auto const& idx) {
+                    auto const* const first = s + detail::storage_offset(src, idx);
+                    std::copy(first, first + n, d + detail::storage_offset(dst, idx));
+                });
+            }
+            else {
+                std::ptrdiff_t const ss = src.stride(b);
+                std::ptrdiff_t const ds = dst.stride(a);
+                detail::for_each_index_except(extents, a, b, [&](auto const& idx) {
+                    detail::transpose_plane(s + detail::storage_offset(src, idx), ss, d + detail::storage_offset(dst, idx), ds, extents[a], extents[b]);
+                });
+            }
+            return;
+        }
+    }
+
+    detail::for_each_index_except(extents, rank, rank, [&](auto const& idx) { dst(idx) = src(idx); });
+}
+
+// Transposes a square rank-2 mdarray or view in place, tile by tile. Each
+// pair of mirrored tiles is exchanged through an L1-resident buffer.
+template<class MD>
+void transpose_in_place(MD&& md) {
+    using md_type = detail::remove_cvref_t<MD>;
+    using value_type = typename md_type::value_type;
+    static_assert(md_type::rank() == 2, "");
+    assert(md.extent(0) == md.extent(1));
+    std::ptrdiff_t const n = md.extent(0);
+
+    std::ptrdiff_t const x = detail::unit_stride_dim(md);
+    if constexpr (detail::has_raw_pointer_v<md_type> && std::is_trivially_copyable_v<value_type>) {
+        if (x >= 0) {
+            constexpr std::ptrdiff_t tile = detail::transpose_tile_size;
+            std::ptrdiff_t const ld = md.stride(1 - x);
+            auto* const p = md.data();
+            value_type buffer[tile * tile];
+
+            for (std::ptrdiff_t x0 = 0; x0 < n; x0 += tile) {
+                std::ptrdiff_t const nx = std::min(tile, n - x0);
+                for (std::ptrdiff_t y0 = x0; y0 < n; y0 += tile) {
+                    std::ptrdiff_t const ny = std::min(tile, n - y0);
+                    // buffer <- new tile (x0, y0), i.e. the transposed old tile (y0, x0).
+                    detail::transpose_tile(p + y0 + x0 * ld, ld, buffer, tile, ny, nx);
+                    if (y0 != x0)
+                        detail::transpose_tile(p + x0 + y0 * ld, ld, p + y0 + x0 * ld, ld, nx, ny);
+                    for (std::ptrdiff_t y = 0; y < ny; ++y)
+                        std::copy(buffer + y * tile, buffer + y * tile + nx, p + x0 + (y0 + y) * ld);
+                }
+            }
+            return;
+        }
+    }
+
+    using std::swap;
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        for (std::ptrdiff_t j = i + 1; j < n; ++j)
+            swap(md(i, j), md(j, i));
+    }
+}
+
+// Returns the elements of `a` in an mdarray with layout `NewLayout`.
+template<class NewLayout, class T, class E, class LP, class CP>
+basic_mdarray<T, E, NewLayout, CP> layout_convert(basic_mdarray<T, E, LP, CP> const& a) {
+    using result_type = basic_mdarray<T, E, NewLayout, CP>;
+    result_type result(typename result_type::mapping_type(a.extents()), a.container_policy());
+    copy(a, result);
+    return result;
+}
+
+// Converts between layout_left and layout_right reusing the storage of `a`
+// when it is a square matrix; otherwise copies.
+template<class NewLayout, class T, class E, class LP, class CP>
+basic_mdarray<T, E, NewLayout, CP> layout_convert(basic_mdarray<T, E, LP, CP>&& a) {
+    constexpr bool swaps_left_right = (std::is_same_v<LP, layout_left> && std::is_same_v<NewLayout, layout_right>)
+                                   || (std::is_same_v<LP, layout_right> && std::is_same_v<NewLayout, layout_left>);
+    if constexpr (E::rank() == 2 && swaps_left_right) {
+        if (a.extent(0) == a.extent(1)) {
+            transpose_in_place(a);
+            return basic_mdarray<T, E, NewLayout, CP>(std::move(a));
+        }
+    }
+    return layout_convert<NewLayout>(static_cast<basic_mdarray<T, E, LP, CP> const&>(a));
+}
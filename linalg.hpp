@@ -0,0 +1,445 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mdarray.hpp"
+#include "parallel.hpp"
+
+// Matrix multiplication and tensor contraction over basic_mdarray and views.
+//
+// Operands are read in place through their own layout and strides; nothing
+// is converted to a BLAS format. The product is computed the way tuned BLAS
+// libraries do it: blocks of B and A are copied ("packed") into small
+// contiguous panels sized for the L2/L3 and L1 caches, and a register-blocked
+// micro-kernel multiplies an MR x KC panel of A with a KC x NR panel of B.
+// The micro-kernel is written with GCC vector extensions and compiled for
+// AVX-512, AVX2+FMA and the baseline instruction set; the widest one the CPU
+// supports is picked at run time. Output blocks are computed in parallel on a
+// thread_pool.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MDARRAY_GEMM_X86 1
+#endif
+
+namespace detail {
+
+// Element types for which the vectorized micro-kernel is used; other
+// arithmetic-like types (long double, std::complex, ...) get a scalar one.
+template<class T>
+inline constexpr bool is_gemm_vector_element_v = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>
+    && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+// Register and cache blocking for one micro-kernel. Two vectors of B per
+// k step times MR rows of A fill 12 of the 16 vector registers of SSE/AVX2,
+// or 24 of the 32 of AVX-512. A KC x NR panel of B stays in L1, an MC x KC
+// block of A in L2 and a KC x NC block of B in L3.
+template<class T, std::size_t VectorBytes>
+struct gemm_blocking {
+    static constexpr std::size_t lanes = is_gemm_vector_element_v<T> ? VectorBytes / sizeof(T) : 4;
+    static constexpr std::size_t mr = VectorBytes == 64 ? 12 : 6;
+    static constexpr std::size_t nr = 2 * lanes;
+    static constexpr std::size_t kc = 256;
+    static constexpr std::size_t mc = std::max(mr, (std::size_t(128) << 10) / (kc * sizeof(T)) / mr * mr);
+    static constexpr std::size_t nc = std::max(nr, (std::size_t(2) << 20) / (kc * sizeof(T)) / nr * nr);
+};
+
+// tile[MR x NR] = a[MR x kc] * b[kc x NR] for packed panels: `a` holds MR
+// values per k step and `b` holds NR values per k step.
+template<class T, std::size_t VectorBytes, std::size_t MR, std::size_t NR>
+#if defined(__GNUC__)
+__attribute__((always_inline))
+#endif
+inline void gemm_micro_kernel_body(std::size_t const kc, T const* a, T const* b, T* const tile) {
+#if defined(__GNUC__)
+    if constexpr (is_gemm_vector_element_v<T>) {
+        constexpr std::size_t lanes = VectorBytes / sizeof(T);
+        static_assert(NR == 2 * lanes, "");
+        typedef T vec __attribute__((vector_size(VectorBytes)));
+
+        vec acc0[MR] = {};
+        vec acc1[MR] = {};
+        for (std::size_t p = 0; p < kc; ++p, a += MR, b += NR) {
+            vec b0;
+            vec b1;
+            std::memcpy(&b0, b, sizeof(vec));
+            std::memcpy(&b1, b + lanes, sizeof(vec));
+#pragma GCC unroll 16
+            for (std::size_t i = 0; i < MR; ++i) {
+                acc0[i] += a[i] * b0;
+                acc1[i] += a[i] * b1;
+            }
+        }
+#pragma GCC unroll 16
+        for (std::size_t i = 0; i < MR; ++i) {
+            std::memcpy(tile + i * NR, &acc0[i], sizeof(vec));
+            std::memcpy(tile + i * NR + lanes, &acc1[i], sizeof(vec));
+        }
+        return;
+    }
+#endif
+    T acc[MR][NR] = {};
+    for (std::size_t p = 0; p < kc; ++p, a += MR, b += NR)
+        for (std::size_t i = 0; i < MR; ++i)
+            for (std::size_t j = 0; j < NR; ++j)
+                acc[i][j] += a[i] * b[j];
+    for (std::size_t i = 0; i < MR; ++i)
+        for (std::size_t j = 0; j < NR; ++j)
+            tile[i * NR + j] = acc[i][j];
+}
+
+template<class T>
+void gemm_micro_kernel_baseline(std::size_t const kc, T const* const a, T const* const b, T* const tile) {
+    using blocking = gemm_blocking<T, 16>;
+    gemm_micro_kernel_body<T, 16, blocking::mr, blocking::nr>(kc, a, b, tile);
+}
+
+#if defined(MDARRAY_GEMM_X86)
+template<class T>
+__attribute__((target("avx2,fma"))) void gemm_micro_kernel_avx2(std::size_t const kc, T const* const a, T const* const b, T* const tile) {
+    using blocking = gemm_blocking<T, 32>;
+    gemm_micro_kernel_body<T, 32, blocking::mr, blocking::nr>(kc, a, b, tile);
+}
+
+template<class T>
+__attribute__((target("avx512f,avx512bw,avx512dq,fma"))) void gemm_micro_kernel_avx512(std::size_t const kc, T const* const a, T const* const b, T* const tile) {
+    using blocking = gemm_blocking<T, 64>;
+    gemm_micro_kernel_body<T, 64, blocking::mr, blocking::nr>(kc, a, b, tile);
+}
+#endif
+
+enum class gemm_isa { baseline, avx2, avx512 };
+
+inline gemm_isa detect_gemm_isa() noexcept {
+#if defined(MDARRAY_GEMM_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq"))
+        return gemm_isa::avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return gemm_isa::avx2;
+#endif
+    return gemm_isa::baseline;
+}
+
+inline gemm_isa selected_gemm_isa() noexcept {
+    static gemm_isa const isa = detect_gemm_isa();
+    return isa;
+}
+
+// Flattened storage offsets of the index space spanned by dimensions
+// [First, Last) of `md`, in row-major order of those dimensions.
+template<std::size_t First, std::size_t Last, class MD>
+std::vector<std::ptrdiff_t> flat_offsets(MD const& md) {
+    std::vector<std::ptrdiff_t> offsets(1, 0);
+    for (std::size_t r = First; r < Last; ++r) {
+        std::vector<std::ptrdiff_t> next;
+        next.reserve(offsets.size() * static_cast<std::size_t>(md.extent(r)));
+        for (std::ptrdiff_t const o : offsets)
+            for (std::ptrdiff_t i = 0; i < md.extent(r); ++i)
+                next.push_back(o + i * md.stride(r));
+        offsets = std::move(next);
+    }
+    return offsets;
+}
+
+// Same for layouts without strides: partial multi-indices with the
+// dimensions outside [First, Last) left at zero.
+template<std::size_t First, std::size_t Last, class MD>
+std::vector<std::array<std::ptrdiff_t, MD::rank()>> flat_indices(MD const& md) {
+    std::vector<std::array<std::ptrdiff_t, MD::rank()>> indices(1);
+    for (std::size_t r = First; r < Last; ++r) {
+        std::vector<std::array<std::ptrdiff_t, MD::rank()>> next;
+        next.reserve(indices.size() * static_cast<std::size_t>(md.extent(r)));
+        for (auto idx : indices)
+            for (idx[r] = 0; idx[r] < md.extent(r); ++idx[r])
+                next.push_back(idx);
+        indices = std::move(next);
+    }
+    return indices;
+}
+
+// An mdarray or view seen as a matrix: dimensions [0, RowDims) form the row
+// index and the remaining ones the column index. Strided operands with a raw
+// data pointer are addressed as data[row_offset + column_offset]; anything
+// else goes through operator().
+template<class MD, std::size_t RowDims>
+class matrix_operand {
+    using md_type = std::remove_const_t<MD>;
+    static constexpr std::size_t rank_ = md_type::rank();
+
+public:
+    static constexpr bool is_direct = has_raw_pointer_v<MD> && md_type::is_always_strided();
+
+    explicit matrix_operand(MD& md) : md_(md) {
+        if constexpr (is_direct) {
+            rows_ = flat_offsets<0, RowDims>(md);
+            cols_ = flat_offsets<RowDims, rank_>(md);
+            regular_ = is_arithmetic_progression(rows_, row_step_) && is_arithmetic_progression(cols_, col_step_);
+        }
+        else {
+            rows_ = flat_indices<0, RowDims>(md);
+            cols_ = flat_indices<RowDims, rank_>(md);
+        }
+    }
+
+    std::size_t rows() const noexcept { return rows_.size(); }
+    std::size_t cols() const noexcept { return cols_.size(); }
+
+    // True if element (i, j) is at address(0, 0)[i * row_step() + j *
+    // col_step()], as for every rank-2 operand.
+    bool is_regular() const noexcept { return regular_; }
+    std::ptrdiff_t row_step() const noexcept { return row_step_; }
+    std::ptrdiff_t col_step() const noexcept { return col_step_; }
+    auto* address(std::size_t const i, std::size_t const j) const { return md_.data() + rows_[i] + cols_[j]; }
+
+    decltype(auto) operator()(std::size_t const i, std::size_t const j) const {
+        if constexpr (is_direct)
+            return md_.data()[rows_[i] + cols_[j]];
+        else {
+            auto idx = rows_[i];
+            for (std::size_t r = RowDims; r < rank_; ++r)
+                idx[r] = cols_[j][r];
+            return md_(idx);
+        }
+    }
+
+private:
+    using position = std::conditional_t<is_direct, std::ptrdiff_t, std::array<std::ptrdiff_t, rank_>>;
+
+    static bool is_arithmetic_progression(std::vector<std::ptrdiff_t> const& v, std::ptrdiff_t& step) {
+        step = v.size() > 1 ? v[1] - v[0] : 0;
+        for (std::size_t i = 1; i < v.size(); ++i) {
+            if (v[i] - v[i - 1] != step)
+                return false;
+        }
+        return true;
+    }
+
+    MD& md_;
+    std::vector<position> rows_;
+    std::vector<position> cols_;
+    bool regular_ = false;
+    std::ptrdiff_t row_step_ = 0;
+    std::ptrdiff_t col_step_ = 0;
+};
+
+// Copies a rows x depth block whose element (i, p) is src[i * rs + p * ds]
+// into panels of W rows, W values per p, zero-padding the last panel. Each
+// panel is read along whichever of i and p has the smaller stride.
+template<std::size_t W, class T, class S>
+void pack_strided(S const* const src, std::ptrdiff_t const rs, std::ptrdiff_t const ds, std::size_t const rows, std::size_t const depth, T* out) {
+    bool const walk_rows = std::abs(rs) <= std::abs(ds);
+    for (std::size_t i0 = 0; i0 < rows; i0 += W, out += W * depth) {
+        std::size_t const n = std::min(W, rows - i0);
+        S const* const s = src + static_cast<std::ptrdiff_t>(i0) * rs;
+        if (walk_rows) {
+            for (std::size_t p = 0; p < depth; ++p) {
+                S const* const sp = s + static_cast<std::ptrdiff_t>(p) * ds;
+                for (std::size_t i = 0; i < n; ++i)
+                    out[p * W + i] = static_cast<T>(sp[static_cast<std::ptrdiff_t>(i) * rs]);
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < n; ++i) {
+                S const* const si = s + static_cast<std::ptrdiff_t>(i) * rs;
+                for (std::size_t p = 0; p < depth; ++p)
+                    out[p * W + i] = static_cast<T>(si[static_cast<std::ptrdiff_t>(p) * ds]);
+            }
+        }
+        if (n < W) {
+            for (std::size_t p = 0; p < depth; ++p)
+                std::fill(out + p * W + n, out + (p + 1) * W, T{});
+        }
+    }
+}
+
+// Copies rows [m0, m0 + mc) x columns [k0, k0 + kc) of `a` into MR-row
+// panels, MR values per column, zero-padding the last panel.
+template<std::size_t MR, class T, class A>
+void pack_a(A const& a, std::size_t const m0, std::size_t const mc, std::size_t const k0, std::size_t const kc, T* out) {
+    if constexpr (A::is_direct) {
+        if (a.is_regular())
+            return pack_strided<MR>(a.address(m0, k0), a.row_step(), a.col_step(), mc, kc, out);
+    }
+    for (std::size_t i0 = 0; i0 < mc; i0 += MR) {
+        std::size_t const rows = std::min(MR, mc - i0);
+        for (std::size_t k = 0; k < kc; ++k, out += MR) {
+            for (std::size_t i = 0; i < rows; ++i)
+                out[i] = static_cast<T>(a(m0 + i0 + i, k0 + k));
+            for (std::size_t i = rows; i < MR; ++i)
+                out[i] = T{};
+        }
+    }
+}
+
+// Copies NR-column panel `panel` of rows [k0, k0 + kc) x columns
+// [n0, n0 + nc) of `b`, NR values per row, zero-padding past column nc.
+template<std::size_t NR, class T, class B>
+void pack_b_panel(B const& b, std::size_t const k0, std::size_t const kc, std::size_t const n0, std::size_t const nc, std::size_t const panel, T* out) {
+    std::size_t const j0 = panel * NR;
+    std::size_t const cols = std::min(NR, nc - j0);
+    out += panel * NR * kc;
+    if constexpr (B::is_direct) {
+        if (b.is_regular())
+            return pack_strided<NR>(b.address(k0, n0 + j0), b.col_step(), b.row_step(), cols, kc, out);
+    }
+    for (std::size_t k = 0; k < kc; ++k, out += NR) {
+        for (std::size_t j = 0; j < cols; ++j)
+            out[j] = static_cast<T>(b(k0 + k, n0 + j0 + j));
+        for (std::size_t j = cols; j < NR; ++j)
+            out[j] = T{};
+    }
+}
+
+// Products below this many multiply-adds run on the calling thread.
+inline constexpr std::size_t gemm_parallel_threshold = std::size_t(1) << 18;
+
+// c = a * b with c rows() x cols() = a rows() x b cols().
+template<class T, class Blocking, class Kernel, class A, class B, class C>
+void gemm(thread_pool& pool, A const& a, B const& b, C& c, Kernel kernel) {
+    constexpr std::size_t mr = Blocking::mr;
+    constexpr std::size_t nr = Blocking::nr;
+    std::size_t const m = a.rows();
+    std::size_t const n = b.cols();
+    std::size_t const k = a.cols();
+
+    if (k == 0) {
+        for (std::size_t i = 0; i < m; ++i)
+            for (std::size_t j = 0; j < n; ++j)
+                c(i, j) = T{};
+        return;
+    }
+
+    bool const parallel = m * n * k >= gemm_parallel_threshold && pool.size() > 1;
+    std::size_t const participants = parallel ? pool.size() : 1;
+    std::vector<T> packed_b(Blocking::kc * std::min(Blocking::nc, (n + nr - 1) / nr * nr));
+
+    for (std::size_t jc = 0; jc < n; jc += Blocking::nc) {
+        std::size_t const nc = std::min(Blocking::nc, n - jc);
+        std::size_t const panels = (nc + nr - 1) / nr;
+
+        for (std::size_t pc = 0; pc < k; pc += Blocking::kc) {
+            std::size_t const kc = std::min(Blocking::kc, k - pc);
+            bool const first = (pc == 0);
+
+            auto pack = [&](std::size_t const panel) { pack_b_panel<nr>(b, pc, kc, jc, nc, panel, packed_b.data()); };
+            if (parallel)
+                pool.parallel_for(panels, pack);
+            else
+                for (std::size_t p = 0; p < panels; ++p)
+                    pack(p);
+
+            // Output tiles: MC-row blocks of A, each split into groups of B
+            // panels when there are too few blocks to keep every thread busy.
+            std::size_t const blocks = (m + Blocking::mc - 1) / Blocking::mc;
+            std::size_t const target = participants * tiles_per_thread;
+            std::size_t const groups = std::min(panels, std::max<std::size_t>(1, (target + blocks - 1) / blocks));
+
+            auto tile_task = [&](std::size_t const t) {
+                thread_local std::vector<T> packed_a;
+                alignas(64) T tile[mr * nr];
+
+                std::size_t const ic = t / groups * Blocking::mc;
+                std::size_t const mc = std::min(Blocking::mc, m - ic);
+                std::size_t const g = t % groups;
+                packed_a.resize(Blocking::mc * Blocking::kc);
+                pack_a<mr>(a, ic, mc, pc, kc, packed_a.data());
+
+                for (std::size_t jr = g * panels / groups; jr < (g + 1) * panels / groups; ++jr) {
+                    std::size_t const cols = std::min(nr, nc - jr * nr);
+                    T const* const bp = packed_b.data() + jr * nr * kc;
+                    for (std::size_t ir = 0; ir < mc; ir += mr) {
+                        kernel(kc, packed_a.data() + ir * kc, bp, tile);
+                        std::size_t const rows = std::min(mr, mc - ir);
+                        for (std::size_t i = 0; i < rows; ++i) {
+                            for (std::size_t j = 0; j < cols; ++j) {
+                                auto&& out = c(ic + ir + i, jc + jr * nr + j);
+                                out = first ? tile[i * nr + j] : static_cast<T>(out + tile[i * nr + j]);
+                            }
+                        }
+                    }
+                }
+            };
+            if (parallel)
+                pool.parallel_for(blocks * groups, tile_task);
+            else
+                for (std::size_t t = 0; t < blocks * groups; ++t)
+                    tile_task(t);
+        }
+    }
+}
+
+template<class T, class A, class B, class C>
+void dispatch_gemm(thread_pool& pool, A const& a, B const& b, C& c) {
+#if defined(MDARRAY_GEMM_X86)
+    if constexpr (is_gemm_vector_element_v<T>) {
+        switch (selected_gemm_isa()) {
+        case gemm_isa::avx512:
+            return gemm<T, gemm_blocking<T, 64>>(pool, a, b, c, gemm_micro_kernel_avx512<T>);
+        case gemm_isa::avx2:
+            return gemm<T, gemm_blocking<T, 32>>(pool, a, b, c, gemm_micro_kernel_avx2<T>);
+        default:
+            break;
+        }
+    }
+#endif
+    gemm<T, gemm_blocking<T, 16>>(pool, a, b, c, gemm_micro_kernel_baseline<T>);
+}
+
+} // namespace detail
+
+// Contracts the last `Axes` dimensions of `a` with the first `Axes`
+// dimensions of `b`:
+//
+//   c(i..., j...) = sum over k... of a(i..., k...) * b(k..., j...)
+//
+// like numpy.tensordot(a, b, Axes). `c` has rank a.rank() + b.rank() - 2 *
+// Axes and is overwritten; it must not alias `a` or `b`. Products are
+// accumulated in c's value type. Any layout and container policy is
+// accepted, but strided operands with raw data pointers are much faster.
+template<std::size_t Axes, class A, class B, class C>
+void contract(thread_pool& pool, A const& a, B const& b, C&& c) {
+    using c_type = detail::remove_cvref_t<C>;
+    static_assert(Axes <= A::rank() && Axes <= B::rank(), "");
+    static_assert(c_type::rank() == A::rank() + B::rank() - 2 * Axes, "");
+    constexpr std::size_t a_rows = A::rank() - Axes;
+
+    for (std::size_t r = 0; r < Axes; ++r)
+        assert(a.extent(a_rows + r) == b.extent(r));
+    for (std::size_t r = 0; r < a_rows; ++r)
+        assert(c.extent(r) == a.extent(r));
+    for (std::size_t r = Axes; r < B::rank(); ++r)
+        assert(c.extent(a_rows + r - Axes) == b.extent(r));
+
+    if (c.size() == 0)
+        return;
+
+    detail::matrix_operand<A const, a_rows> const ma(a);
+    detail::matrix_operand<B const, Axes> const mb(b);
+    detail::matrix_operand<std::remove_reference_t<C>, a_rows> mc(c);
+    detail::dispatch_gemm<typename c_type::value_type>(pool, ma, mb, mc);
+}
+
+template<std::size_t Axes, class A, class B, class C>
+void contract(A const& a, B const& b, C&& c) {
+    contract<Axes>(thread_pool::global(), a, b, std::forward<C>(c));
+}
+
+// c = a * b for a rank-2 `a` and a rank-2 or rank-1 `b`.
+template<class A, class B, class C>
+void matmul(thread_pool& pool, A const& a, B const& b, C&& c) {
+    static_assert(A::rank() == 2 && (B::rank() == 2 || B::rank() == 1), "matmul takes a matrix and a matrix or vector");
+    contract<1>(pool, a, b, std::forward<C>(c));
+}
+
+template<class A, class B, class C>
+void matmul(A const& a, B const& b, C&& c) {
+    matmul(thread_pool::global(), a, b, std::forward<C>(c));
+}
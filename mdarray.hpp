@@ -1,5 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <stdexcept>
 #include <tuple>
 #include <type_traits>
 
@@ -15,19 +19,19 @@ using seq = std::integer_sequence<std::ptrdiff_t, N...>;
 template<class Out, class In>
 struct remove_extents_tail_impl;
 
-template<std::ptrdiff_t... Es, std::ptrdiff_t Tail>
-struct remove_extents_tail_impl<extents<Es...>, extents<Tail>> {
-    using type = extents<Es...>;
+template<class I, std::ptrdiff_t... Es, std::ptrdiff_t Tail>
+struct remove_extents_tail_impl<basic_extents<I, Es...>, basic_extents<I, Tail>> {
+    using type = basic_extents<I, Es...>;
 };
 
-template<std::ptrdiff_t... Es, std::ptrdiff_t Head, std::ptrdiff_t... Tail>
-struct remove_extents_tail_impl<extents<Es...>, extents<Head, Tail...>> {
-    using type = typename remove_extents_tail_impl<extents<Es..., Head>, extents<Tail...>>::type;
+template<class I, std::ptrdiff_t... Es, std::ptrdiff_t Head, std::ptrdiff_t... Tail>
+struct remove_extents_tail_impl<basic_extents<I, Es...>, basic_extents<I, Head, Tail...>> {
+    using type = typename remove_extents_tail_impl<basic_extents<I, Es..., Head>, basic_extents<I, Tail...>>::type;
 };
 
 template<class E>
 struct remove_extents_tail {
-    using type = typename remove_extents_tail_impl<extents<>, E>::type;
+    using type = typename remove_extents_tail_impl<basic_extents<typename E::index_type>, E>::type;
 };
 
 template<class E>
@@ -36,9 +40,9 @@ using remove_extents_tail_t = typename remove_extents_tail<E>::type;
 template<class E>
 struct remove_extents_head;
 
-template<template<std::ptrdiff_t...> class E, std::ptrdiff_t Head, std::ptrdiff_t... Tail>
-struct remove_extents_head<E<Head, Tail...>> {
-    using type = E<Tail...>;
+template<class I, std::ptrdiff_t Head, std::ptrdiff_t... Tail>
+struct remove_extents_head<basic_extents<I, Head, Tail...>> {
+    using type = basic_extents<I, Tail...>;
 };
 
 template<class E>
@@ -46,6 +50,98 @@ using remove_extents_head_t = typename remove_extents_head<E>::type;
 
 } // namespace detail
 
+struct full_extent_t { explicit full_extent_t() = default; };
+inline constexpr full_extent_t full_extent{};
+
+// Selects `extent` elements starting at `offset`, taking every `stride`-th one.
+// Throws std::invalid_argument from submdarray if `stride` is not positive.
+struct strided_slice {
+    std::ptrdiff_t offset = 0;
+    std::ptrdiff_t extent = 0;
+    std::ptrdiff_t stride = 1;
+};
+
+namespace detail {
+
+// Base of the lazy elementwise expression nodes in expression.hpp.
+struct md_expression_base {};
+
+template<class T>
+inline constexpr bool is_md_expression_v = std::is_base_of_v<md_expression_base, T>;
+
+template<class Slice>
+inline constexpr bool is_index_slice_v = std::is_convertible_v<Slice, std::ptrdiff_t>;
+
+template<class Slice>
+inline constexpr bool is_full_slice_v = std::is_same_v<Slice, full_extent_t>;
+
+template<class Out, class In, class... Slices>
+struct sub_extents_impl;
+
+// The extents of a submdarray keep the index type of the source.
+template<class I, std::ptrdiff_t... Out>
+struct sub_extents_impl<basic_extents<I, Out...>, basic_extents<I>> {
+    using type = basic_extents<I, Out...>;
+};
+
+template<class I, std::ptrdiff_t... Out, std::ptrdiff_t E, std::ptrdiff_t... Es, class Slice, class... Slices>
+struct sub_extents_impl<basic_extents<I, Out...>, basic_extents<I, E, Es...>, Slice, Slices...> {
+    using type = typename std::conditional_t<is_index_slice_v<Slice>,
+        sub_extents_impl<basic_extents<I, Out...>, basic_extents<I, Es...>, Slices...>,
+        sub_extents_impl<basic_extents<I, Out..., (is_full_slice_v<Slice> ? E : dynamic_extent)>, basic_extents<I, Es...>, Slices...>>::type;
+};
+
+template<class E, class... Slices>
+using sub_extents_t = typename sub_extents_impl<basic_extents<typename E::index_type>, E, Slices...>::type;
+
+template<class Slice>
+constexpr std::ptrdiff_t slice_first(Slice const& s) noexcept {
+    if constexpr (is_index_slice_v<Slice>)
+        return static_cast<std::ptrdiff_t>(s);
+    else if constexpr (is_full_slice_v<Slice>)
+        return 0;
+    else if constexpr (std::is_same_v<Slice, strided_slice>)
+        return s.offset;
+    else // [begin, end) pair or tuple
+        return static_cast<std::ptrdiff_t>(std::get<0>(s));
+}
+
+constexpr std::ptrdiff_t checked_slice_stride(strided_slice const& s) {
+    if (s.stride <= 0)
+        throw std::invalid_argument("mdarray: strided_slice stride must be positive");
+    return s.stride;
+}
+
+template<class Slice>
+constexpr std::ptrdiff_t slice_extent(Slice const& s, std::ptrdiff_t const extent) {
+    if constexpr (is_index_slice_v<Slice>)
+        return 1;
+    else if constexpr (is_full_slice_v<Slice>)
+        return extent;
+    else if constexpr (std::is_same_v<Slice, strided_slice>)
+        return (s.extent + checked_slice_stride(s) - 1) / s.stride;
+    else
+        return static_cast<std::ptrdiff_t>(std::get<1>(s)) - static_cast<std::ptrdiff_t>(std::get<0>(s));
+}
+
+template<class Slice>
+constexpr std::ptrdiff_t slice_step(Slice const& s) {
+    if constexpr (std::is_same_v<Slice, strided_slice>)
+        return checked_slice_stride(s);
+    else
+        return 1;
+}
+
+// Mappings that must see every index (layout_instrumented) set
+// `observes_indices`; rank-1 contiguous access then still goes through them.
+template<class M, class = void>
+inline constexpr bool observes_indices_v = false;
+
+template<class M>
+inline constexpr bool observes_indices_v<M, std::void_t<decltype(M::observes_indices)>> = M::observes_indices;
+
+} // namespace detail
+
 template<class, class, class, class>
 class basic_mdarray;
 
@@ -58,7 +154,7 @@ public:
     using container_policy_type = ContainerPolicy;
     using element_type = typename container_policy_type::element_type;
     using value_type = std::remove_cv_t<element_type>;
-    using index_type = std::ptrdiff_t;
+    using index_type = typename extents_type::index_type;
     using difference_type = std::ptrdiff_t;
     using pointer = typename container_policy_type::pointer;
     using reference = typename container_policy_type::reference;
@@ -68,12 +164,27 @@ public:
 
 private:
     static constexpr auto rank_ = Extents::rank();
-    static constexpr bool one_extent_ = (rank_ == 1);
+    static constexpr bool one_extent_ = (rank_ == 1) && mapping_type::is_always_contiguous() && !detail::observes_indices_v<mapping_type>;
     constexpr mapping_type& as_mt() noexcept { return static_cast<mapping_type&>(*this); }
     constexpr mapping_type const& as_mt() const noexcept { return static_cast<mapping_type const&>(*this); }
     constexpr container_policy_type& as_cpt() noexcept { return static_cast<container_policy_type&>(*this); }
     constexpr container_policy_type const& as_cpt() const noexcept { return static_cast<container_policy_type const&>(*this); }
 
+    template<class IndexType, std::size_t N, std::size_t... Is>
+    constexpr reference op_paren_arr_helper(std::array<IndexType, N> const& indices, std::index_sequence<Is...>) {
+        return (*this)(std::get<Is>(indices)...);
+    }
+
+    template<class IndexType, std::size_t N, std::size_t... Is>
+    constexpr const_reference op_paren_arr_helper(std::array<IndexType, N> const& indices, std::index_sequence<Is...>) const {
+        return (*this)(std::get<Is>(indices)...);
+    }
+
+    template<std::size_t... Is>
+    constexpr auto subscript_helper(index_type const i, std::index_sequence<Is...>) noexcept {
+        return submdarray(*this, ((void)Is, full_extent)..., i);
+    }
+
 public:
     template<class U, class E, class LP, class CP>
     constexpr basic_mdarray_view(basic_mdarray<U, E, LP, CP>& md)
@@ -82,15 +193,27 @@ public:
         , ptr_(md.data())
     {}
 
-    constexpr basic_mdarray_view(T* ptr) noexcept : ptr_(ptr) {}
+    constexpr basic_mdarray_view(pointer ptr) noexcept : ptr_(ptr) {}
 
-    constexpr auto operator[](index_type const i) noexcept {
-        if constexpr (one_extent_)
-            return as_cpt().access(ptr_, i);
-        else {
-            using View = basic_mdarray_view<T, detail::remove_extents_tail_t<extents_type>, layout_type, container_policy_type>;
-            return View(std::addressof(as_cpt().access(ptr_, as_mt()[i])));
-        }
+    constexpr basic_mdarray_view(pointer ptr, mapping_type const& m) noexcept
+        : mapping_type(m)
+        , container_policy_type()
+        , ptr_(ptr)
+    {}
+
+    constexpr basic_mdarray_view(pointer ptr, mapping_type const& m, container_policy_type const& cp) noexcept
+        : mapping_type(m)
+        , container_policy_type(cp)
+        , ptr_(ptr)
+    {}
+
+    // Fixes the trailing index; the result keeps the remaining extents and
+    // strides of this view.
+    constexpr decltype(auto) operator[](index_type const i) noexcept {
+        if constexpr (rank_ == 1)
+            return (*this)(i);
+        else
+            return subscript_helper(i, std::make_index_sequence<rank_ - 1>{});
     }
 
     template<class... IndexTypes>
@@ -115,17 +238,188 @@ public:
             return as_cpt().access(ptr_, as_mt()(is...));
     }
 
+    template<class IndexType, std::size_t N>
+    constexpr reference operator()(std::array<IndexType, N> const& indices) {
+        static_assert(N == rank_, "");
+        static_assert(std::is_convertible_v<IndexType, index_type>, "");
+        return op_paren_arr_helper(indices, std::make_index_sequence<N>{});
+    }
+
+    template<class IndexType, std::size_t N>
+    constexpr const_reference operator()(std::array<IndexType, N> const& indices) const {
+        static_assert(N == rank_, "");
+        static_assert(std::is_convertible_v<IndexType, index_type>, "");
+        return op_paren_arr_helper(indices, std::make_index_sequence<N>{});
+    }
+
+    // Evaluates a lazy expression (see expression.hpp) into the viewed elements.
+    template<class Expr, std::enable_if_t<detail::is_md_expression_v<Expr>, int> = 0>
+    constexpr basic_mdarray_view& operator=(Expr const& e) {
+        assign_expression(*this, e);
+        return *this;
+    }
+
+    static constexpr std::size_t rank() noexcept { return Extents::rank(); }
+    static constexpr std::size_t rank_dynamic() noexcept { return Extents::rank_dynamic(); }
+    static constexpr index_type static_extent(std::size_t const i) noexcept { return Extents::static_extent(i); } 
+
+    constexpr extents_type extents() const noexcept { return as_mt().extents(); }
+    constexpr index_type extent(std::size_t const i) const noexcept { return as_mt().extent(i); }
+    constexpr index_type size() const noexcept { return as_mt().size(); }
+
+    constexpr pointer data() const noexcept { return ptr_; }
+    constexpr container_policy_type container_policy() const noexcept { return as_cpt(); }
+
+    static constexpr bool is_always_unique() noexcept { return mapping_type::is_always_unique(); }
+    static constexpr bool is_always_contiguous() noexcept { return mapping_type::is_always_contiguous(); }
+    static constexpr bool is_always_strided() noexcept { return mapping_type::is_always_strided(); }
+    constexpr mapping_type mapping() const noexcept { return as_mt(); }
+    constexpr bool is_unique() const noexcept { return as_mt().is_unique(); }
+    constexpr bool is_contiguous() const noexcept { return as_mt().is_contiguous(); }
+    constexpr bool is_strided() const noexcept { return as_mt().is_strided(); }
+    constexpr index_type stride(std::size_t const r) const { return as_mt().stride(r); }
+
 private:
-    T* ptr_ = nullptr;
+    pointer ptr_ = nullptr;
 };
 
 template<class T, class E, class LP, class CP>
-basic_mdarray_view(basic_mdarray<T, E, LP, CP>) -> basic_mdarray_view<T, E, LP, CP>;
+basic_mdarray_view(basic_mdarray<T, E, LP, CP>&) -> basic_mdarray_view<T, E, LP, CP>;
+
+namespace detail {
+
+// Policies whose offset_policy is a different, stateless type (e.g. one that
+// owns a file mapping) hand out plain default-constructed offset policies.
+template<class CP>
+constexpr typename CP::offset_policy make_offset_policy(CP const& cp) {
+    if constexpr (std::is_constructible_v<typename CP::offset_policy, CP const&>)
+        return typename CP::offset_policy(cp);
+    else
+        return typename CP::offset_policy();
+}
+
+template<class T, class E, class LP, class CP, class... Slices, std::size_t... Is>
+constexpr auto submdarray_impl(basic_mdarray_view<T, E, LP, CP> const& v, std::index_sequence<Is...>, Slices const&... slices) {
+    static_assert(LP::template mapping<E>::is_always_strided(), "submdarray requires a strided layout");
+    using sub_extents_type = sub_extents_t<E, Slices...>;
+    using sub_mapping_type = layout_stride::mapping<sub_extents_type>;
+    using sub_view_type = basic_mdarray_view<T, sub_extents_type, layout_stride, typename CP::offset_policy>;
+
+    constexpr std::array<bool, E::rank()> is_index = {is_index_slice_v<Slices>...};
+    std::array<std::ptrdiff_t, E::rank()> const firsts = {slice_first(slices)...};
+    std::array<std::ptrdiff_t, E::rank()> const sub_extents = {slice_extent(slices, v.extent(Is))...};
+    std::array<std::ptrdiff_t, E::rank()> const steps = {slice_step(slices)...};
+
+    std::ptrdiff_t offset = 0;
+    std::array<std::ptrdiff_t, sub_extents_type::rank()> strides{};
+    std::array<std::ptrdiff_t, sub_extents_type::rank_dynamic()> dynamic_extents{};
+    std::size_t r = 0;
+    std::size_t d = 0;
+    for (std::size_t i = 0; i < E::rank(); ++i) {
+        offset += firsts[i] * v.stride(i);
+        if (is_index[i])
+            continue;
+        if (sub_extents_type::static_extent(r) == dynamic_extent)
+            dynamic_extents[d++] = sub_extents[i];
+        strides[r++] = v.stride(i) * steps[i];
+    }
+
+    auto cp = v.container_policy();
+    return sub_view_type(cp.offset(v.data(), offset), sub_mapping_type(sub_extents_type(dynamic_extents), strides), make_offset_policy(cp));
+}
+
+} // namespace detail
+
+// Returns a view of the elements of `v` selected by one slice specifier per
+// dimension. An integral index fixes that dimension and removes it from the
+// result; `full_extent`, a [begin, end) pair or tuple, or a `strided_slice`
+// keep it. No elements are copied.
+template<class T, class E, class LP, class CP, class... Slices>
+constexpr auto submdarray(basic_mdarray_view<T, E, LP, CP> const& v, Slices const&... slices) {
+    static_assert(sizeof...(Slices) == E::rank(), "");
+    static_assert(basic_mdarray_view<T, E, LP, CP>::is_always_strided(), "");
+    return detail::submdarray_impl(v, std::make_index_sequence<E::rank()>{}, slices...);
+}
+
+template<class T, class E, class LP, class CP, class... Slices>
+constexpr auto submdarray(basic_mdarray<T, E, LP, CP>& md, Slices const&... slices) {
+    return submdarray(md.view(), slices...);
+}
+
+namespace detail {
+
+// Outer-to-inner loop order over the dimensions of `md`: dimensions sorted by
+// decreasing stride, so the innermost loop walks the smallest stride.
+// Layouts without strides are walked with the last index fastest.
+template<class MD>
+std::array<std::size_t, MD::rank()> loop_order(MD const& md) {
+    std::array<std::size_t, MD::rank()> order{};
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    if constexpr (MD::is_always_strided())
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t const a, std::size_t const b) { return md.stride(a) > md.stride(b); });
+    return order;
+}
+
+template<class T>
+using remove_cvref_t = std::remove_cv_t<std::remove_reference_t<T>>;
+
+template<class MD>
+constexpr bool has_raw_pointer_v = std::is_pointer_v<decltype(std::declval<MD&>().data())>;
+
+// Elements addressable as data()[sum of idx[r] * stride(r)].
+template<class MD>
+constexpr bool is_direct_strided_v = has_raw_pointer_v<MD> && remove_cvref_t<MD>::is_always_strided();
+
+// A loop step known to be 1, so that kernels templated on the step
+// vectorize for the contiguous case.
+using unit_step = std::integral_constant<std::ptrdiff_t, 1>;
+
+// True if `a` and `b` address their elements at identical storage offsets
+// and both cover a contiguous range.
+template<class A, class B>
+bool same_flat_storage(A const& a, B const& b) {
+    if constexpr (!has_raw_pointer_v<A> || !has_raw_pointer_v<B> || !std::is_same_v<typename A::layout_type, typename B::layout_type>)
+        return false;
+    else {
+        for (std::size_t r = 0; r < A::rank(); ++r) {
+            if (a.extent(r) != b.extent(r))
+                return false;
+        }
+        return a.is_contiguous() && b.is_contiguous() && (A::is_always_contiguous() || a.mapping() == b.mapping());
+    }
+}
+
+} // namespace detail
 
 template<class T, std::ptrdiff_t... Extents>
 using mdarray_view = basic_mdarray_view<T, extents<Extents...>>;
 
-template<class T, class Extents, class LayoutPolicy = layout_left, class ContainerPolicy = default_container_policy<T>>
+namespace detail {
+
+// All-static mdarrays whose storage fits in this many bytes hold their
+// elements inline instead of on the heap.
+inline constexpr std::size_t inline_storage_max_bytes = 512;
+
+template<class Mapping>
+constexpr std::size_t static_span_size() noexcept { return static_cast<std::size_t>(Mapping().required_span_size()); }
+
+template<class T, class Extents, class LayoutPolicy, class = void>
+struct default_container_policy_for {
+    using type = default_container_policy<T>;
+};
+
+template<class T, class Extents, class LayoutPolicy>
+struct default_container_policy_for<T, Extents, LayoutPolicy, std::enable_if_t<Extents::rank_dynamic() == 0 &&
+    static_span_size<typename LayoutPolicy::template mapping<Extents>>() * sizeof(T) <= inline_storage_max_bytes>> {
+    using type = inline_container_policy<T, static_span_size<typename LayoutPolicy::template mapping<Extents>>()>;
+};
+
+template<class T, class Extents, class LayoutPolicy>
+using default_container_policy_for_t = typename default_container_policy_for<T, Extents, LayoutPolicy>::type;
+
+} // namespace detail
+
+template<class T, class Extents, class LayoutPolicy = layout_left, class ContainerPolicy = detail::default_container_policy_for_t<T, Extents, LayoutPolicy>>
 class basic_mdarray : private LayoutPolicy::template mapping<Extents>, private ContainerPolicy {
 public:
     using extents_type = Extents;
@@ -134,7 +428,7 @@ public:
     using container_policy_type = ContainerPolicy;
     using element_type = typename container_policy_type::element_type;
     using value_type = std::remove_cv_t<element_type>;
-    using index_type = std::ptrdiff_t;
+    using index_type = typename extents_type::index_type;
     using difference_type = std::ptrdiff_t;
     using pointer = typename container_policy_type::pointer;
     using reference = typename container_policy_type::reference;
@@ -142,12 +436,12 @@ public:
     using const_reference = typename container_policy_type::const_reference;
     using container_type = typename container_policy_type::container_type;
 
-    // view_type
+    using view_type = basic_mdarray_view<element_type, extents_type, layout_type, container_policy_type>;
     // const_view_type
 
 private:
     static constexpr auto rank_ = Extents::rank();
-    static constexpr bool one_extent_ = (rank_ == 1);
+    static constexpr bool one_extent_ = (rank_ == 1) && mapping_type::is_always_contiguous() && !detail::observes_indices_v<mapping_type>;
     constexpr mapping_type& as_mt() noexcept { return static_cast<mapping_type&>(*this); }
     constexpr mapping_type const& as_mt() const noexcept { return static_cast<mapping_type const&>(*this); }
     constexpr container_policy_type& as_cpt() noexcept { return static_cast<container_policy_type&>(*this); }
@@ -170,7 +464,7 @@ private:
     }
 
 public:
-    constexpr basic_mdarray() noexcept : mapping_type(), container_policy_type(), c_(as_cpt().create(size())) {}
+    constexpr basic_mdarray() noexcept : mapping_type(), container_policy_type(), c_(as_cpt().create(as_mt().required_span_size())) {}
     constexpr basic_mdarray(basic_mdarray const&) noexcept = default;
     constexpr basic_mdarray(basic_mdarray&&) noexcept = default;
 
@@ -178,7 +472,7 @@ public:
     explicit constexpr basic_mdarray(IndexTypes... dynamic_extents) 
         : mapping_type(Extents(dynamic_extents...)) 
         , container_policy_type()
-        , c_(as_cpt().create(size()))
+        , c_(as_cpt().create(as_mt().required_span_size()))
     {
         static_assert((sizeof...(IndexTypes) == rank_dynamic()), "");
         static_assert((std::is_convertible_v<IndexTypes, index_type> && ...), "");
@@ -191,7 +485,7 @@ public:
         : mapping_type(Extents(dynamic_extents...)) 
         , container_policy_type()
         , c_(std::apply([&](auto&&... args) { 
-                return as_cpt().create(size(), std::forward<decltype(args)>(args)...);
+                return as_cpt().create(as_mt().required_span_size(), std::forward<decltype(args)>(args)...);
             }, args))
     {
         static_assert((sizeof...(IndexTypes) == rank_dynamic()), "");
@@ -205,14 +499,14 @@ public:
     explicit constexpr basic_mdarray(mapping_type const& m)
         : mapping_type(m)
         , container_policy_type()
-        , c_(as_cpt().create(size()))
+        , c_(as_cpt().create(as_mt().required_span_size()))
     {}
 
     // TODO: add rvalue overload?
     explicit constexpr basic_mdarray(mapping_type const& m, container_policy_type const& cp)
         : mapping_type(m)
         , container_policy_type(cp)
-        , c_(cp.create(size()))
+        , c_(cp.create(as_mt().required_span_size()))
     {}
 
     template<class ET, class Exts, class LP, class CP>
@@ -248,6 +542,13 @@ public:
         return *this;
     }
 
+    // Evaluates a lazy expression (see expression.hpp) in a single pass.
+    template<class Expr, std::enable_if_t<detail::is_md_expression_v<Expr>, int> = 0>
+    constexpr basic_mdarray& operator=(Expr const& e) {
+        assign_expression(*this, e);
+        return *this;
+    }
+
     // operator[](index_type);
     // operator[](index_type) const;
 
@@ -291,6 +592,9 @@ public:
     static constexpr std::size_t rank_dynamic() noexcept { return Extents::rank_dynamic(); }
     static constexpr index_type static_extent(std::size_t const i) noexcept { return Extents::static_extent(i); } 
 
+    // Alignment in bytes guaranteed for data() by the container policy.
+    static constexpr std::size_t alignment() noexcept { return detail::policy_alignment_v<container_policy_type>; }
+
     constexpr extents_type extents() const noexcept { return as_mt().extents(); }
     constexpr index_type extent(std::size_t const i) const noexcept { return extents().extent(i); }
     constexpr index_type size() const noexcept { return extents().size(); }
@@ -298,12 +602,14 @@ public:
         return as_mt().is_unique() ? size() : 0; // FIX!!!!!!!!!!!!
     }
 
-    // view_type view() noexcept;
+    constexpr view_type view() noexcept { return view_type(data(), as_mt(), as_cpt()); }
     // const_view_type view() const noexcept;
 
     constexpr pointer data() noexcept { return as_cpt().data(c_); }
     constexpr const_pointer data() const noexcept { return as_cpt().data(c_); }
     constexpr container_policy_type container_policy() const noexcept { return as_cpt(); }
+    constexpr container_type& container() noexcept { return c_; }
+    constexpr container_type const& container() const noexcept { return c_; }
 
     static constexpr bool is_always_unique() noexcept { return mapping_type::is_always_unique(); }
     static constexpr bool is_always_contiguous() noexcept { return mapping_type::is_always_contiguous(); }
@@ -315,8 +621,15 @@ public:
     constexpr index_type stride(std::size_t const r) const { return as_mt().stride(r); }
 
 private:
+    template<class, class, class, class>
+    friend class basic_mdarray;
+
     container_type c_{};
 };
 
 template<class T, std::ptrdiff_t... Extents>
-using mdarray = basic_mdarray<T, extents<Extents...>>;
\ No newline at end of file
+using mdarray = basic_mdarray<T, extents<Extents...>>;
+// Small all-static arrays are exactly their elements, so arrays of them pack
+// without padding.
+static_assert(sizeof(basic_mdarray<float, extents<4, 4>>) == 16 * sizeof(float), "");
+static_assert(sizeof(basic_mdarray<double, extents<3, 3>, layout_right>) == 9 * sizeof(double), "");
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "container_policy.hpp"
+
+enum class mmap_mode { read_only, read_write };
+enum class mmap_sharing { shared, private_copy };
+enum class mmap_advice { normal, sequential, random, will_need, dont_need };
+
+namespace detail {
+
+// `error` defaults to errno; callers that make another system call (such
+// as close) after the failing one save errno and pass it here.
+[[noreturn]] inline void throw_errno(std::string const& what, int const error = errno) {
+    throw std::system_error(error, std::system_category(), what);
+}
+
+inline int to_madvise_flag(mmap_advice const advice) noexcept {
+    switch (advice) {
+    case mmap_advice::sequential: return MADV_SEQUENTIAL;
+    case mmap_advice::random: return MADV_RANDOM;
+    case mmap_advice::will_need: return MADV_WILLNEED;
+    case mmap_advice::dont_need: return MADV_DONTNEED;
+    default: return MADV_NORMAL;
+    }
+}
+
+inline std::size_t page_size() noexcept {
+    static std::size_t const size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+} // namespace detail
+
+// Owns a memory mapping holding `size()` elements of T. The elements start
+// `data() - base` bytes into the mapping so that file offsets need not be
+// page aligned.
+template<class T>
+class mmap_region {
+public:
+    ~mmap_region() noexcept { reset(); }
+    mmap_region() noexcept = default;
+    mmap_region(mmap_region const&) = delete;
+    mmap_region(mmap_region&& other) noexcept
+        : base_(std::exchange(other.base_, nullptr))
+        , mapped_bytes_(std::exchange(other.mapped_bytes_, 0))
+        , data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0))
+    {}
+
+    mmap_region(void* const base, std::size_t const mapped_bytes, T* const data, std::size_t const size) noexcept
+        : base_(base), mapped_bytes_(mapped_bytes), data_(data), size_(size)
+    {}
+
+    mmap_region& operator=(mmap_region const&) = delete;
+    mmap_region& operator=(mmap_region&& other) noexcept {
+        if (this != &other) {
+            reset();
+            base_ = std::exchange(other.base_, nullptr);
+            mapped_bytes_ = std::exchange(other.mapped_bytes_, 0);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    T& operator[](std::ptrdiff_t const i) const noexcept { return data_[i]; }
+    T* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+
+    // Writes dirty pages of a shared mapping back to the file. With
+    // `async` the write-back is only scheduled.
+    void sync(bool const async = false) const {
+        if (base_ != nullptr && ::msync(base_, mapped_bytes_, async ? MS_ASYNC : MS_SYNC) != 0)
+            detail::throw_errno("msync");
+    }
+
+    // Same as sync(), restricted to the pages holding elements [first, first + count).
+    void sync(std::size_t const first, std::size_t const count, bool const async = false) const {
+        auto const [p, bytes] = page_range(first, count);
+        if (bytes != 0 && ::msync(p, bytes, async ? MS_ASYNC : MS_SYNC) != 0)
+            detail::throw_errno("msync");
+    }
+
+    void advise(mmap_advice const advice) const {
+        if (base_ != nullptr && ::madvise(base_, mapped_bytes_, detail::to_madvise_flag(advice)) != 0)
+            detail::throw_errno("madvise");
+    }
+
+    // Same as advise(), restricted to the pages holding elements [first, first + count).
+    void advise(mmap_advice const advice, std::size_t const first, std::size_t const count) const {
+        auto const [p, bytes] = page_range(first, count);
+        if (bytes != 0 && ::madvise(p, bytes, detail::to_madvise_flag(advice)) != 0)
+            detail::throw_errno("madvise");
+    }
+
+    // Reads the pages holding elements [first, first + count) into memory
+    // now, blocking until they are resident, so later accesses do not fault
+    // on I/O.
+    void populate(std::size_t const first, std::size_t const count) const {
+        auto const [p, bytes] = page_range(first, count);
+        if (bytes == 0)
+            return;
+#if defined(MADV_POPULATE_READ)
+        if (::madvise(p, bytes, MADV_POPULATE_READ) == 0)
+            return;
+#endif
+        ::madvise(p, bytes, MADV_WILLNEED);
+        auto const* const bytes_begin = static_cast<unsigned char const volatile*>(p);
+        for (std::size_t b = 0; b < bytes; b += detail::page_size())
+            (void)bytes_begin[b];
+    }
+
+    // Unmaps the pages lying entirely within elements [first, first + count)
+    // from this process; they are read back from the file on the next
+    // access. Modifications of a private_copy mapping in that range are lost,
+    // those of a shared mapping are kept by the page cache.
+    void release(std::size_t const first, std::size_t const count) const {
+        if (count == 0 || base_ == nullptr)
+            return;
+        std::size_t const page = detail::page_size();
+        auto const begin = (reinterpret_cast<std::uintptr_t>(data_ + first) + page - 1) & ~(page - 1);
+        auto const end = reinterpret_cast<std::uintptr_t>(data_ + first + count) & ~(page - 1);
+        if (begin < end && ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED) != 0)
+            detail::throw_errno("madvise");
+    }
+
+private:
+    std::pair<void*, std::size_t> page_range(std::size_t const first, std::size_t const count) const noexcept {
+        if (count == 0 || base_ == nullptr)
+            return {nullptr, 0};
+        auto const begin = reinterpret_cast<std::uintptr_t>(data_ + first) & ~(detail::page_size() - 1);
+        auto const end = reinterpret_cast<std::uintptr_t>(data_ + first + count);
+        return {reinterpret_cast<void*>(begin), end - begin};
+    }
+
+    void reset() noexcept {
+        if (base_ != nullptr)
+            ::munmap(base_, mapped_bytes_);
+        base_ = nullptr;
+        mapped_bytes_ = 0;
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    void* base_ = nullptr;
+    std::size_t mapped_bytes_ = 0;
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// Maps `path` into memory instead of allocating, starting `byte_offset`
+// bytes into the file. Pages are loaded on first access.
+//
+// A read_write + shared mapping writes through to the file, which is created
+// or grown to the required size. A private_copy mapping never modifies the
+// file, and a read_only mapping must not be written to. In both cases the
+// file must already be large enough.
+template<class T>
+class mmap_container_policy {
+public:
+    using element_type = T;
+    using container_type = mmap_region<T>;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using reference = T&;
+    using const_reference = T const&;
+    using offset_policy = default_container_policy<T>;
+
+    static constexpr std::size_t alignment = alignof(T);
+
+    explicit mmap_container_policy(std::string path,
+                                   mmap_mode const mode = mmap_mode::read_only,
+                                   mmap_sharing const sharing = mmap_sharing::shared,
+                                   std::size_t const byte_offset = 0)
+        : path_(std::move(path)), mode_(mode), sharing_(sharing), byte_offset_(byte_offset)
+    {}
+
+    container_type create(std::size_t const n) const {
+        if (n == 0)
+            return {};
+
+        bool const writable = (mode_ == mmap_mode::read_write);
+        bool const shared = (sharing_ == mmap_sharing::shared);
+        std::size_t const bytes = n * sizeof(T);
+
+        int const fd = ::open(path_.c_str(), writable && shared ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (fd < 0)
+            detail::throw_errno("open " + path_);
+
+        struct ::stat st {};
+        if (::fstat(fd, &st) != 0) {
+            int const error = errno;
+            ::close(fd);
+            detail::throw_errno("fstat " + path_, error);
+        }
+        if (static_cast<std::size_t>(st.st_size) < byte_offset_ + bytes) {
+            if (!(writable && shared)) {
+                ::close(fd);
+                throw std::length_error("mmap_container_policy: " + path_ + " is smaller than the requested extents");
+            }
+            if (::ftruncate(fd, static_cast<::off_t>(byte_offset_ + bytes)) != 0) {
+                int const error = errno;
+                ::close(fd);
+                detail::throw_errno("ftruncate " + path_, error);
+            }
+        }
+
+        std::size_t const map_offset = byte_offset_ & ~(detail::page_size() - 1);
+        std::size_t const delta = byte_offset_ - map_offset;
+        std::size_t const mapped_bytes = delta + bytes;
+        int const prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* const base = ::mmap(nullptr, mapped_bytes, prot, shared ? MAP_SHARED : MAP_PRIVATE, fd, static_cast<::off_t>(map_offset));
+        int const mmap_error = errno;
+        ::close(fd);
+        if (base == MAP_FAILED)
+            detail::throw_errno("mmap " + path_, mmap_error);
+
+        T* const data = reinterpret_cast<T*>(static_cast<char*>(base) + delta);
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(T) != 0) {
+            ::munmap(base, mapped_bytes);
+            throw std::invalid_argument("mmap_container_policy: byte offset is misaligned for the element type");
+        }
+        return container_type(base, mapped_bytes, data, n);
+    }
+
+    reference access(container_type const& c, std::ptrdiff_t const i) { return c[i]; }
+    const_reference access(container_type const& c, std::ptrdiff_t const i) const { return c[i]; }
+    reference access(pointer const p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return p[i]; }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
+
+    element_type* decay(pointer const p) { return p; }
+    element_type const* decay(pointer const p) const { return p; }
+
+    pointer data(container_type& c) { return c.data(); }
+    const_pointer data(container_type const& c) const { return c.data(); }
+
+    std::string const& path() const noexcept { return path_; }
+    mmap_mode mode() const noexcept { return mode_; }
+    mmap_sharing sharing() const noexcept { return sharing_; }
+    std::size_t byte_offset() const noexcept { return byte_offset_; }
+
+private:
+    std::string path_;
+    mmap_mode mode_;
+    mmap_sharing sharing_;
+    std::size_t byte_offset_;
+};
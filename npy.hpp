@@ -0,0 +1,334 @@
+#pragma once
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "mdarray.hpp"
+#include "mmap_container_policy.hpp"
+
+// Reading and writing of NumPy .npy files (format versions 1.0 and 2.0).
+// layout_left arrays are stored with fortran_order True, layout_right arrays
+// with fortran_order False. Only the host byte order is supported.
+
+namespace detail {
+
+inline constexpr char npy_magic[] = "\x93NUMPY";
+inline constexpr std::size_t npy_magic_size = 6;
+inline constexpr std::size_t npy_header_alignment = 64;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+inline constexpr char npy_byte_order = '>';
+#else
+inline constexpr char npy_byte_order = '<';
+#endif
+
+template<class T>
+struct is_complex : std::false_type {};
+
+template<class T>
+struct is_complex<std::complex<T>> : std::true_type {};
+
+template<class T>
+std::string npy_descr() {
+    static_assert(std::is_arithmetic_v<T> || is_complex<T>::value, "unsupported .npy element type");
+    char kind = 'f';
+    if constexpr (std::is_same_v<T, bool>)
+        kind = 'b';
+    else if constexpr (std::is_integral_v<T>)
+        kind = std::is_signed_v<T> ? 'i' : 'u';
+    else if constexpr (is_complex<T>::value)
+        kind = 'c';
+    char const order = sizeof(T) == 1 ? '|' : npy_byte_order;
+    return std::string{order, kind} + std::to_string(sizeof(T));
+}
+
+template<class Layout>
+constexpr bool npy_fortran_order() noexcept {
+    static_assert(std::is_same_v<Layout, layout_left> || std::is_same_v<Layout, layout_right>,
+                  ".npy files store layout_left or layout_right data");
+    return std::is_same_v<Layout, layout_left>;
+}
+
+} // namespace detail
+
+struct npy_header {
+    std::string descr;
+    bool fortran_order = false;
+    std::vector<std::ptrdiff_t> shape;
+    std::size_t data_offset = 0; // bytes from the start of the file to the payload
+
+    std::size_t size() const noexcept {
+        std::size_t n = 1;
+        for (auto const e : shape)
+            n *= static_cast<std::size_t>(e);
+        return n;
+    }
+};
+
+// Returns the complete preamble (magic, version, length and dictionary)
+// padded so that the payload starts on a 64-byte boundary.
+inline std::string make_npy_header(std::string const& descr, bool const fortran_order, std::vector<std::ptrdiff_t> const& shape) {
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': " + (fortran_order ? "True" : "False") + ", 'shape': (";
+    for (std::size_t i = 0; i < shape.size(); ++i) {
+        dict += std::to_string(shape[i]);
+        if (shape.size() == 1 || i + 1 < shape.size())
+            dict += shape.size() == 1 ? "," : ", ";
+    }
+    dict += "), }";
+
+    // Version 1.0 stores the dictionary length in 16 bits, 2.0 in 32 bits.
+    std::size_t const length_size = dict.size() + 1 + detail::npy_header_alignment > 0xffff ? 4 : 2;
+    std::size_t const total = detail::npy_magic_size + 2 + length_size + dict.size() + 1;
+    std::size_t const padded = (total + detail::npy_header_alignment - 1) / detail::npy_header_alignment * detail::npy_header_alignment;
+    dict.append(padded - total, ' ');
+    dict += '\n';
+
+    std::string header(detail::npy_magic, detail::npy_magic_size);
+    header += static_cast<char>(length_size == 2 ? 1 : 2);
+    header += static_cast<char>(0);
+    std::size_t const dict_size = dict.size();
+    for (std::size_t b = 0; b < length_size; ++b)
+        header += static_cast<char>((dict_size >> (8 * b)) & 0xff);
+    return header + dict;
+}
+
+namespace detail {
+
+inline std::string npy_dict_value(std::string const& dict, std::string const& key) {
+    auto const k = dict.find("'" + key + "'");
+    if (k == std::string::npos)
+        throw std::runtime_error("npy: header is missing '" + key + "'");
+    auto begin = dict.find(':', k);
+    if (begin == std::string::npos)
+        throw std::runtime_error("npy: malformed header");
+    begin = dict.find_first_not_of(' ', begin + 1);
+    if (begin == std::string::npos)
+        throw std::runtime_error("npy: malformed header");
+
+    std::size_t end = 0;
+    if (dict[begin] == '\'')
+        return dict.substr(begin + 1, dict.find('\'', begin + 1) - begin - 1);
+    if (dict[begin] == '(')
+        end = dict.find(')', begin) + 1;
+    else
+        end = dict.find_first_of(",}", begin);
+    return dict.substr(begin, end - begin);
+}
+
+} // namespace detail
+
+inline npy_header read_npy_header(std::string const& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("npy: cannot open " + path);
+
+    char preamble[detail::npy_magic_size + 2] = {};
+    in.read(preamble, sizeof(preamble));
+    if (!in || std::memcmp(preamble, detail::npy_magic, detail::npy_magic_size) != 0)
+        throw std::runtime_error("npy: " + path + " is not a .npy file");
+
+    std::size_t const major = static_cast<unsigned char>(preamble[detail::npy_magic_size]);
+    std::size_t const length_size = major == 1 ? 2 : 4;
+    unsigned char length_bytes[4] = {};
+    in.read(reinterpret_cast<char*>(length_bytes), static_cast<std::streamsize>(length_size));
+    std::size_t dict_size = 0;
+    for (std::size_t b = 0; b < length_size; ++b)
+        dict_size |= static_cast<std::size_t>(length_bytes[b]) << (8 * b);
+
+    std::string dict(dict_size, '\0');
+    in.read(dict.data(), static_cast<std::streamsize>(dict_size));
+    if (!in)
+        throw std::runtime_error("npy: truncated header in " + path);
+
+    npy_header header;
+    header.descr = detail::npy_dict_value(dict, "descr");
+    header.fortran_order = detail::npy_dict_value(dict, "fortran_order") == "True";
+    std::string const shape = detail::npy_dict_value(dict, "shape");
+    for (std::size_t i = 1; i < shape.size();) {
+        std::size_t const digits = shape.find_first_of("0123456789", i);
+        if (digits == std::string::npos)
+            break;
+        std::size_t end = shape.find_first_not_of("0123456789", digits);
+        header.shape.push_back(std::stoll(shape.substr(digits, end - digits)));
+        i = end;
+    }
+    header.data_offset = detail::npy_magic_size + 2 + length_size + dict_size;
+    return header;
+}
+
+// Writes the payload of a .npy file incrementally, so arrays can be emitted
+// chunk by chunk without holding all of them in memory. Elements are
+// expected in the storage order given by `fortran_order`.
+template<class T>
+class npy_writer {
+public:
+    npy_writer(std::string const& path, std::vector<std::ptrdiff_t> shape, bool const fortran_order = false)
+        : out_(path, std::ios::binary | std::ios::trunc)
+        , path_(path)
+    {
+        if (!out_)
+            throw std::runtime_error("npy: cannot create " + path);
+        npy_header header;
+        header.shape = std::move(shape);
+        remaining_ = header.size();
+        std::string const preamble = make_npy_header(detail::npy_descr<T>(), fortran_order, header.shape);
+        out_.write(preamble.data(), static_cast<std::streamsize>(preamble.size()));
+    }
+
+    template<class Extents, class Layout>
+    npy_writer(std::string const& path, Extents const& e, Layout)
+        : npy_writer(path, shape_of(e), detail::npy_fortran_order<Layout>())
+    {}
+
+    npy_writer(npy_writer const&) = delete;
+    npy_writer& operator=(npy_writer const&) = delete;
+
+    void write(T const* const p, std::size_t const n) {
+        if (n > remaining_)
+            throw std::length_error("npy: more elements written than the shape of " + path_ + " holds");
+        out_.write(reinterpret_cast<char const*>(p), static_cast<std::streamsize>(n * sizeof(T)));
+        if (!out_)
+            throw std::runtime_error("npy: write to " + path_ + " failed");
+        remaining_ -= n;
+    }
+
+    std::size_t remaining() const noexcept { return remaining_; }
+
+    // Flushes the file; throws if fewer elements than the shape holds were written.
+    void close() {
+        if (remaining_ != 0)
+            throw std::length_error("npy: " + path_ + " closed with " + std::to_string(remaining_) + " elements missing");
+        out_.close();
+        if (!out_)
+            throw std::runtime_error("npy: closing " + path_ + " failed");
+    }
+
+private:
+    template<class Extents>
+    static std::vector<std::ptrdiff_t> shape_of(Extents const& e) {
+        std::vector<std::ptrdiff_t> shape(Extents::rank());
+        for (std::size_t r = 0; r < Extents::rank(); ++r)
+            shape[r] = e.extent(r);
+        return shape;
+    }
+
+    std::ofstream out_;
+    std::string path_;
+    std::size_t remaining_ = 0;
+};
+
+namespace detail {
+
+// Calls f(indices) for every index of `e`, last index fastest when
+// `RightMost`, first index fastest otherwise.
+template<bool RightMost, class Extents, class F>
+void for_each_index_in_order(Extents const& e, F&& f) {
+    constexpr std::size_t rank = Extents::rank();
+    if (e.size() == 0)
+        return;
+    std::array<std::ptrdiff_t, rank> idx{};
+    for (;;) {
+        f(idx);
+        std::size_t k = 0;
+        for (; k < rank; ++k) {
+            std::size_t const r = RightMost ? rank - 1 - k : k;
+            if (++idx[r] < e.extent(r))
+                break;
+            idx[r] = 0;
+        }
+        if (k == rank)
+            return;
+    }
+}
+
+template<class Extents>
+Extents npy_extents(npy_header const& header, std::string const& path) {
+    if (header.shape.size() != Extents::rank())
+        throw std::runtime_error("npy: rank mismatch in " + path);
+    std::array<std::ptrdiff_t, Extents::rank_dynamic()> dynamic_extents{};
+    std::size_t d = 0;
+    for (std::size_t r = 0; r < Extents::rank(); ++r) {
+        if (Extents::static_extent(r) == dynamic_extent)
+            dynamic_extents[d++] = header.shape[r];
+        else if (Extents::static_extent(r) != header.shape[r])
+            throw std::runtime_error("npy: static extent mismatch in " + path);
+    }
+    return Extents(dynamic_extents);
+}
+
+} // namespace detail
+
+template<class T, class E, class LP, class CP>
+void write_npy(std::string const& path, basic_mdarray<T, E, LP, CP> const& a) {
+    using value_type = std::remove_cv_t<T>;
+    if constexpr ((std::is_same_v<LP, layout_left> || std::is_same_v<LP, layout_right>) && detail::has_raw_pointer_v<basic_mdarray<T, E, LP, CP> const>) {
+        npy_writer<value_type> w(path, a.extents(), LP{});
+        w.write(a.data(), static_cast<std::size_t>(a.size()));
+        w.close();
+    }
+    else {
+        // Other layouts and storage are written in C order through a bounded
+        // buffer.
+        npy_writer<value_type> w(path, a.extents(), layout_right{});
+        std::vector<value_type> buffer;
+        buffer.reserve(4096);
+        detail::for_each_index_in_order<true>(a.extents(), [&](auto const& idx) {
+            buffer.push_back(a(idx));
+            if (buffer.size() == buffer.capacity()) {
+                w.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        });
+        w.write(buffer.data(), buffer.size());
+        w.close();
+    }
+}
+
+// Maps the payload of a .npy file directly into an mdarray without copying.
+// The file's dtype, rank, static extents and storage order must match `T`,
+// `Extents` and `Layout`.
+template<class T, class Extents, class Layout = layout_right>
+basic_mdarray<T, Extents, Layout, mmap_container_policy<T>>
+open_npy(std::string const& path, mmap_mode const mode = mmap_mode::read_only, mmap_sharing const sharing = mmap_sharing::shared) {
+    npy_header const header = read_npy_header(path);
+    if (header.descr != detail::npy_descr<std::remove_cv_t<T>>())
+        throw std::runtime_error("npy: dtype " + header.descr + " of " + path + " does not match the element type");
+    if (header.fortran_order != detail::npy_fortran_order<Layout>())
+        throw std::runtime_error("npy: storage order of " + path + " does not match the layout");
+
+    using mapping_type = typename Layout::template mapping<Extents>;
+    return basic_mdarray<T, Extents, Layout, mmap_container_policy<T>>(
+        mapping_type(detail::npy_extents<Extents>(header, path)),
+        mmap_container_policy<T>(path, mode, sharing, header.data_offset));
+}
+
+// Reads a .npy file into a freshly allocated mdarray, converting the storage
+// order if it differs from `Layout`.
+template<class T, class Extents, class Layout = layout_right>
+basic_mdarray<T, Extents, Layout> load_npy(std::string const& path) {
+    npy_header const header = read_npy_header(path);
+    Extents const e = detail::npy_extents<Extents>(header, path);
+    basic_mdarray<T, Extents, Layout> result{typename Layout::template mapping<Extents>(e)};
+
+    if (header.fortran_order == detail::npy_fortran_order<Layout>()) {
+        auto const source = open_npy<T const, Extents, Layout>(path, mmap_mode::read_only, mmap_sharing::private_copy);
+        std::copy(source.data(), source.data() + source.size(), result.data());
+    }
+    else if (header.fortran_order) {
+        auto const source = open_npy<T const, Extents, layout_left>(path, mmap_mode::read_only, mmap_sharing::private_copy);
+        detail::for_each_index_in_order<false>(e, [&](auto const& idx) { result(idx) = source(idx); });
+    }
+    else {
+        auto const source = open_npy<T const, Extents, layout_right>(path, mmap_mode::read_only, mmap_sharing::private_copy);
+        detail::for_each_index_in_order<true>(e, [&](auto const& idx) { result(idx) = source(idx); });
+    }
+    return result;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#include "container_policy.hpp"
+#include "parallel.hpp"
+
+#if defined(__linux__) && __has_include(<linux/mempolicy.h>)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(SYS_mbind)
+#define MDARRAY_HAS_MBIND 1
+#endif
+#endif
+
+// NUMA-aware allocation. A large array value-initialized by the thread that
+// constructs it has all of its pages placed on that thread's node, and
+// parallel kernels running on other nodes then share one node's memory
+// bandwidth. numa_container_policy allocates without touching the memory and
+// value-initializes it on a thread_pool with the same partitioning that
+// transform, transform_reduce and the other parallel algorithms use for
+// contiguous operands, so under the kernel's default first-touch policy each
+// page lands on the node of the pool thread that will later work on it.
+//
+// Pages can instead be interleaved across all nodes or bound to one node
+// (through mbind, on Linux). On machines with a single node, or where mbind
+// is unavailable, placement is left to the kernel; initialization is still
+// parallel.
+
+enum class numa_placement {
+    first_touch, // the node of the pool thread that initializes the page
+    interleave,  // round-robin across all online nodes
+    bind         // one given node
+};
+
+namespace detail {
+
+inline constexpr std::size_t numa_page_size = 4096;
+
+// Bit n set for every online node n < 64, from the kernel's list of online
+// nodes ("0", "0-1", "0,2-3"). 1 (node 0) if the list is unavailable.
+inline unsigned long online_numa_node_mask() {
+    unsigned long mask = 0;
+#if defined(__linux__)
+    std::ifstream in("/sys/devices/system/node/online");
+    std::string list;
+    if (in >> list) {
+        std::size_t i = 0;
+        while (i < list.size()) {
+            std::size_t end = 0;
+            unsigned long const first = std::stoul(list.substr(i), &end);
+            i += end;
+            unsigned long last = first;
+            if (i < list.size() && list[i] == '-') {
+                last = std::stoul(list.substr(i + 1), &end);
+                i += end + 1;
+            }
+            for (unsigned long n = first; n <= last && n < 64; ++n)
+                mask |= 1ul << n;
+            if (i < list.size() && list[i] == ',')
+                ++i;
+        }
+    }
+#endif
+    return mask != 0 ? mask : 1;
+}
+
+// Applies the memory policy to the pages of [p, p + bytes), p page-aligned.
+// Pages are placed when first touched. On failure the default policy stays.
+inline void apply_numa_placement([[maybe_unused]] void* const p, [[maybe_unused]] std::size_t const bytes,
+                                 numa_placement const placement, [[maybe_unused]] int const node) noexcept {
+    if (placement == numa_placement::first_touch)
+        return;
+#if defined(MDARRAY_HAS_MBIND)
+    unsigned long mask = 0;
+    try {
+        mask = placement == numa_placement::interleave ? online_numa_node_mask() : 1ul << (node & 63);
+    }
+    catch (...) {
+        return;
+    }
+    int const mode = placement == numa_placement::interleave ? MPOL_INTERLEAVE : MPOL_BIND;
+    ::syscall(SYS_mbind, p, bytes, mode, &mask, sizeof(mask) * 8, 0);
+#endif
+}
+
+} // namespace detail
+
+// Number of online NUMA nodes; 1 where it cannot be determined.
+inline std::size_t numa_node_count() {
+    unsigned long mask = detail::online_numa_node_mask();
+    std::size_t count = 0;
+    for (; mask != 0; mask &= mask - 1)
+        ++count;
+    return count;
+}
+
+// Maps fresh pages, applies the placement, and value-initializes the
+// elements in parallel on `pool` (the global pool by default). Arrays smaller
+// than a page, and all arrays outside Linux, come from operator new and are
+// initialized on the calling thread. The pool's threads are not pinned, so
+// pages follow them only while the scheduler keeps them on their nodes.
+template<class T>
+class numa_container_policy {
+    static_assert(std::is_nothrow_default_constructible_v<T>, "elements are initialized in parallel and must not throw");
+public:
+    using element_type = T;
+    using container_type = std::unique_ptr<T[], detail::huge_page_deleter<T>>;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using reference = T&;
+    using const_reference = T const&;
+    using offset_policy = default_container_policy<T>;
+
+    static constexpr std::size_t alignment = alignof(T) < 64 ? 64 : alignof(T);
+
+    numa_container_policy() noexcept = default;
+    explicit numa_container_policy(numa_placement const placement, int const node = 0) noexcept : placement_(placement), node_(node) {}
+    explicit numa_container_policy(thread_pool& pool, numa_placement const placement = numa_placement::first_touch, int const node = 0) noexcept
+        : pool_(&pool), placement_(placement), node_(node)
+    {}
+
+    container_type create(std::size_t const n) const {
+        std::size_t const bytes = n * sizeof(T);
+#if defined(__linux__)
+        // A fresh mapping, so no page has been placed by an earlier touch.
+        if (bytes >= detail::numa_page_size) {
+            std::size_t const mapped = (bytes + detail::numa_page_size - 1) & ~(detail::numa_page_size - 1);
+            void* const raw = ::mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED)
+                throw std::bad_alloc();
+            detail::apply_numa_placement(raw, mapped, placement_, node_);
+
+            T* const p = static_cast<T*>(raw);
+            thread_pool& pool = pool_ != nullptr ? *pool_ : thread_pool::global();
+            std::size_t const chunks = std::min(n, pool.size() * detail::tiles_per_thread);
+            pool.parallel_for(chunks, [&](std::size_t const c) {
+                std::size_t const first = c * n / chunks;
+                std::uninitialized_value_construct_n(p + first, (c + 1) * n / chunks - first);
+            });
+            return container_type(p, detail::huge_page_deleter<T>{n, mapped});
+        }
+#endif
+        auto a = detail::allocate_aligned_array<T, true>(n, alignment);
+        return container_type(a.release(), detail::huge_page_deleter<T>{n, 0});
+    }
+
+    reference access(container_type const& p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(container_type const& p, std::ptrdiff_t const i) const { return p[i]; }
+    reference access(pointer const p, std::ptrdiff_t const i) { return p[i]; }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const { return p[i]; }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
+
+    element_type* decay(pointer const p) { return p; }
+    element_type const* decay(pointer const p) const { return p; }
+
+    pointer data(container_type& c) { return c.get(); }
+    const_pointer data(container_type const& c) const { return c.get(); }
+
+    numa_placement placement() const noexcept { return placement_; }
+    int node() const noexcept { return node_; }
+
+private:
+    thread_pool* pool_ = nullptr;
+    numa_placement placement_ = numa_placement::first_touch;
+    int node_ = 0;
+};
@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mdarray.hpp"
+
+// Parallel algorithms over the index space of a basic_mdarray or view.
+//
+// The index space is split into tiles along the dimensions with the largest
+// strides, so each tile covers a compact slab of memory and the innermost
+// loop runs over the smallest stride. Contiguous operands are split into flat
+// ranges of storage offsets instead. Tiles are executed on a work-stealing
+// thread_pool.
+
+namespace detail {
+
+inline thread_local bool in_parallel_region = false;
+
+// A range of work items owned by one participant. The owner takes items from
+// the front, thieves take the back half.
+struct alignas(64) work_range {
+    std::mutex m;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+
+    void assign(std::size_t const b, std::size_t const e) {
+        std::lock_guard<std::mutex> lock(m);
+        begin = b;
+        end = e;
+    }
+
+    bool pop(std::size_t& i) {
+        std::lock_guard<std::mutex> lock(m);
+        if (begin == end)
+            return false;
+        i = begin++;
+        return true;
+    }
+
+    bool steal(std::size_t& b, std::size_t& e) {
+        std::lock_guard<std::mutex> lock(m);
+        std::size_t const n = end - begin;
+        if (n == 0)
+            return false;
+        e = end;
+        b = end - (n + 1) / 2;
+        end = b;
+        return true;
+    }
+};
+
+} // namespace detail
+
+class thread_pool {
+public:
+    // `threads` counts the calling thread, which takes part in every job.
+    explicit thread_pool(std::size_t const threads = std::max(1u, std::thread::hardware_concurrency()))
+        : ranges_(std::max<std::size_t>(threads, 1))
+    {
+        for (std::size_t k = 1; k < ranges_.size(); ++k)
+            workers_.emplace_back([this, k] { worker_loop(k); });
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& w : workers_)
+            w.join();
+    }
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    std::size_t size() const noexcept { return ranges_.size(); }
+
+    // Calls f(i) for every i in [0, n). Items are initially split evenly
+    // between the participants; idle participants steal half of the
+    // remaining items of another. Calls from inside a job run serially.
+    template<class F>
+    void parallel_for(std::size_t const n, F&& f) {
+        if (n == 0)
+            return;
+        if (workers_.empty() || n == 1 || detail::in_parallel_region) {
+            for (std::size_t i = 0; i < n; ++i)
+                f(i);
+            return;
+        }
+
+        std::lock_guard<std::mutex> job_lock(job_mutex_);
+        job_context_ = std::addressof(f);
+        job_ = [](void* const context, std::size_t const i) { (*static_cast<std::remove_reference_t<F>*>(context))(i); };
+        error_ = nullptr;
+        std::size_t const p = size();
+        for (std::size_t k = 0; k < p; ++k)
+            ranges_[k].assign(k * n / p, (k + 1) * n / p);
+
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            finished_workers_ = 0;
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        detail::in_parallel_region = true;
+        run(0);
+        detail::in_parallel_region = false;
+
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        done_.wait(lock, [this] { return finished_workers_ == workers_.size(); });
+        if (error_)
+            std::rethrow_exception(error_);
+    }
+
+    // Shared pool sized to the hardware concurrency.
+    static thread_pool& global() {
+        static thread_pool pool;
+        return pool;
+    }
+
+private:
+    void worker_loop(std::size_t const k) {
+        detail::in_parallel_region = true;
+        std::size_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(state_mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_)
+                    return;
+                seen = generation_;
+            }
+            run(k);
+            {
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                ++finished_workers_;
+            }
+            done_.notify_one();
+        }
+    }
+
+    void run(std::size_t const k) {
+        std::size_t const p = size();
+        for (;;) {
+            std::size_t i = 0;
+            while (ranges_[k].pop(i))
+                execute(i);
+
+            bool stolen = false;
+            for (std::size_t j = 1; j < p && !stolen; ++j) {
+                std::size_t b = 0;
+                std::size_t e = 0;
+                if (ranges_[(k + j) % p].steal(b, e)) {
+                    ranges_[k].assign(b, e);
+                    stolen = true;
+                }
+            }
+            if (!stolen)
+                return;
+        }
+    }
+
+    void execute(std::size_t const i) noexcept {
+        try {
+            job_(job_context_, i);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+    }
+
+    std::vector<detail::work_range> ranges_;
+    std::vector<std::thread> workers_;
+
+    std::mutex job_mutex_;
+    void* job_context_ = nullptr;
+    void (*job_)(void*, std::size_t) = nullptr;
+    std::exception_ptr error_;
+
+    std::mutex state_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::size_t generation_ = 0;
+    std::size_t finished_workers_ = 0;
+    bool stop_ = false;
+};
+
+namespace detail {
+
+// Tiles per participant; more tiles give stealing room to balance load.
+inline constexpr std::size_t tiles_per_thread = 8;
+
+// Splits the index space of an mdarray into tiles. The `outer_dims`
+// dimensions with the largest strides are flattened into an outer index
+// space that is cut into `tiles` ranges; the remaining dimensions are
+// iterated in full inside each tile.
+template<std::size_t Rank>
+struct tile_space {
+    std::array<std::size_t, Rank> order{};
+    std::array<std::ptrdiff_t, Rank> extents{};
+    std::size_t outer_dims = 0;
+    std::ptrdiff_t outer_size = 1;
+    std::size_t tiles = 0;
+};
+
+template<class MD>
+tile_space<MD::rank()> make_tile_space(MD const& md, std::size_t const participants) {
+    constexpr std::size_t rank = MD::rank();
+    tile_space<rank> ts;
+    ts.order = loop_order(md);
+    for (std::size_t r = 0; r < rank; ++r)
+        ts.extents[r] = md.extent(r);
+    if (md.size() == 0)
+        return ts;
+
+    std::size_t const target = participants * tiles_per_thread;
+    std::size_t const max_outer = rank > 1 ? rank - 1 : rank;
+    while (ts.outer_dims < max_outer && static_cast<std::size_t>(ts.outer_size) < target)
+        ts.outer_size *= ts.extents[ts.order[ts.outer_dims++]];
+    ts.tiles = std::min<std::size_t>(static_cast<std::size_t>(ts.outer_size), target);
+    return ts;
+}
+
+// Calls f(idx) for every index in tile `t`, innermost dimension fastest.
+template<std::size_t Rank, class F>
+void for_each_index_in_tile(tile_space<Rank> const& ts, std::size_t const t, F&& f) {
+    std::ptrdiff_t const first = static_cast<std::ptrdiff_t>(t * static_cast<std::size_t>(ts.outer_size) / ts.tiles);
+    std::ptrdiff_t const last = static_cast<std::ptrdiff_t>((t + 1) * static_cast<std::size_t>(ts.outer_size) / ts.tiles);
+    std::array<std::ptrdiff_t, Rank> idx{};
+
+    for (std::ptrdiff_t o = first; o < last; ++o) {
+        std::ptrdiff_t rest = o;
+        for (std::size_t k = ts.outer_dims; k-- > 0;) {
+            std::size_t const r = ts.order[k];
+            idx[r] = rest % ts.extents[r];
+            rest /= ts.extents[r];
+        }
+
+        if (ts.outer_dims == Rank) {
+            f(idx);
+            continue;
+        }
+
+        std::size_t const inner = ts.order[Rank - 1];
+        for (;;) {
+            for (idx[inner] = 0; idx[inner] < ts.extents[inner]; ++idx[inner])
+                f(idx);
+            idx[inner] = 0;
+
+            std::size_t k = Rank - 1;
+            for (; k-- > ts.outer_dims;) {
+                std::size_t const r = ts.order[k];
+                if (++idx[r] < ts.extents[r])
+                    break;
+                idx[r] = 0;
+            }
+            if (k == ts.outer_dims - 1)
+                break;
+        }
+    }
+}
+
+// The elements of `md` as one raw array if they are contiguous, else null.
+template<class MD>
+auto flat_data(MD const& md) {
+    if constexpr (!has_raw_pointer_v<MD>)
+        return static_cast<typename MD::value_type const*>(nullptr);
+    else
+        return md.is_contiguous() ? md.data() : nullptr;
+}
+
+} // namespace detail
+
+// Calls f(i0, i1, ..., iN) for every index of `md`.
+template<class MD, class F>
+void for_each_index(thread_pool& pool, MD const& md, F f) {
+    auto const ts = detail::make_tile_space(md, pool.size());
+    pool.parallel_for(ts.tiles, [&](std::size_t const t) {
+        detail::for_each_index_in_tile(ts, t, [&](auto const& idx) { std::apply(f, idx); });
+    });
+}
+
+template<class MD, class F>
+void for_each_index(MD const& md, F f) {
+    for_each_index(thread_pool::global(), md, std::move(f));
+}
+
+// out(idx) = f(in(idx)) for every index; `in` and `out` must have equal extents.
+template<class In, class Out, class F>
+void transform(thread_pool& pool, In const& in, Out&& out, F f) {
+    if constexpr (detail::has_raw_pointer_v<In> && detail::has_raw_pointer_v<detail::remove_cvref_t<Out>>) {
+        if (detail::same_flat_storage(in, out)) {
+            auto const* const src = in.data();
+            auto* const dst = out.data();
+            std::size_t const n = static_cast<std::size_t>(in.size());
+            std::size_t const chunks = std::min(n, pool.size() * detail::tiles_per_thread);
+            pool.parallel_for(chunks, [&](std::size_t const c) {
+                std::size_t const last = (c + 1) * n / chunks;
+                for (std::size_t i = c * n / chunks; i < last; ++i)
+                    dst[i] = f(src[i]);
+            });
+            return;
+        }
+    }
+
+    auto const ts = detail::make_tile_space(out, pool.size());
+    pool.parallel_for(ts.tiles, [&](std::size_t const t) {
+        detail::for_each_index_in_tile(ts, t, [&](auto const& idx) { out(idx) = f(in(idx)); });
+    });
+}
+
+template<class In, class Out, class F>
+void transform(In const& in, Out&& out, F f) {
+    transform(thread_pool::global(), in, std::forward<Out>(out), std::move(f));
+}
+
+// Combines init with transform_op(x) for every element x using reduce_op,
+// which must be associative and commutative. Partial results are combined in
+// tile order, so the result is deterministic for a given pool size.
+template<class MD, class T, class ReduceOp, class TransformOp>
+T transform_reduce(thread_pool& pool, MD const& md, T init, ReduceOp reduce_op, TransformOp transform_op) {
+    std::vector<std::optional<T>> partials;
+
+    if (auto const* const p = detail::flat_data(md)) {
+        std::size_t const n = static_cast<std::size_t>(md.size());
+        std::size_t const chunks = std::min(n, pool.size() * detail::tiles_per_thread);
+        partials.resize(chunks);
+        pool.parallel_for(chunks, [&](std::size_t const c) {
+            std::size_t const first = c * n / chunks;
+            std::size_t const last = (c + 1) * n / chunks;
+            T acc = static_cast<T>(transform_op(p[first]));
+            for (std::size_t i = first + 1; i < last; ++i)
+                acc = reduce_op(acc, transform_op(p[i]));
+            partials[c] = acc;
+        });
+    }
+    else {
+        auto const ts = detail::make_tile_space(md, pool.size());
+        partials.resize(ts.tiles);
+        pool.parallel_for(ts.tiles, [&](std::size_t const t) {
+            std::optional<T> acc;
+            detail::for_each_index_in_tile(ts, t, [&](auto const& idx) {
+                acc = acc ? reduce_op(*acc, transform_op(md(idx))) : static_cast<T>(transform_op(md(idx)));
+            });
+            partials[t] = acc;
+        });
+    }
+
+    for (auto const& partial : partials) {
+        if (partial)
+            init = reduce_op(init, *partial);
+    }
+    return init;
+}
+
+template<class MD, class T, class ReduceOp, class TransformOp>
+T transform_reduce(MD const& md, T init, ReduceOp reduce_op, TransformOp transform_op) {
+    return transform_reduce(thread_pool::global(), md, std::move(init), std::move(reduce_op), std::move(transform_op));
+}
+
+template<class MD, class T, class ReduceOp>
+T reduce(thread_pool& pool, MD const& md, T init, ReduceOp reduce_op) {
+    return transform_reduce(pool, md, std::move(init), std::move(reduce_op), [](auto const& x) -> decltype(auto) { return x; });
+}
+
+template<class MD, class T, class ReduceOp>
+T reduce(MD const& md, T init, ReduceOp reduce_op) {
+    return reduce(thread_pool::global(), md, std::move(init), std::move(reduce_op));
+}
@@ -0,0 +1,745 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mdarray.hpp"
+#include "parallel.hpp"
+
+// Reductions and scans along one dimension of a basic_mdarray or view.
+//
+// reduce_axis<Axis> combines the elements along dimension Axis and returns a
+// new mdarray with that extent removed, or kept as 1 with KeepDims.
+// scan_axis<Axis> returns the running combination along Axis with the
+// extents of the input.
+//
+// The traversal follows the strides of the input so the innermost loop
+// always walks contiguous memory. If Axis is the unit-stride dimension, each
+// line is reduced with interleaved accumulators; otherwise whole rows
+// across the unit-stride dimension are accumulated element-wise, one row
+// of the reduced dimension at a time. Both loops vectorize. Results use
+// layout_left if the input does, else layout_right.
+
+enum class summation {
+    naive,    // running sums; error grows linearly with the extent
+    pairwise, // recursive halving; error grows with its logarithm
+    kahan     // compensated; error independent of the extent
+};
+
+namespace detail {
+
+// Independent accumulators per line when reducing along the unit-stride
+// dimension.
+inline constexpr std::ptrdiff_t reduction_lanes = 16;
+
+// Lines at most this long are summed directly by pairwise summation.
+inline constexpr std::ptrdiff_t pairwise_block = 128;
+
+// Width of the row segments accumulated at once when reducing across rows.
+inline constexpr std::ptrdiff_t reduction_row_block = 1024;
+
+template<class Layout>
+struct reduction_layout {
+    using type = layout_right;
+};
+
+template<>
+struct reduction_layout<layout_left> {
+    using type = layout_left;
+};
+
+template<std::size_t Pad>
+struct reduction_layout<layout_left_padded<Pad>> {
+    using type = layout_left;
+};
+
+template<class E, std::size_t Axis, bool KeepDims, class Seq>
+struct reduced_extents_impl;
+
+template<class E, std::size_t Axis, std::size_t... Is>
+struct reduced_extents_impl<E, Axis, false, std::index_sequence<Is...>> {
+    using type = basic_extents<typename E::index_type, E::static_extent(Is < Axis ? Is : Is + 1)...>;
+};
+
+template<class E, std::size_t Axis, std::size_t... Is>
+struct reduced_extents_impl<E, Axis, true, std::index_sequence<Is...>> {
+    using type = basic_extents<typename E::index_type, (Is == Axis ? 1 : E::static_extent(Is))...>;
+};
+
+template<class E, std::size_t Axis, bool KeepDims>
+using reduced_extents_t = typename reduced_extents_impl<E, Axis, KeepDims, std::make_index_sequence<KeepDims ? E::rank() : E::rank() - 1>>::type;
+
+template<class U, class MD, std::size_t Axis, bool KeepDims>
+using reduced_mdarray_t = basic_mdarray<U, reduced_extents_t<typename MD::extents_type, Axis, KeepDims>, typename reduction_layout<typename MD::layout_type>::type>;
+
+template<class U, class MD>
+using scanned_mdarray_t = basic_mdarray<U, typename MD::extents_type, typename reduction_layout<typename MD::layout_type>::type>;
+
+// Allocates an mdarray of type Result whose extents are those of `md`
+// with dimension Axis removed, or replaced by 1 if Result has md's rank.
+template<class Result, std::size_t Axis, class MD>
+Result make_reduced(MD const& md) {
+    using result_extents = typename Result::extents_type;
+    constexpr bool keep = result_extents::rank() == MD::rank();
+    std::array<std::ptrdiff_t, result_extents::rank_dynamic()> dynamic_extents{};
+    std::size_t d = 0;
+    for (std::size_t r = 0; r < result_extents::rank(); ++r) {
+        std::size_t const source = keep || r < Axis ? r : r + 1;
+        if (result_extents::static_extent(r) == dynamic_extent)
+            dynamic_extents[d++] = keep && r == Axis ? 1 : md.extent(source);
+    }
+    return Result(typename Result::mapping_type(result_extents(dynamic_extents)));
+}
+
+// Sets the dimensions dims[0], ..., dims[count - 1] of `idx` (outer to
+// inner) to the position of `item` in their index space.
+template<std::size_t Rank>
+void decode_index(std::size_t item, std::array<std::size_t, Rank> const& dims, std::size_t const count,
+                  std::array<std::ptrdiff_t, Rank> const& n, std::array<std::ptrdiff_t, Rank>& idx) noexcept {
+    for (std::size_t k = count; k-- > 0;) {
+        std::size_t const r = dims[k];
+        idx[r] = static_cast<std::ptrdiff_t>(item % static_cast<std::size_t>(n[r]));
+        item /= static_cast<std::size_t>(n[r]);
+    }
+}
+
+// Calls f(step) with the step as unit_step if it is 1.
+template<class F>
+decltype(auto) with_step(std::ptrdiff_t const step, F&& f) {
+    if (step == 1)
+        return f(unit_step{});
+    return f(step);
+}
+
+// Combines load(0), ..., load(n - 1), n > 0, with `reduction_lanes`
+// interleaved accumulators.
+template<class U, class Op, class Load>
+U fold_line(Op const& op, Load const& load, std::ptrdiff_t const n) {
+    constexpr std::ptrdiff_t lanes = reduction_lanes;
+    if (n < 2 * lanes) {
+        U acc = static_cast<U>(load(0));
+        for (std::ptrdiff_t i = 1; i < n; ++i)
+            acc = op(acc, load(i));
+        return acc;
+    }
+
+    std::array<U, lanes> acc;
+    for (std::ptrdiff_t k = 0; k < lanes; ++k)
+        acc[k] = static_cast<U>(load(k));
+    std::ptrdiff_t i = lanes;
+    for (; i + lanes <= n; i += lanes) {
+        for (std::ptrdiff_t k = 0; k < lanes; ++k)
+            acc[k] = op(acc[k], load(i + k));
+    }
+    for (; i < n; ++i)
+        acc[0] = op(acc[0], load(i));
+
+    U result = acc[0];
+    for (std::ptrdiff_t k = 1; k < lanes; ++k)
+        result = op(result, acc[k]);
+    return result;
+}
+
+template<class U, class Load>
+U pairwise_sum(Load const& load, std::ptrdiff_t const first, std::ptrdiff_t const n) {
+    if (n <= pairwise_block)
+        return fold_line<U>(std::plus<>{}, [&](std::ptrdiff_t const i) { return load(first + i); }, n);
+    // Halves at a multiple of the lane count so blocks stay aligned.
+    std::ptrdiff_t const half = n / 2 / reduction_lanes * reduction_lanes;
+    return pairwise_sum<U>(load, first, half) + pairwise_sum<U>(load, first + half, n - half);
+}
+
+// Adds x to the compensated sum (sum, c).
+template<class U>
+void kahan_add(U& sum, U& c, U const x) noexcept {
+    U const y = x - c;
+    U const t = sum + y;
+    c = (t - sum) - y;
+    sum = t;
+}
+
+template<class U, class Load>
+U kahan_sum(Load const& load, std::ptrdiff_t const n) {
+    constexpr std::ptrdiff_t lanes = reduction_lanes;
+    std::array<U, lanes> sum{};
+    std::array<U, lanes> c{};
+    std::ptrdiff_t i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        for (std::ptrdiff_t k = 0; k < lanes; ++k)
+            kahan_add(sum[k], c[k], static_cast<U>(load(i + k)));
+    }
+    for (; i < n; ++i)
+        kahan_add(sum[0], c[0], static_cast<U>(load(i)));
+
+    U total{};
+    U total_c{};
+    for (std::ptrdiff_t k = 0; k < lanes; ++k) {
+        kahan_add(total, total_c, sum[k]);
+        kahan_add(total, total_c, -c[k]);
+    }
+    return total;
+}
+
+// Reductions given as a pair of kernels: line(load, n) reduces load(0),
+// ..., load(n - 1); rows(row, step, count, out, width) reduces
+// row(a)[j * step] over a in [0, count) into out[j] for j in [0, width).
+// Both are called with n, count > 0.
+
+template<class U, class Op>
+struct fold_kernel {
+    Op op;
+
+    template<class Load>
+    U line(Load const& load, std::ptrdiff_t const n) const { return fold_line<U>(op, load, n); }
+
+    template<class Row, class Step>
+    void rows(Row const& row, Step const step, std::ptrdiff_t const count, U* const out, std::ptrdiff_t const width) const {
+        auto const* const first = row(0);
+        for (std::ptrdiff_t j = 0; j < width; ++j)
+            out[j] = static_cast<U>(first[j * step]);
+        for (std::ptrdiff_t a = 1; a < count; ++a) {
+            auto const* const r = row(a);
+            for (std::ptrdiff_t j = 0; j < width; ++j)
+                out[j] = op(out[j], r[j * step]);
+        }
+    }
+};
+
+template<class U>
+struct sum_kernel {
+    summation mode;
+
+    template<class Load>
+    U line(Load const& load, std::ptrdiff_t const n) const {
+        if constexpr (std::is_floating_point_v<U>) {
+            if (mode == summation::pairwise)
+                return pairwise_sum<U>(load, 0, n);
+            if (mode == summation::kahan)
+                return kahan_sum<U>(load, n);
+        }
+        return fold_line<U>(std::plus<>{}, load, n);
+    }
+
+    template<class Row, class Step>
+    void rows(Row const& row, Step const step, std::ptrdiff_t const count, U* const out, std::ptrdiff_t const width) const {
+        if constexpr (std::is_floating_point_v<U>) {
+            if (mode == summation::pairwise) {
+                // One scratch row per level of halving above pairwise_block.
+                thread_local std::vector<U> scratch;
+                std::size_t levels = 0;
+                for (std::ptrdiff_t c = count; c > pairwise_block; c -= c / 2 / reduction_lanes * reduction_lanes)
+                    ++levels;
+                scratch.resize(levels * static_cast<std::size_t>(width));
+                pairwise_rows(row, step, 0, count, out, width, scratch.data());
+                return;
+            }
+            if (mode == summation::kahan) {
+                thread_local std::vector<U> c;
+                c.assign(static_cast<std::size_t>(width), U{});
+                std::fill_n(out, width, U{});
+                for (std::ptrdiff_t a = 0; a < count; ++a) {
+                    auto const* const r = row(a);
+                    for (std::ptrdiff_t j = 0; j < width; ++j)
+                        kahan_add(out[j], c[static_cast<std::size_t>(j)], static_cast<U>(r[j * step]));
+                }
+                return;
+            }
+        }
+        fold_kernel<U, std::plus<>>{}.rows(row, step, count, out, width);
+    }
+
+    template<class Row, class Step>
+    void pairwise_rows(Row const& row, Step const step, std::ptrdiff_t const first, std::ptrdiff_t const count, U* const out,
+                       std::ptrdiff_t const width, U* const scratch) const {
+        if (count <= pairwise_block) {
+            fold_kernel<U, std::plus<>>{}.rows([&](std::ptrdiff_t const a) { return row(first + a); }, step, count, out, width);
+            return;
+        }
+        std::ptrdiff_t const half = count / 2 / reduction_lanes * reduction_lanes;
+        pairwise_rows(row, step, first, half, out, width, scratch + width);
+        pairwise_rows(row, step, first + half, count - half, scratch, width, scratch + width);
+        for (std::ptrdiff_t j = 0; j < width; ++j)
+            out[j] += scratch[j];
+    }
+};
+
+// Index of the first element x along the line for which no other element
+// y has better(y, x).
+template<class T, class Better>
+struct arg_kernel {
+    Better better;
+
+    template<class Load>
+    std::ptrdiff_t line(Load const& load, std::ptrdiff_t const n) const {
+        constexpr std::ptrdiff_t lanes = reduction_lanes;
+        T best = load(0);
+        std::ptrdiff_t best_index = 0;
+        std::ptrdiff_t i = 1;
+        if (n >= 2 * lanes) {
+            std::array<T, lanes> lane_best;
+            std::array<std::ptrdiff_t, lanes> lane_index;
+            for (std::ptrdiff_t k = 0; k < lanes; ++k) {
+                lane_best[k] = load(k);
+                lane_index[k] = k;
+            }
+            for (i = lanes; i + lanes <= n; i += lanes) {
+                for (std::ptrdiff_t k = 0; k < lanes; ++k) {
+                    T const x = load(i + k);
+                    bool const b = better(x, lane_best[k]);
+                    lane_best[k] = b ? x : lane_best[k];
+                    lane_index[k] = b ? i + k : lane_index[k];
+                }
+            }
+            best = lane_best[0];
+            best_index = lane_index[0];
+            for (std::ptrdiff_t k = 1; k < lanes; ++k) {
+                if (better(lane_best[k], best) || (!better(best, lane_best[k]) && lane_index[k] < best_index)) {
+                    best = lane_best[k];
+                    best_index = lane_index[k];
+                }
+            }
+        }
+        for (; i < n; ++i) {
+            T const x = load(i);
+            if (better(x, best)) {
+                best = x;
+                best_index = i;
+            }
+        }
+        return best_index;
+    }
+
+    template<class Row, class Step>
+    void rows(Row const& row, Step const step, std::ptrdiff_t const count, std::ptrdiff_t* const out, std::ptrdiff_t const width) const {
+        thread_local std::vector<T> best;
+        best.resize(static_cast<std::size_t>(width));
+        auto const* const first = row(0);
+        for (std::ptrdiff_t j = 0; j < width; ++j) {
+            best[static_cast<std::size_t>(j)] = first[j * step];
+            out[j] = 0;
+        }
+        for (std::ptrdiff_t a = 1; a < count; ++a) {
+            auto const* const r = row(a);
+            for (std::ptrdiff_t j = 0; j < width; ++j) {
+                T const x = r[j * step];
+                bool const b = better(x, best[static_cast<std::size_t>(j)]);
+                best[static_cast<std::size_t>(j)] = b ? x : best[static_cast<std::size_t>(j)];
+                out[j] = b ? a : out[j];
+            }
+        }
+    }
+};
+
+struct fold_min_op {
+    template<class T>
+    constexpr T operator()(T const& a, T const& b) const { return b < a ? b : a; }
+};
+
+struct fold_max_op {
+    template<class T>
+    constexpr T operator()(T const& a, T const& b) const { return a < b ? b : a; }
+};
+
+template<std::size_t Axis, bool KeepDims, class U, class MD, class Kernel>
+reduced_mdarray_t<U, MD, Axis, KeepDims> reduce_axis_impl(thread_pool& pool, MD const& md, Kernel const& kernel) {
+    constexpr std::size_t rank = MD::rank();
+    static_assert(Axis < rank, "reduction axis out of range");
+    using result_type = reduced_mdarray_t<U, MD, Axis, KeepDims>;
+
+    result_type result = make_reduced<result_type, Axis>(md);
+    if (result.size() == 0)
+        return result;
+
+    std::array<std::ptrdiff_t, rank> n{};
+    std::array<std::ptrdiff_t, rank> out_strides{};
+    for (std::size_t r = 0; r < rank; ++r) {
+        n[r] = md.extent(r);
+        if (r != Axis)
+            out_strides[r] = result.stride(KeepDims || r < Axis ? r : r - 1);
+    }
+    std::ptrdiff_t const count = n[Axis];
+    assert(count > 0);
+    U* const out = result.data();
+    auto const order = loop_order(md);
+
+    auto const out_offset = [&](std::array<std::ptrdiff_t, rank> const& idx) {
+        std::ptrdiff_t offset = 0;
+        for (std::size_t r = 0; r < rank; ++r)
+            offset += idx[r] * out_strides[r];
+        return offset;
+    };
+
+    if constexpr (is_direct_strided_v<MD> && rank > 1) {
+        std::size_t const q = order[rank - 1];
+        if (q != Axis && n[q] > 1) {
+            // Rows across the unit-stride dimension q, cut into segments of
+            // reduction_row_block elements so that there is parallelism even
+            // when the other dimensions are short.
+            std::array<std::size_t, rank> outer{};
+            std::size_t outer_count = 0;
+            std::size_t items = 1;
+            for (std::size_t const r : order) {
+                if (r != Axis && r != q) {
+                    outer[outer_count++] = r;
+                    items *= static_cast<std::size_t>(n[r]);
+                }
+            }
+            std::size_t const segments = static_cast<std::size_t>((n[q] + reduction_row_block - 1) / reduction_row_block);
+            std::size_t const tasks = items * segments;
+            std::size_t const chunks = std::min(tasks, pool.size() * tiles_per_thread);
+            std::ptrdiff_t const axis_stride = md.stride(Axis);
+
+            pool.parallel_for(chunks, [&](std::size_t const c) {
+                thread_local std::vector<U> segment;
+                std::size_t const last = (c + 1) * tasks / chunks;
+                for (std::size_t task = c * tasks / chunks; task < last; ++task) {
+                    std::array<std::ptrdiff_t, rank> idx{};
+                    decode_index(task / segments, outer, outer_count, n, idx);
+                    idx[q] = static_cast<std::ptrdiff_t>(task % segments) * reduction_row_block;
+                    std::ptrdiff_t const width = std::min(reduction_row_block, n[q] - idx[q]);
+
+                    std::ptrdiff_t in_offset = 0;
+                    for (std::size_t r = 0; r < rank; ++r)
+                        in_offset += idx[r] * md.stride(r);
+                    auto const* const base = md.data() + in_offset;
+                    auto const row = [base, axis_stride](std::ptrdiff_t const a) { return base + a * axis_stride; };
+
+                    segment.resize(static_cast<std::size_t>(width));
+                    with_step(md.stride(q), [&](auto const step) { kernel.rows(row, step, count, segment.data(), width); });
+                    U* const dst = out + out_offset(idx);
+                    for (std::ptrdiff_t j = 0; j < width; ++j)
+                        dst[j * out_strides[q]] = segment[static_cast<std::size_t>(j)];
+                }
+            });
+            return result;
+        }
+    }
+
+    // One line along Axis per element of the result.
+    std::array<std::size_t, rank> outer{};
+    std::size_t outer_count = 0;
+    for (std::size_t const r : order) {
+        if (r != Axis)
+            outer[outer_count++] = r;
+    }
+    auto const items = static_cast<std::size_t>(result.size());
+    std::size_t const chunks = std::min(items, pool.size() * tiles_per_thread);
+
+    pool.parallel_for(chunks, [&](std::size_t const c) {
+        std::size_t const last = (c + 1) * items / chunks;
+        for (std::size_t item = c * items / chunks; item < last; ++item) {
+            std::array<std::ptrdiff_t, rank> idx{};
+            decode_index(item, outer, outer_count, n, idx);
+            U& dst = out[out_offset(idx)];
+            if constexpr (is_direct_strided_v<MD>) {
+                std::ptrdiff_t in_offset = 0;
+                for (std::size_t r = 0; r < rank; ++r)
+                    in_offset += idx[r] * md.stride(r);
+                auto const* const base = md.data() + in_offset;
+                dst = with_step(md.stride(Axis), [&](auto const step) {
+                    return kernel.line([base, step](std::ptrdiff_t const i) { return base[i * step]; }, count);
+                });
+            }
+            else {
+                dst = kernel.line([&](std::ptrdiff_t const i) {
+                    idx[Axis] = i;
+                    return md(idx);
+                }, count);
+            }
+        }
+    });
+    return result;
+}
+
+// Scans given as a pair of kernels: line(load, store, n) stores the running
+// result over load(0), ..., load(i) with store(i, value); rows(row, step,
+// out_row, out_step, count, width) does the same for every j in [0, width)
+// across rows, with out_row(a)[j * out_step] as destination.
+
+template<class U, class Op>
+struct fold_scan_kernel {
+    Op op;
+
+    template<class Load, class Store>
+    void line(Load const& load, Store const& store, std::ptrdiff_t const n) const {
+        U acc = static_cast<U>(load(0));
+        store(0, acc);
+        for (std::ptrdiff_t i = 1; i < n; ++i) {
+            acc = op(acc, load(i));
+            store(i, acc);
+        }
+    }
+
+    template<class Row, class Step, class OutRow>
+    void rows(Row const& row, Step const step, OutRow const& out_row, std::ptrdiff_t const out_step, std::ptrdiff_t const count,
+              std::ptrdiff_t const width) const {
+        U const* previous = nullptr;
+        for (std::ptrdiff_t a = 0; a < count; ++a) {
+            auto const* const r = row(a);
+            U* const o = out_row(a);
+            if (previous == nullptr) {
+                for (std::ptrdiff_t j = 0; j < width; ++j)
+                    o[j * out_step] = static_cast<U>(r[j * step]);
+            }
+            else {
+                for (std::ptrdiff_t j = 0; j < width; ++j)
+                    o[j * out_step] = op(previous[j * out_step], r[j * step]);
+            }
+            previous = o;
+        }
+    }
+};
+
+template<class U>
+struct kahan_scan_kernel {
+    template<class Load, class Store>
+    void line(Load const& load, Store const& store, std::ptrdiff_t const n) const {
+        U sum{};
+        U c{};
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            kahan_add(sum, c, static_cast<U>(load(i)));
+            store(i, sum);
+        }
+    }
+
+    template<class Row, class Step, class OutRow>
+    void rows(Row const& row, Step const step, OutRow const& out_row, std::ptrdiff_t const out_step, std::ptrdiff_t const count,
+              std::ptrdiff_t const width) const {
+        thread_local std::vector<U> sum;
+        thread_local std::vector<U> c;
+        sum.assign(static_cast<std::size_t>(width), U{});
+        c.assign(static_cast<std::size_t>(width), U{});
+        for (std::ptrdiff_t a = 0; a < count; ++a) {
+            auto const* const r = row(a);
+            U* const o = out_row(a);
+            for (std::ptrdiff_t j = 0; j < width; ++j) {
+                kahan_add(sum[static_cast<std::size_t>(j)], c[static_cast<std::size_t>(j)], static_cast<U>(r[j * step]));
+                o[j * out_step] = sum[static_cast<std::size_t>(j)];
+            }
+        }
+    }
+};
+
+template<std::size_t Axis, class U, class MD, class Kernel>
+scanned_mdarray_t<U, MD> scan_axis_impl(thread_pool& pool, MD const& md, Kernel const& kernel) {
+    constexpr std::size_t rank = MD::rank();
+    static_assert(Axis < rank, "scan axis out of range");
+    using result_type = scanned_mdarray_t<U, MD>;
+
+    result_type result(typename result_type::mapping_type(md.extents()));
+    if (result.size() == 0)
+        return result;
+
+    std::array<std::ptrdiff_t, rank> n{};
+    for (std::size_t r = 0; r < rank; ++r)
+        n[r] = md.extent(r);
+    std::ptrdiff_t const count = n[Axis];
+    auto const order = loop_order(md);
+    U* const out = result.data();
+
+    auto const out_offset = [&](std::array<std::ptrdiff_t, rank> const& idx) {
+        std::ptrdiff_t offset = 0;
+        for (std::size_t r = 0; r < rank; ++r)
+            offset += idx[r] * result.stride(r);
+        return offset;
+    };
+
+    if constexpr (is_direct_strided_v<MD> && rank > 1) {
+        std::size_t const q = order[rank - 1];
+        if (q != Axis && n[q] > 1) {
+            std::array<std::size_t, rank> outer{};
+            std::size_t outer_count = 0;
+            std::size_t items = 1;
+            for (std::size_t const r : order) {
+                if (r != Axis && r != q) {
+                    outer[outer_count++] = r;
+                    items *= static_cast<std::size_t>(n[r]);
+                }
+            }
+            std::size_t const segments = static_cast<std::size_t>((n[q] + reduction_row_block - 1) / reduction_row_block);
+            std::size_t const tasks = items * segments;
+            std::size_t const chunks = std::min(tasks, pool.size() * tiles_per_thread);
+            std::ptrdiff_t const axis_stride = md.stride(Axis);
+            std::ptrdiff_t const out_axis_stride = result.stride(Axis);
+
+            pool.parallel_for(chunks, [&](std::size_t const c) {
+                std::size_t const last = (c + 1) * tasks / chunks;
+                for (std::size_t task = c * tasks / chunks; task < last; ++task) {
+                    std::array<std::ptrdiff_t, rank> idx{};
+                    decode_index(task / segments, outer, outer_count, n, idx);
+                    idx[q] = static_cast<std::ptrdiff_t>(task % segments) * reduction_row_block;
+                    std::ptrdiff_t const width = std::min(reduction_row_block, n[q] - idx[q]);
+
+                    std::ptrdiff_t in_offset = 0;
+                    for (std::size_t r = 0; r < rank; ++r)
+                        in_offset += idx[r] * md.stride(r);
+                    auto const* const base = md.data() + in_offset;
+                    U* const out_base = out + out_offset(idx);
+                    auto const row = [base, axis_stride](std::ptrdiff_t const a) { return base + a * axis_stride; };
+                    auto const out_row = [out_base, out_axis_stride](std::ptrdiff_t const a) { return out_base + a * out_axis_stride; };
+                    with_step(md.stride(q), [&](auto const step) { kernel.rows(row, step, out_row, result.stride(q), count, width); });
+                }
+            });
+            return result;
+        }
+    }
+
+    std::array<std::size_t, rank> outer{};
+    std::size_t outer_count = 0;
+    std::size_t items = 1;
+    for (std::size_t const r : order) {
+        if (r != Axis) {
+            outer[outer_count++] = r;
+            items *= static_cast<std::size_t>(n[r]);
+        }
+    }
+    std::size_t const chunks = std::min(items, pool.size() * tiles_per_thread);
+    std::ptrdiff_t const out_axis_stride = result.stride(Axis);
+
+    pool.parallel_for(chunks, [&](std::size_t const c) {
+        std::size_t const last = (c + 1) * items / chunks;
+        for (std::size_t item = c * items / chunks; item < last; ++item) {
+            std::array<std::ptrdiff_t, rank> idx{};
+            decode_index(item, outer, outer_count, n, idx);
+            U* const dst = out + out_offset(idx);
+            auto const store = [dst, out_axis_stride](std::ptrdiff_t const i, U const& value) { dst[i * out_axis_stride] = value; };
+            if constexpr (is_direct_strided_v<MD>) {
+                std::ptrdiff_t in_offset = 0;
+                for (std::size_t r = 0; r < rank; ++r)
+                    in_offset += idx[r] * md.stride(r);
+                auto const* const base = md.data() + in_offset;
+                std::ptrdiff_t const step = md.stride(Axis);
+                kernel.line([base, step](std::ptrdiff_t const i) { return base[i * step]; }, store, count);
+            }
+            else {
+                kernel.line([&](std::ptrdiff_t const i) {
+                    idx[Axis] = i;
+                    return md(idx);
+                }, store, count);
+            }
+        }
+    });
+    return result;
+}
+
+} // namespace detail
+
+// Reduces `md` along dimension Axis: each result element is
+// op(init, op(...op(x0, x1)..., xn-1)) over the elements x along Axis, in
+// an unspecified order, so op must be associative and commutative. The
+// result holds elements of type T. If the extent along Axis is 0 every
+// result element is init.
+template<std::size_t Axis, bool KeepDims = false, class MD, class T, class Op>
+auto reduce_axis(thread_pool& pool, MD const& md, T const init, Op op) {
+    using result_type = detail::reduced_mdarray_t<T, MD, Axis, KeepDims>;
+    if (md.extent(Axis) == 0) {
+        auto result = detail::make_reduced<result_type, Axis>(md);
+        std::fill_n(result.data(), result.size(), init);
+        return result;
+    }
+    auto result = detail::reduce_axis_impl<Axis, KeepDims, T>(pool, md, detail::fold_kernel<T, Op>{op});
+    T* const p = result.data();
+    for (std::ptrdiff_t i = 0; i < result.size(); ++i)
+        p[i] = op(init, p[i]);
+    return result;
+}
+
+template<std::size_t Axis, bool KeepDims = false, class MD, class T, class Op>
+auto reduce_axis(MD const& md, T const init, Op op) {
+    return reduce_axis<Axis, KeepDims>(thread_pool::global(), md, init, std::move(op));
+}
+
+// Sums along Axis in the value type of `md`. Integral sums are always
+// naive.
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto sum_axis(thread_pool& pool, MD const& md, summation const mode = summation::pairwise) {
+    using value_type = std::remove_cv_t<typename MD::value_type>;
+    if (md.extent(Axis) == 0)
+        return reduce_axis<Axis, KeepDims>(pool, md, value_type{}, std::plus<>{});
+    return detail::reduce_axis_impl<Axis, KeepDims, value_type>(pool, md, detail::sum_kernel<value_type>{mode});
+}
+
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto sum_axis(MD const& md, summation const mode = summation::pairwise) {
+    return sum_axis<Axis, KeepDims>(thread_pool::global(), md, mode);
+}
+
+// Smallest and largest element along Axis, whose extent must not be 0.
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto min_axis(thread_pool& pool, MD const& md) {
+    return detail::reduce_axis_impl<Axis, KeepDims, std::remove_cv_t<typename MD::value_type>>(pool, md, detail::fold_kernel<std::remove_cv_t<typename MD::value_type>, detail::fold_min_op>{});
+}
+
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto min_axis(MD const& md) {
+    return min_axis<Axis, KeepDims>(thread_pool::global(), md);
+}
+
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto max_axis(thread_pool& pool, MD const& md) {
+    return detail::reduce_axis_impl<Axis, KeepDims, std::remove_cv_t<typename MD::value_type>>(pool, md, detail::fold_kernel<std::remove_cv_t<typename MD::value_type>, detail::fold_max_op>{});
+}
+
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto max_axis(MD const& md) {
+    return max_axis<Axis, KeepDims>(thread_pool::global(), md);
+}
+
+// Index along Axis of the first smallest or largest element, as
+// std::ptrdiff_t. The extent along Axis must not be 0.
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto argmin_axis(thread_pool& pool, MD const& md) {
+    using value_type = std::remove_cv_t<typename MD::value_type>;
+    return detail::reduce_axis_impl<Axis, KeepDims, std::ptrdiff_t>(pool, md, detail::arg_kernel<value_type, std::less<>>{});
+}
+
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto argmin_axis(MD const& md) {
+    return argmin_axis<Axis, KeepDims>(thread_pool::global(), md);
+}
+
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto argmax_axis(thread_pool& pool, MD const& md) {
+    using value_type = std::remove_cv_t<typename MD::value_type>;
+    return detail::reduce_axis_impl<Axis, KeepDims, std::ptrdiff_t>(pool, md, detail::arg_kernel<value_type, std::greater<>>{});
+}
+
+template<std::size_t Axis, bool KeepDims = false, class MD>
+auto argmax_axis(MD const& md) {
+    return argmax_axis<Axis, KeepDims>(thread_pool::global(), md);
+}
+
+// Inclusive scan along Axis: result(..., i, ...) = op(...op(x0, x1)..., xi).
+template<std::size_t Axis, class MD, class Op>
+auto scan_axis(thread_pool& pool, MD const& md, Op op) {
+    using value_type = std::remove_cv_t<typename MD::value_type>;
+    return detail::scan_axis_impl<Axis, value_type>(pool, md, detail::fold_scan_kernel<value_type, Op>{op});
+}
+
+template<std::size_t Axis, class MD, class Op>
+auto scan_axis(MD const& md, Op op) {
+    return scan_axis<Axis>(thread_pool::global(), md, std::move(op));
+}
+
+// Cumulative sum along Axis. A running sum has no pairwise order, so
+// summation::pairwise is compensated like summation::kahan.
+template<std::size_t Axis, class MD>
+auto cumsum_axis(thread_pool& pool, MD const& md, summation const mode = summation::kahan) {
+    using value_type = std::remove_cv_t<typename MD::value_type>;
+    if constexpr (std::is_floating_point_v<value_type>) {
+        if (mode != summation::naive)
+            return detail::scan_axis_impl<Axis, value_type>(pool, md, detail::kahan_scan_kernel<value_type>{});
+    }
+    return scan_axis<Axis>(pool, md, std::plus<>{});
+}
+
+template<std::size_t Axis, class MD>
+auto cumsum_axis(MD const& md, summation const mode = summation::kahan) {
+    return cumsum_axis<Axis>(thread_pool::global(), md, mode);
+}
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "container_policy.hpp"
+#include "mdarray.hpp"
+
+// Structure-of-arrays storage for aggregates. soa_container_policy<T> keeps
+// every data member of T listed in soa_traits<T> in its own contiguous
+// plane, indexed by the same storage offsets as an array of T would be, so a
+// kernel that reads one member streams only that member's plane.
+//
+// Element access returns a soa_reference proxy that converts to T (gathering
+// all members) and assigns from T (scattering them), so `T t = a(i, j)` and
+// `a(i, j) = t` compile unchanged. A single member is reached with
+// `a(i, j).get<&T::x>()`, and field_view<&T::x>(a) is an ordinary
+// basic_mdarray_view of the member's plane with the mapping of `a`, on which
+// the raw-pointer fast paths and vectorized loops apply.
+//
+// The members are listed by specializing soa_traits:
+//
+//   template<>
+//   struct soa_traits<particle> {
+//       static constexpr auto members = std::make_tuple(&particle::x, &particle::y, &particle::z);
+//   };
+
+template<class T>
+struct soa_traits;
+
+namespace detail {
+
+template<class>
+struct member_pointer_traits;
+
+template<class C, class M>
+struct member_pointer_traits<M C::*> {
+    using class_type = C;
+    using member_type = M;
+};
+
+template<class T>
+using soa_members_t = remove_cvref_t<decltype(soa_traits<T>::members)>;
+
+template<class T>
+inline constexpr std::size_t soa_member_count_v = std::tuple_size_v<soa_members_t<T>>;
+
+template<class T, std::size_t I>
+using soa_member_t = typename member_pointer_traits<std::tuple_element_t<I, soa_members_t<T>>>::member_type;
+
+template<class T, std::size_t I>
+inline constexpr auto soa_member_v = std::get<I>(soa_traits<T>::members);
+
+template<class T, auto Member, std::size_t I>
+constexpr bool is_soa_member() noexcept {
+    if constexpr (std::is_same_v<decltype(Member), std::tuple_element_t<I, soa_members_t<T>>>)
+        return soa_member_v<T, I> == Member;
+    else
+        return false;
+}
+
+template<class T, auto Member, std::size_t... Is>
+constexpr std::size_t soa_member_index(std::index_sequence<Is...>) noexcept {
+    std::size_t index = sizeof...(Is);
+    ((index = index == sizeof...(Is) && is_soa_member<T, Member, Is>() ? Is : index), ...);
+    return index;
+}
+
+// Position of Member in soa_traits<T>::members.
+template<class T, auto Member>
+inline constexpr std::size_t soa_member_index_v = soa_member_index<T, Member>(std::make_index_sequence<soa_member_count_v<T>>{});
+
+template<class T, class F, std::size_t... Is>
+constexpr void for_each_soa_member(F&& f, std::index_sequence<Is...>) {
+    (f(std::integral_constant<std::size_t, Is>{}), ...);
+}
+
+// Calls f(std::integral_constant<std::size_t, I>) for every member I of T.
+template<class T, class F>
+constexpr void for_each_soa_member(F&& f) {
+    for_each_soa_member<T>(std::forward<F>(f), std::make_index_sequence<soa_member_count_v<T>>{});
+}
+
+template<class T, std::size_t... Is>
+constexpr bool soa_members_supported(std::index_sequence<Is...>) noexcept {
+    return ((std::is_trivially_copyable_v<soa_member_t<T, Is>> && std::is_same_v<typename member_pointer_traits<
+        std::tuple_element_t<Is, soa_members_t<T>>>::class_type, T>) && ...);
+}
+
+inline constexpr std::size_t soa_plane_alignment = 64;
+
+} // namespace detail
+
+// Position in SoA storage: one pointer per member plane. Views and slices of
+// a SoA mdarray hold one of these instead of a raw pointer.
+template<class T, bool Const = false>
+struct soa_pointer {
+    static constexpr std::size_t member_count = detail::soa_member_count_v<T>;
+    using byte_pointer = std::conditional_t<Const, std::byte const*, std::byte*>;
+
+    template<std::size_t I>
+    using member_pointer = std::conditional_t<Const, detail::soa_member_t<T, I> const*, detail::soa_member_t<T, I>*>;
+
+    constexpr soa_pointer() noexcept = default;
+    constexpr explicit soa_pointer(std::array<byte_pointer, member_count> const& p) noexcept : planes(p) {}
+    template<bool C = Const, std::enable_if_t<C, int> = 0>
+    constexpr soa_pointer(soa_pointer<T, false> const& other) noexcept {
+        for (std::size_t m = 0; m < member_count; ++m)
+            planes[m] = other.planes[m];
+    }
+
+    // The element of member I addressed by this pointer.
+    template<std::size_t I>
+    member_pointer<I> plane() const noexcept { return reinterpret_cast<member_pointer<I>>(planes[I]); }
+
+    soa_pointer operator+(std::ptrdiff_t const i) const noexcept {
+        soa_pointer p = *this;
+        detail::for_each_soa_member<T>([&](auto const m) { p.planes[m] = reinterpret_cast<byte_pointer>(plane<m>() + i); });
+        return p;
+    }
+
+    std::array<byte_pointer, member_count> planes{};
+};
+
+// Proxy returned by mutable element access of a SoA mdarray.
+template<class T>
+class soa_reference {
+public:
+    explicit soa_reference(soa_pointer<T> const p) noexcept : p_(p) {}
+    soa_reference(soa_reference const&) = default;
+
+    operator T() const { return get(); }
+
+    T get() const {
+        T value{};
+        detail::for_each_soa_member<T>([&](auto const m) { value.*detail::soa_member_v<T, m> = *p_.template plane<m>(); });
+        return value;
+    }
+
+    // Member `Member` (e.g. &T::x) of the referenced element.
+    template<auto Member>
+    detail::soa_member_t<T, detail::soa_member_index_v<T, Member>>& get() const noexcept {
+        static_assert(detail::soa_member_index_v<T, Member> < detail::soa_member_count_v<T>, "not a member listed in soa_traits");
+        return *p_.template plane<detail::soa_member_index_v<T, Member>>();
+    }
+
+    soa_reference const& operator=(T const& value) const {
+        detail::for_each_soa_member<T>([&](auto const m) { *p_.template plane<m>() = value.*detail::soa_member_v<T, m>; });
+        return *this;
+    }
+
+    soa_reference const& operator=(soa_reference const& other) const { return *this = other.get(); }
+
+private:
+    soa_pointer<T> p_;
+};
+
+// Owns the planes of n elements in one allocation; every plane starts on a
+// cache line. Members are value-initialized.
+template<class T>
+class soa_storage {
+    static constexpr std::size_t member_count_ = detail::soa_member_count_v<T>;
+
+    static constexpr std::size_t plane_bytes(std::size_t const bytes) noexcept {
+        return (bytes + detail::soa_plane_alignment - 1) / detail::soa_plane_alignment * detail::soa_plane_alignment;
+    }
+
+public:
+    soa_storage() noexcept = default;
+
+    explicit soa_storage(std::size_t const n) {
+        std::array<std::size_t, member_count_> offsets{};
+        std::size_t bytes = 0;
+        detail::for_each_soa_member<T>([&](auto const m) {
+            offsets[m] = bytes;
+            bytes += plane_bytes(n * sizeof(detail::soa_member_t<T, m>));
+        });
+        if (bytes == 0)
+            return;
+        bytes_ = bytes;
+        data_ = static_cast<std::byte*>(::operator new(bytes, std::align_val_t{detail::soa_plane_alignment}));
+        std::array<std::byte*, member_count_> planes{};
+        detail::for_each_soa_member<T>([&](auto const m) {
+            planes[m] = data_ + offsets[m];
+            std::uninitialized_value_construct_n(reinterpret_cast<detail::soa_member_t<T, m>*>(planes[m]), n);
+        });
+        begin_ = soa_pointer<T>(planes);
+    }
+
+    soa_storage(soa_storage&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), bytes_(std::exchange(other.bytes_, 0)), begin_(std::exchange(other.begin_, {}))
+    {}
+
+    soa_storage& operator=(soa_storage&& other) noexcept {
+        soa_storage(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    ~soa_storage() noexcept {
+        if (data_ != nullptr)
+            ::operator delete(static_cast<void*>(data_), std::align_val_t{detail::soa_plane_alignment});
+    }
+
+    void swap(soa_storage& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(bytes_, other.bytes_);
+        std::swap(begin_, other.begin_);
+    }
+
+    soa_pointer<T> begin() const noexcept { return begin_; }
+    std::size_t allocated_bytes() const noexcept { return bytes_; }
+
+private:
+    std::byte* data_ = nullptr;
+    std::size_t bytes_ = 0;
+    soa_pointer<T> begin_{};
+};
+
+template<class T>
+struct soa_container_policy {
+    static_assert(std::is_default_constructible_v<T>, "");
+    static_assert(detail::soa_members_supported<T>(std::make_index_sequence<detail::soa_member_count_v<T>>{}),
+                  "soa_traits<T>::members must be pointers to trivially copyable data members of T");
+
+    using element_type = T;
+    using container_type = soa_storage<T>;
+    using pointer = soa_pointer<T>;
+    using const_pointer = soa_pointer<T, true>;
+    using reference = soa_reference<T>;
+    using const_reference = T;
+    using offset_policy = soa_container_policy<T>;
+
+    static constexpr std::size_t alignment = detail::soa_plane_alignment;
+
+    container_type create(std::size_t const n) const { return container_type(n); }
+
+    reference access(container_type const& c, std::ptrdiff_t const i) { return reference(c.begin() + i); }
+    const_reference access(container_type const& c, std::ptrdiff_t const i) const { return reference(c.begin() + i).get(); }
+    reference access(pointer const p, std::ptrdiff_t const i) { return reference(p + i); }
+    const_reference access(const_pointer const p, std::ptrdiff_t const i) const {
+        T value{};
+        const_pointer const q = p + i;
+        detail::for_each_soa_member<T>([&](auto const m) { value.*detail::soa_member_v<T, m> = *q.template plane<m>(); });
+        return value;
+    }
+
+    pointer offset(pointer const p, std::ptrdiff_t const i) { return p + i; }
+    const_pointer offset(const_pointer const p, std::ptrdiff_t const i) const { return p + i; }
+
+    pointer data(container_type& c) { return c.begin(); }
+    const_pointer data(container_type const& c) const { return c.begin(); }
+};
+
+namespace detail {
+
+template<auto Member, class P>
+auto soa_plane(P const& p) noexcept {
+    using element_type = typename member_pointer_traits<decltype(Member)>::class_type;
+    constexpr std::size_t index = soa_member_index_v<element_type, Member>;
+    static_assert(index < soa_member_count_v<element_type>, "not a member listed in soa_traits");
+    return p.template plane<index>();
+}
+
+} // namespace detail
+
+// The plane of member `Member` (e.g. &particle::x) of a SoA mdarray or view,
+// as a view of plain elements with the same extents and mapping.
+template<auto Member, class T, class E, class LP>
+auto field_view(basic_mdarray<T, E, LP, soa_container_policy<T>>& md) {
+    using member_type = typename detail::member_pointer_traits<decltype(Member)>::member_type;
+    return basic_mdarray_view<member_type, E, LP, default_container_policy<member_type>>(detail::soa_plane<Member>(md.data()), md.mapping());
+}
+
+template<auto Member, class T, class E, class LP>
+auto field_view(basic_mdarray<T, E, LP, soa_container_policy<T>> const& md) {
+    using member_type = typename detail::member_pointer_traits<decltype(Member)>::member_type const;
+    return basic_mdarray_view<member_type, E, LP, default_container_policy<member_type>>(detail::soa_plane<Member>(md.data()), md.mapping());
+}
+
+template<auto Member, class T, class E, class LP>
+auto field_view(basic_mdarray_view<T, E, LP, soa_container_policy<T>> const& v) {
+    using member_type = typename detail::member_pointer_traits<decltype(Member)>::member_type;
+    return basic_mdarray_view<member_type, E, LP, default_container_policy<member_type>>(detail::soa_plane<Member>(v.data()), v.mapping());
+}
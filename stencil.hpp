@@ -0,0 +1,618 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mdarray.hpp"
+#include "parallel.hpp"
+
+// Stencils and convolutions over basic_mdarray and views.
+//
+// A stencil computes every output element from a neighborhood of the input
+// element at the same index. It is given either as a `stencil` of weighted
+// offsets, or as any callable f(n) where n(d0, ..., dN) (or n(offsets))
+// returns the input element at offset (d0, ..., dN) from the center; the
+// latter is inlined, so offsets that are constants make a compile-time
+// neighborhood. Reads outside the array are resolved by a
+// boundary_condition.
+//
+// Each line along the unit-stride dimension is split into a boundary part,
+// evaluated with index checks, and an interior part whose neighbors are all
+// in range, evaluated with plain pointer offsets and no branches so that it
+// vectorizes. Lines are processed in parallel on a thread_pool.
+
+enum class boundary_mode {
+    clamp,    // repeat the edge element:       a a | a b c d | d d
+    wrap,     // periodic:                      c d | a b c d | a b
+    constant, // boundary_condition::value:     k k | a b c d | k k
+    mirror    // reflect about the edge element: c b | a b c d | c b
+};
+
+template<class T>
+struct boundary_condition {
+    boundary_mode mode = boundary_mode::clamp;
+    T value{};
+};
+
+// A neighborhood of weighted offsets. Applied to a neighborhood n it yields
+// the sum of weight * n(offset) over its points.
+template<class T, std::size_t Rank>
+class stencil {
+public:
+    using offset_type = std::array<std::ptrdiff_t, Rank>;
+
+    struct point {
+        offset_type offset;
+        T weight;
+    };
+
+    stencil() = default;
+    stencil(std::initializer_list<point> const points) : points_(points) {}
+
+    stencil& add(offset_type const& offset, T const weight) {
+        points_.push_back({offset, weight});
+        return *this;
+    }
+
+    std::vector<point> const& points() const noexcept { return points_; }
+
+    // Largest |offset| per dimension.
+    offset_type radius() const noexcept {
+        offset_type r{};
+        for (auto const& p : points_) {
+            for (std::size_t d = 0; d < Rank; ++d)
+                r[d] = std::max(r[d], p.offset[d] < 0 ? -p.offset[d] : p.offset[d]);
+        }
+        return r;
+    }
+
+    template<class Neighborhood>
+    T operator()(Neighborhood const& n) const {
+        T sum{};
+        for (auto const& p : points_)
+            sum += p.weight * n(p.offset);
+        return sum;
+    }
+
+private:
+    std::vector<point> points_;
+};
+
+namespace detail {
+
+template<class F>
+struct is_stencil : std::false_type {};
+
+template<class T, std::size_t Rank>
+struct is_stencil<stencil<T, Rank>> : std::true_type {};
+
+template<class F>
+inline constexpr bool is_stencil_v = is_stencil<F>::value;
+
+// Maps an index outside [0, n) into it.
+inline std::ptrdiff_t resolve_boundary_index(std::ptrdiff_t const j, std::ptrdiff_t const n, boundary_mode const mode) noexcept {
+    switch (mode) {
+    case boundary_mode::wrap:
+        return (j % n + n) % n;
+    case boundary_mode::mirror: {
+        if (n == 1)
+            return 0;
+        std::ptrdiff_t const period = 2 * (n - 1);
+        std::ptrdiff_t const k = (j % period + period) % period;
+        return k < n ? k : period - k;
+    }
+    default:
+        return std::clamp(j, std::ptrdiff_t(0), n - 1);
+    }
+}
+
+// Neighborhood whose neighbors are all in range: center[sum of d * stride].
+template<class T, std::size_t Rank>
+class interior_neighborhood {
+public:
+    interior_neighborhood(T const* const center, std::array<std::ptrdiff_t, Rank> const& strides) noexcept : center_(center), strides_(strides) {}
+
+    template<class... D, std::enable_if_t<sizeof...(D) == Rank && (std::is_convertible_v<D, std::ptrdiff_t> && ...), int> = 0>
+    T const& operator()(D const... d) const noexcept {
+        std::ptrdiff_t offset = 0;
+        std::size_t r = 0;
+        ((offset += static_cast<std::ptrdiff_t>(d) * strides_[r++]), ...);
+        return center_[offset];
+    }
+
+    T const& operator()(std::array<std::ptrdiff_t, Rank> const& d) const noexcept {
+        std::ptrdiff_t offset = 0;
+        for (std::size_t r = 0; r < Rank; ++r)
+            offset += d[r] * strides_[r];
+        return center_[offset];
+    }
+
+private:
+    T const* center_;
+    std::array<std::ptrdiff_t, Rank> const& strides_;
+};
+
+// Neighborhood that checks every neighbor against the extents of `in` and
+// applies the boundary condition.
+template<class In>
+class boundary_neighborhood {
+    static constexpr std::size_t rank_ = In::rank();
+    using value_type = typename In::value_type;
+
+public:
+    boundary_neighborhood(In const& in, std::array<std::ptrdiff_t, rank_> const& center, boundary_condition<value_type> const& bc) noexcept
+        : in_(in), center_(center), bc_(bc)
+    {}
+
+    template<class... D, std::enable_if_t<sizeof...(D) == rank_ && (std::is_convertible_v<D, std::ptrdiff_t> && ...), int> = 0>
+    value_type operator()(D const... d) const {
+        return (*this)(std::array<std::ptrdiff_t, rank_>{static_cast<std::ptrdiff_t>(d)...});
+    }
+
+    value_type operator()(std::array<std::ptrdiff_t, rank_> const& d) const {
+        std::array<std::ptrdiff_t, rank_> idx;
+        for (std::size_t r = 0; r < rank_; ++r) {
+            std::ptrdiff_t const j = center_[r] + d[r];
+            std::ptrdiff_t const n = in_.extent(r);
+            if (j >= 0 && j < n)
+                idx[r] = j;
+            else if (bc_.mode == boundary_mode::constant)
+                return bc_.value;
+            else
+                idx[r] = resolve_boundary_index(j, n, bc_.mode);
+        }
+        return in_(idx);
+    }
+
+private:
+    In const& in_;
+    std::array<std::ptrdiff_t, rank_> const& center_;
+    boundary_condition<value_type> const& bc_;
+};
+
+template<class F, class T, std::size_t Rank, class U, class Step>
+void stencil_line(F const& f, T const* const src, std::array<std::ptrdiff_t, Rank> const& strides, Step const src_step, U* const dst,
+                  Step const dst_step, std::ptrdiff_t const count) {
+    if constexpr (is_stencil_v<F>) {
+        for (std::ptrdiff_t i = 0; i < count; ++i)
+            dst[i * dst_step] = U{};
+        for (auto const& p : f.points()) {
+            std::ptrdiff_t offset = 0;
+            for (std::size_t r = 0; r < Rank; ++r)
+                offset += p.offset[r] * strides[r];
+            T const* const s = src + offset;
+            auto const w = p.weight;
+            for (std::ptrdiff_t i = 0; i < count; ++i)
+                dst[i * dst_step] += w * s[i * src_step];
+        }
+    }
+    else {
+        for (std::ptrdiff_t i = 0; i < count; ++i)
+            dst[i * dst_step] = f(interior_neighborhood<T, Rank>(src + i * src_step, strides));
+    }
+}
+
+// dst[i * dst_step] = f(neighborhood centered at src + i * src_step) for i
+// in [0, count), all neighbors in range. Weighted stencils are applied one
+// point at a time over the whole line. Unit steps get their own
+// instantiation so that the loops vectorize.
+template<class F, class T, std::size_t Rank, class U>
+void stencil_line(F const& f, T const* const src, std::array<std::ptrdiff_t, Rank> const& strides, std::ptrdiff_t const src_step,
+                  U* const dst, std::ptrdiff_t const dst_step, std::ptrdiff_t const count) {
+    if (src_step == 1 && dst_step == 1)
+        stencil_line(f, src, strides, unit_step{}, dst, unit_step{}, count);
+    else
+        stencil_line<F, T, Rank, U, std::ptrdiff_t>(f, src, strides, src_step, dst, dst_step, count);
+}
+
+// Calls f(idx) for the first index of every line of the box [lo, hi) along
+// dimension `inner`, with the other dimensions in `order` (outer to inner).
+// Lines [first, last) of the box in that order are visited.
+template<std::size_t Rank, class F>
+void for_each_line_in_box(std::array<std::ptrdiff_t, Rank> const& lo, std::array<std::ptrdiff_t, Rank> const& hi,
+                          std::array<std::size_t, Rank> const& order, std::size_t const first, std::size_t const last, F&& f) {
+    std::array<std::ptrdiff_t, Rank> idx = lo;
+    for (std::size_t line = first; line < last; ++line) {
+        std::size_t rest = line;
+        for (std::size_t k = Rank - 1; k-- > 0;) {
+            std::size_t const r = order[k];
+            auto const n = static_cast<std::size_t>(hi[r] - lo[r]);
+            idx[r] = lo[r] + static_cast<std::ptrdiff_t>(rest % n);
+            rest /= n;
+        }
+        f(idx);
+    }
+}
+
+template<std::size_t Rank>
+std::size_t line_count(std::array<std::ptrdiff_t, Rank> const& lo, std::array<std::ptrdiff_t, Rank> const& hi, std::size_t const inner) {
+    std::size_t lines = 1;
+    for (std::size_t r = 0; r < Rank; ++r) {
+        if (r != inner)
+            lines *= static_cast<std::size_t>(std::max<std::ptrdiff_t>(hi[r] - lo[r], 0));
+    }
+    return lines;
+}
+
+template<class In, class Out, class F>
+void apply_stencil_impl(thread_pool& pool, In const& in, Out& out, std::array<std::ptrdiff_t, In::rank()> const& radius, F const& f,
+                        boundary_condition<typename In::value_type> const& bc) {
+    constexpr std::size_t rank = In::rank();
+    static_assert(rank == Out::rank(), "");
+    static_assert(rank > 0, "");
+
+    std::array<std::ptrdiff_t, rank> lo{};
+    std::array<std::ptrdiff_t, rank> n{};
+    for (std::size_t r = 0; r < rank; ++r) {
+        n[r] = in.extent(r);
+        assert(out.extent(r) == n[r]);
+    }
+    if (in.size() == 0)
+        return;
+
+    auto const order = loop_order(in);
+    std::size_t const q = order[rank - 1];
+    std::size_t const lines = line_count(lo, n, q);
+    std::size_t const chunks = std::min(lines, pool.size() * tiles_per_thread);
+
+    std::array<std::ptrdiff_t, rank> in_strides{};
+    if constexpr (is_direct_strided_v<In const>) {
+        for (std::size_t r = 0; r < rank; ++r)
+            in_strides[r] = in.stride(r);
+    }
+
+    auto line_range = [&](std::size_t const c) {
+        for_each_line_in_box(lo, n, order, c * lines / chunks, (c + 1) * lines / chunks, [&](std::array<std::ptrdiff_t, rank> idx) {
+            bool interior = true;
+            for (std::size_t r = 0; r < rank; ++r) {
+                if (r != q && (idx[r] < radius[r] || idx[r] >= n[r] - radius[r]))
+                    interior = false;
+            }
+            std::ptrdiff_t const first = interior ? std::min(radius[q], n[q]) : n[q];
+            std::ptrdiff_t const last = interior ? std::max(first, n[q] - radius[q]) : n[q];
+
+            auto const boundary = [&](std::ptrdiff_t const i) {
+                idx[q] = i;
+                out(idx) = f(boundary_neighborhood<In>(in, idx, bc));
+            };
+            for (std::ptrdiff_t i = 0; i < first; ++i)
+                boundary(i);
+
+            if constexpr (is_direct_strided_v<In const> && is_direct_strided_v<Out>) {
+                idx[q] = first;
+                std::ptrdiff_t in_offset = 0;
+                std::ptrdiff_t out_offset = 0;
+                for (std::size_t r = 0; r < rank; ++r) {
+                    in_offset += idx[r] * in_strides[r];
+                    out_offset += idx[r] * out.stride(r);
+                }
+                stencil_line(f, in.data() + in_offset, in_strides, in_strides[q], out.data() + out_offset, out.stride(q), last - first);
+            }
+            else {
+                for (std::ptrdiff_t i = first; i < last; ++i)
+                    boundary(i);
+            }
+
+            for (std::ptrdiff_t i = last; i < n[q]; ++i)
+                boundary(i);
+        });
+    };
+    pool.parallel_for(chunks, line_range);
+}
+
+// Per-rank edge of the cubic tiles of iterate_stencil.
+template<std::size_t Rank>
+inline constexpr std::ptrdiff_t temporal_tile_extent = Rank == 1 ? 8192 : Rank == 2 ? 128 : 32;
+
+template<class MD, class F>
+void iterate_stencil_impl(thread_pool& pool, MD& a, std::size_t const steps, std::array<std::ptrdiff_t, MD::rank()> const& radius, F const& f,
+                          boundary_condition<typename MD::value_type> const& bc, std::size_t const time_block) {
+    constexpr std::size_t rank = MD::rank();
+    static_assert(rank > 0, "");
+    using T = typename MD::value_type;
+    using index_array = std::array<std::ptrdiff_t, rank>;
+
+    if (steps == 0 || a.size() == 0)
+        return;
+
+    index_array n{};
+    index_array tile{};
+    index_array tiles{};
+    std::size_t tile_count = 1;
+    std::size_t max_block = std::max<std::size_t>(time_block, 1);
+    for (std::size_t r = 0; r < rank; ++r) {
+        n[r] = a.extent(r);
+        tile[r] = std::min(temporal_tile_extent<rank>, n[r]);
+        tiles[r] = (n[r] + tile[r] - 1) / tile[r];
+        tile_count *= static_cast<std::size_t>(tiles[r]);
+        // Keeps the halo narrower than the array, so that every ghost cell
+        // refreshed inside a tile mirrors or clamps to a cell of the tile.
+        if (radius[r] > 0)
+            max_block = std::min(max_block, std::max<std::size_t>(1, static_cast<std::size_t>((n[r] - 1) / radius[r])));
+    }
+
+    // Dense row-major result of one time block, copied back into `a` at its end.
+    index_array result_strides{};
+    std::ptrdiff_t result_size = 1;
+    for (std::size_t r = rank; r-- > 0;) {
+        result_strides[r] = result_size;
+        result_size *= n[r];
+    }
+    std::vector<T> result(static_cast<std::size_t>(result_size));
+
+    std::array<std::size_t, rank> row_major_order{};
+    for (std::size_t r = 0; r < rank; ++r)
+        row_major_order[r] = r;
+
+    for (std::size_t done = 0; done < steps;) {
+        std::size_t const block = std::min(max_block, steps - done);
+
+        auto tile_task = [&](std::size_t const t) {
+            thread_local std::vector<T> buffers[2];
+
+            // Tile [lo, hi) and its halo of `block` stencil radii, stored
+            // row-major in a local buffer of extents `ext`.
+            index_array lo{};
+            index_array hi{};
+            index_array halo{};
+            index_array ext{};
+            index_array strides{};
+            std::size_t rest = t;
+            bool has_ghosts = false;
+            for (std::size_t r = rank; r-- > 0;) {
+                lo[r] = static_cast<std::ptrdiff_t>(rest % static_cast<std::size_t>(tiles[r])) * tile[r];
+                rest /= static_cast<std::size_t>(tiles[r]);
+                hi[r] = std::min(lo[r] + tile[r], n[r]);
+                halo[r] = static_cast<std::ptrdiff_t>(block) * radius[r];
+                ext[r] = hi[r] - lo[r] + 2 * halo[r];
+                has_ghosts = has_ghosts || lo[r] - halo[r] < 0 || hi[r] + halo[r] > n[r];
+            }
+            std::ptrdiff_t size = 1;
+            for (std::size_t r = rank; r-- > 0;) {
+                strides[r] = size;
+                size *= ext[r];
+            }
+
+            // Per dimension and buffer coordinate: the index of `a` it is
+            // gathered from (-1 for a constant boundary), and the buffer
+            // coordinate of that index.
+            std::array<std::vector<std::ptrdiff_t>, rank> source;
+            std::array<std::vector<std::ptrdiff_t>, rank> local;
+            for (std::size_t r = 0; r < rank; ++r) {
+                source[r].resize(static_cast<std::size_t>(ext[r]));
+                local[r].resize(static_cast<std::size_t>(ext[r]));
+                for (std::ptrdiff_t b = 0; b < ext[r]; ++b) {
+                    std::ptrdiff_t const j = lo[r] - halo[r] + b;
+                    std::ptrdiff_t s = j;
+                    if (j < 0 || j >= n[r])
+                        s = bc.mode == boundary_mode::constant ? -1 : resolve_boundary_index(j, n[r], bc.mode);
+                    source[r][static_cast<std::size_t>(b)] = s;
+                    local[r][static_cast<std::size_t>(b)] = s < 0 ? -1 : s - (lo[r] - halo[r]);
+                }
+            }
+
+            std::vector<T>* cur = &buffers[0];
+            std::vector<T>* next = &buffers[1];
+            cur->resize(static_cast<std::size_t>(size));
+            next->resize(static_cast<std::size_t>(size));
+
+            index_array const zero{};
+            std::size_t const all_lines = line_count(zero, ext, rank - 1);
+            for_each_line_in_box(zero, ext, row_major_order, 0, all_lines, [&](index_array idx) {
+                T* const out = cur->data() + [&] {
+                    std::ptrdiff_t o = 0;
+                    for (std::size_t r = 0; r + 1 < rank; ++r)
+                        o += idx[r] * strides[r];
+                    return o;
+                }();
+                bool outside = false;
+                index_array src{};
+                for (std::size_t r = 0; r + 1 < rank; ++r) {
+                    src[r] = source[r][static_cast<std::size_t>(idx[r])];
+                    outside = outside || src[r] < 0;
+                }
+                constexpr std::size_t q = rank - 1;
+                if constexpr (is_direct_strided_v<MD>) {
+                    if (!outside) {
+                        // Copies the part of the line inside the array in one run.
+                        std::ptrdiff_t row = 0;
+                        for (std::size_t r = 0; r < q; ++r)
+                            row += src[r] * a.stride(r);
+                        std::ptrdiff_t const step = a.stride(q);
+                        std::ptrdiff_t const first = std::clamp(halo[q] - lo[q], std::ptrdiff_t(0), ext[q]);
+                        std::ptrdiff_t const last = std::clamp(n[q] - lo[q] + halo[q], first, ext[q]);
+                        T const* const in = a.data() + row + (lo[q] - halo[q]) * step;
+                        if (step == 1)
+                            std::copy(in + first, in + last, out + first);
+                        else {
+                            for (std::ptrdiff_t b = first; b < last; ++b)
+                                out[b] = in[b * step];
+                        }
+                        auto const ghost = [&](std::ptrdiff_t const b) {
+                            std::ptrdiff_t const j = source[q][static_cast<std::size_t>(b)];
+                            out[b] = j < 0 ? bc.value : a.data()[row + j * step];
+                        };
+                        for (std::ptrdiff_t b = 0; b < first; ++b)
+                            ghost(b);
+                        for (std::ptrdiff_t b = last; b < ext[q]; ++b)
+                            ghost(b);
+                        return;
+                    }
+                }
+                for (std::ptrdiff_t b = 0; b < ext[q]; ++b) {
+                    src[q] = source[q][static_cast<std::size_t>(b)];
+                    out[b] = outside || src[q] < 0 ? bc.value : static_cast<T>(a(src));
+                }
+            });
+
+            for (std::size_t s = 0; s < block; ++s) {
+                index_array rlo{};
+                index_array rhi{};
+                for (std::size_t r = 0; r < rank; ++r) {
+                    rlo[r] = static_cast<std::ptrdiff_t>(s + 1) * radius[r];
+                    rhi[r] = ext[r] - rlo[r];
+                }
+                std::size_t const lines = line_count(rlo, rhi, rank - 1);
+                for_each_line_in_box(rlo, rhi, row_major_order, 0, lines, [&](index_array const& idx) {
+                    std::ptrdiff_t offset = 0;
+                    for (std::size_t r = 0; r < rank; ++r)
+                        offset += idx[r] * strides[r];
+                    stencil_line(f, cur->data() + offset, strides, unit_step{}, next->data() + offset, unit_step{}, rhi[rank - 1] - rlo[rank - 1]);
+                });
+
+                // Cells outside the array follow the boundary condition
+                // rather than the stencil, except for periodic boundaries,
+                // where they are exact copies of cells inside.
+                if (has_ghosts && s + 1 < block && bc.mode != boundary_mode::wrap) {
+                    for_each_line_in_box(rlo, rhi, row_major_order, 0, lines, [&](index_array idx) {
+                        bool outer_ghost = false;
+                        std::ptrdiff_t base = 0;
+                        for (std::size_t r = 0; r + 1 < rank; ++r) {
+                            std::ptrdiff_t const j = lo[r] - halo[r] + idx[r];
+                            outer_ghost = outer_ghost || j < 0 || j >= n[r];
+                            base += local[r][static_cast<std::size_t>(idx[r])] * strides[r];
+                        }
+                        constexpr std::size_t q = rank - 1;
+                        for (idx[q] = rlo[q]; idx[q] < rhi[q]; ++idx[q]) {
+                            std::ptrdiff_t const j = lo[q] - halo[q] + idx[q];
+                            if (!outer_ghost && j >= 0 && j < n[q])
+                                continue;
+                            std::ptrdiff_t offset = 0;
+                            for (std::size_t r = 0; r < rank; ++r)
+                                offset += idx[r] * strides[r];
+                            (*next)[static_cast<std::size_t>(offset)] = bc.mode == boundary_mode::constant
+                                ? bc.value
+                                : (*next)[static_cast<std::size_t>(base + local[q][static_cast<std::size_t>(idx[q])])];
+                        }
+                    });
+                }
+                std::swap(cur, next);
+            }
+
+            index_array core_lo{};
+            index_array core_hi{};
+            for (std::size_t r = 0; r < rank; ++r) {
+                core_lo[r] = halo[r];
+                core_hi[r] = halo[r] + hi[r] - lo[r];
+            }
+            std::size_t const core_lines = line_count(core_lo, core_hi, rank - 1);
+            for_each_line_in_box(core_lo, core_hi, row_major_order, 0, core_lines, [&](index_array const& idx) {
+                std::ptrdiff_t offset = 0;
+                std::ptrdiff_t result_offset = 0;
+                for (std::size_t r = 0; r < rank; ++r) {
+                    offset += idx[r] * strides[r];
+                    result_offset += (lo[r] + idx[r] - halo[r]) * result_strides[r];
+                }
+                std::copy_n(cur->data() + offset, core_hi[rank - 1] - core_lo[rank - 1], result.data() + result_offset);
+            });
+        };
+        pool.parallel_for(tile_count, tile_task);
+
+        index_array const zero{};
+        std::size_t const lines = line_count(zero, n, rank - 1);
+        std::size_t const chunks = std::min(lines, pool.size() * tiles_per_thread);
+        pool.parallel_for(chunks, [&](std::size_t const c) {
+            for_each_line_in_box(zero, n, row_major_order, c * lines / chunks, (c + 1) * lines / chunks, [&](index_array idx) {
+                std::ptrdiff_t offset = 0;
+                for (std::size_t r = 0; r + 1 < rank; ++r)
+                    offset += idx[r] * result_strides[r];
+                T const* const line = result.data() + offset;
+                if constexpr (is_direct_strided_v<MD>) {
+                    std::ptrdiff_t row = 0;
+                    for (std::size_t r = 0; r + 1 < rank; ++r)
+                        row += idx[r] * a.stride(r);
+                    std::ptrdiff_t const step = a.stride(rank - 1);
+                    if (step == 1)
+                        std::copy_n(line, n[rank - 1], a.data() + row);
+                    else {
+                        for (std::ptrdiff_t j = 0; j < n[rank - 1]; ++j)
+                            a.data()[row + j * step] = line[j];
+                    }
+                }
+                else {
+                    for (idx[rank - 1] = 0; idx[rank - 1] < n[rank - 1]; ++idx[rank - 1])
+                        a(idx) = line[idx[rank - 1]];
+                }
+            });
+        });
+        done += block;
+    }
+}
+
+template<std::size_t Rank>
+std::array<std::ptrdiff_t, Rank> uniform_radius(std::ptrdiff_t const r) noexcept {
+    std::array<std::ptrdiff_t, Rank> radius{};
+    radius.fill(r);
+    return radius;
+}
+
+} // namespace detail
+
+// out(idx) = f(neighborhood of in at idx) for every index. `radius` bounds
+// |offset| per dimension of the neighbors f reads; `in` and `out` must have
+// equal extents and must not alias.
+template<class In, class Out, class F>
+void apply_stencil(thread_pool& pool, In const& in, Out&& out, std::array<std::ptrdiff_t, In::rank()> const& radius, F const& f,
+                   boundary_condition<typename In::value_type> const& bc = {}) {
+    detail::apply_stencil_impl(pool, in, out, radius, f, bc);
+}
+
+template<class In, class Out, class F>
+void apply_stencil(In const& in, Out&& out, std::array<std::ptrdiff_t, In::rank()> const& radius, F const& f,
+                   boundary_condition<typename In::value_type> const& bc = {}) {
+    detail::apply_stencil_impl(thread_pool::global(), in, out, radius, f, bc);
+}
+
+template<class In, class Out, class F>
+void apply_stencil(In const& in, Out&& out, std::ptrdiff_t const radius, F const& f, boundary_condition<typename In::value_type> const& bc = {}) {
+    detail::apply_stencil_impl(thread_pool::global(), in, out, detail::uniform_radius<In::rank()>(radius), f, bc);
+}
+
+template<class In, class Out, class T>
+void apply_stencil(thread_pool& pool, In const& in, Out&& out, stencil<T, In::rank()> const& s, boundary_condition<typename In::value_type> const& bc = {}) {
+    detail::apply_stencil_impl(pool, in, out, s.radius(), s, bc);
+}
+
+template<class In, class Out, class T>
+void apply_stencil(In const& in, Out&& out, stencil<T, In::rank()> const& s, boundary_condition<typename In::value_type> const& bc = {}) {
+    detail::apply_stencil_impl(thread_pool::global(), in, out, s.radius(), s, bc);
+}
+
+// Applies the stencil `steps` times to `a` in place, each step reading the
+// result of the previous one.
+//
+// With temporal blocking, `time_block` steps are fused: each tile is copied
+// into a cache-resident buffer together with a halo of time_block stencil
+// radii, advanced time_block steps there, and its core written back. Halo
+// cells are recomputed by neighboring tiles, so tiles run in parallel
+// without synchronization and each element travels through memory once
+// per time block rather than once per step.
+template<class MD, class F>
+void iterate_stencil(thread_pool& pool, MD&& a, std::size_t const steps, std::array<std::ptrdiff_t, detail::remove_cvref_t<MD>::rank()> const& radius,
+                     F const& f, boundary_condition<typename detail::remove_cvref_t<MD>::value_type> const& bc = {}, std::size_t const time_block = 4) {
+    detail::iterate_stencil_impl(pool, a, steps, radius, f, bc, time_block);
+}
+
+template<class MD, class F>
+void iterate_stencil(MD&& a, std::size_t const steps, std::ptrdiff_t const radius, F const& f,
+                     boundary_condition<typename detail::remove_cvref_t<MD>::value_type> const& bc = {}, std::size_t const time_block = 4) {
+    detail::iterate_stencil_impl(thread_pool::global(), a, steps, detail::uniform_radius<detail::remove_cvref_t<MD>::rank()>(radius), f, bc, time_block);
+}
+
+template<class MD, class T>
+void iterate_stencil(thread_pool& pool, MD&& a, std::size_t const steps, stencil<T, detail::remove_cvref_t<MD>::rank()> const& s,
+                     boundary_condition<typename detail::remove_cvref_t<MD>::value_type> const& bc = {}, std::size_t const time_block = 4) {
+    detail::iterate_stencil_impl(pool, a, steps, s.radius(), s, bc, time_block);
+}
+
+template<class MD, class T>
+void iterate_stencil(MD&& a, std::size_t const steps, stencil<T, detail::remove_cvref_t<MD>::rank()> const& s,
+                     boundary_condition<typename detail::remove_cvref_t<MD>::value_type> const& bc = {}, std::size_t const time_block = 4) {
+    detail::iterate_stencil_impl(thread_pool::global(), a, steps, s.radius(), s, bc, time_block);
+}
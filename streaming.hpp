@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "mdarray.hpp"
+#include "mmap_container_policy.hpp"
+
+// Out-of-core execution over file-backed mdarrays (mmap_container_policy,
+// open_npy). The array is processed as a sequence of slabs along its
+// outermost dimension, the one with the largest stride, so every slab is a
+// contiguous range of the file. While the calling thread runs the kernel on
+// one slab, a background I/O thread reads the next slab into memory and
+// writes the previous one back, so the disk and the CPU stay busy at once
+// and only about three slabs are resident at a time.
+
+struct stream_options {
+    // Number of indices of the outermost dimension per slab. 0 picks the
+    // largest slab of at most `slab_bytes` bytes.
+    std::ptrdiff_t slab_extent = 0;
+    std::size_t slab_bytes = std::size_t(64) << 20;
+
+    // Read slab k + 1 on the I/O thread while slab k is processed. Without
+    // it each slab is faulted in by the kernel as it is touched.
+    bool prefetch = true;
+
+    // Write each processed slab back to the file (msync) on the I/O thread.
+    // Only applies to read_write, shared mappings.
+    bool write_back = true;
+
+    // Drop each processed slab from memory once it is written back, so the
+    // resident set stays bounded by a few slabs. Never applies to writable
+    // private_copy mappings, whose modifications would be lost.
+    bool release = true;
+};
+
+struct stream_statistics {
+    std::size_t slabs = 0;
+    // Time spent in the kernel, and time the calling thread waited for a
+    // prefetch to complete. A wait close to zero means I/O was hidden.
+    double compute_seconds = 0;
+    double io_wait_seconds = 0;
+};
+
+namespace detail {
+
+// Runs jobs on one background thread in submission order. wait(ticket)
+// blocks until the job with that ticket and every earlier one are done and
+// rethrows the first exception thrown by any job.
+class io_queue {
+public:
+    io_queue() : thread_([this] { run(); }) {}
+
+    io_queue(io_queue const&) = delete;
+    io_queue& operator=(io_queue const&) = delete;
+
+    // Finishes the queued jobs before returning.
+    ~io_queue() {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stop_ = true;
+        }
+        submitted_cv_.notify_one();
+        thread_.join();
+    }
+
+    std::size_t submit(std::function<void()> job) {
+        std::size_t ticket;
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            jobs_.push_back(std::move(job));
+            ticket = ++submitted_;
+        }
+        submitted_cv_.notify_one();
+        return ticket;
+    }
+
+    void wait(std::size_t const ticket) {
+        std::unique_lock<std::mutex> lock(m_);
+        completed_cv_.wait(lock, [&] { return completed_ >= ticket; });
+        if (error_)
+            std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+    void wait_all() { wait(submitted_); }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_);
+        for (;;) {
+            submitted_cv_.wait(lock, [&] { return stop_ || !jobs_.empty(); });
+            if (jobs_.empty())
+                return;
+            std::function<void()> job = std::move(jobs_.front());
+            jobs_.pop_front();
+
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                job();
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+
+            if (error && !error_)
+                error_ = error;
+            ++completed_;
+            completed_cv_.notify_all();
+        }
+    }
+
+    std::mutex m_;
+    std::condition_variable submitted_cv_;
+    std::condition_variable completed_cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::size_t submitted_ = 0;
+    std::size_t completed_ = 0;
+    std::exception_ptr error_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+// The dimension with the largest stride for the given layout.
+template<class Layout, std::size_t Rank>
+struct outermost_dimension : std::integral_constant<std::size_t, 0> {};
+
+template<std::size_t Rank>
+struct outermost_dimension<layout_left, Rank> : std::integral_constant<std::size_t, Rank - 1> {};
+
+template<std::size_t Pad, std::size_t Rank>
+struct outermost_dimension<layout_left_padded<Pad>, Rank> : std::integral_constant<std::size_t, Rank - 1> {};
+
+template<std::size_t D, class MD, std::size_t... Is>
+auto slab_view(MD& md, std::ptrdiff_t const first, std::ptrdiff_t const last, std::index_sequence<Is...>) {
+    return submdarray(md, [&] {
+        if constexpr (Is == D)
+            return std::pair<std::ptrdiff_t, std::ptrdiff_t>(first, last);
+        else
+            return full_extent;
+    }()...);
+}
+
+inline double seconds_since(std::chrono::steady_clock::time_point const start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace detail
+
+// Calls f(slab) for consecutive slabs of `md` along its outermost dimension,
+// in order, on the calling thread; `slab` is a basic_mdarray_view of the
+// same rank, so kernels written for views run unchanged. If f also accepts
+// the index of the slab's first element along that dimension, it is called
+// as f(slab, first).
+//
+// Slabs are prefetched and written back on a background thread as described
+// by `options`. Errors from the I/O thread are rethrown on the calling
+// thread. Results are only durable in the file once this returns.
+template<class T, class E, class LP, class F>
+stream_statistics for_each_slab(basic_mdarray<T, E, LP, mmap_container_policy<T>>& md, F&& f, stream_options const& options = {}) {
+    static_assert(E::rank() > 0, "");
+    static_assert(LP::template mapping<E>::is_always_strided(), "for_each_slab requires a strided layout");
+    constexpr std::size_t dim = detail::outermost_dimension<LP, E::rank()>::value;
+
+    stream_statistics stats;
+    std::ptrdiff_t const outer = md.extent(dim);
+    if (md.size() == 0)
+        return stats;
+
+    auto const stride = static_cast<std::size_t>(md.stride(dim));
+    for ([[maybe_unused]] std::size_t r = 0; r < E::rank(); ++r)
+        assert(md.stride(r) <= md.stride(dim));
+
+    std::ptrdiff_t slab = options.slab_extent;
+    if (slab <= 0)
+        slab = static_cast<std::ptrdiff_t>(std::max<std::size_t>(options.slab_bytes / (stride * sizeof(T)), 1));
+    slab = std::min(slab, outer);
+    std::size_t const slab_count = static_cast<std::size_t>((outer + slab - 1) / slab);
+
+    auto const policy = md.container_policy();
+    bool const shared_writable = !std::is_const_v<T> && policy.mode() == mmap_mode::read_write && policy.sharing() == mmap_sharing::shared;
+    bool const write_back = options.write_back && shared_writable;
+    bool const release = options.release && (shared_writable || policy.mode() == mmap_mode::read_only);
+
+    auto const& region = md.container();
+    auto const first_of = [&](std::size_t const k) { return static_cast<std::ptrdiff_t>(k) * slab; };
+    auto const last_of = [&](std::size_t const k) { return std::min(first_of(k) + slab, outer); };
+    // Storage offsets of slab k, up to the end of its last outermost index.
+    auto const offsets_of = [&](std::size_t const k) {
+        return std::pair<std::size_t, std::size_t>(static_cast<std::size_t>(first_of(k)) * stride,
+                                                   static_cast<std::size_t>(last_of(k) - first_of(k)) * stride);
+    };
+
+    detail::io_queue io;
+    std::size_t ready = 0; // ticket of the prefetch of the current slab
+    if (options.prefetch) {
+        auto const [o, n] = offsets_of(0);
+        ready = io.submit([&region, o = o, n = n] { region.populate(o, n); });
+    }
+
+    for (std::size_t k = 0; k < slab_count; ++k) {
+        std::size_t next = 0;
+        if (options.prefetch && k + 1 < slab_count) {
+            auto const [o, n] = offsets_of(k + 1);
+            next = io.submit([&region, o = o, n = n] { region.populate(o, n); });
+        }
+
+        auto const wait_start = std::chrono::steady_clock::now();
+        io.wait(ready);
+        stats.io_wait_seconds += detail::seconds_since(wait_start);
+
+        auto const compute_start = std::chrono::steady_clock::now();
+        auto view = detail::slab_view<dim>(md, first_of(k), last_of(k), std::make_index_sequence<E::rank()>{});
+        if constexpr (std::is_invocable_v<F&, decltype(view)&, std::ptrdiff_t>)
+            f(view, first_of(k));
+        else
+            f(view);
+        stats.compute_seconds += detail::seconds_since(compute_start);
+        ++stats.slabs;
+
+        if (write_back || release) {
+            auto const [o, n] = offsets_of(k);
+            io.submit([&region, o = o, n = n, write_back, release] {
+                if (write_back)
+                    region.sync(o, n);
+                if (release)
+                    region.release(o, n);
+            });
+        }
+        ready = next;
+    }
+
+    io.wait_all();
+    return stats;
+}